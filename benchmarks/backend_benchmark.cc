@@ -0,0 +1,85 @@
+// Startup and per-call latency of an X11 backend through the public API. The
+// same source is built against the Xlib backend (:x11_backend_benchmark) and
+// the XCB backend (:xcb_backend_benchmark) so the two can be compared.
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+#include "platform_window/platform_window.h"
+
+namespace {
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+bool HasDisplay(benchmark::State& state) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return false;
+  }
+  return true;
+}
+
+// Window creation includes all of the backend's synchronous round trips, and
+// destruction waits for its event thread to let go of the window.
+void BM_CreateDestroyWindow(benchmark::State& state) {
+  if (!HasDisplay(state)) {
+    return;
+  }
+  for (auto _ : state) {
+    PlatformWindow window =
+        PlatformWindowMakeDefaultWindow("backend_benchmark", &IgnoreEvent,
+                                        nullptr);
+    PlatformWindowDestroyWindow(window);
+  }
+}
+BENCHMARK(BM_CreateDestroyWindow)->Unit(benchmark::kMicrosecond);
+
+void BM_SetTitle(benchmark::State& state) {
+  if (!HasDisplay(state)) {
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeDefaultWindow(
+      "backend_benchmark", &IgnoreEvent, nullptr);
+  for (auto _ : state) {
+    PlatformWindowSetTitle(window, "title");
+  }
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK(BM_SetTitle);
+
+void BM_ShowHide(benchmark::State& state) {
+  if (!HasDisplay(state)) {
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeDefaultWindow(
+      "backend_benchmark", &IgnoreEvent, nullptr);
+  for (auto _ : state) {
+    PlatformWindowShow(window);
+    PlatformWindowHide(window);
+  }
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK(BM_ShowHide);
+
+// Every thread shares the backend's command path, which shows the cost of
+// Xlib's locking next to XCB's.
+void BM_SetTitleContended(benchmark::State& state) {
+  static PlatformWindow window = INVALID_PLATFORM_WINDOW;
+  if (!HasDisplay(state)) {
+    return;
+  }
+  if (state.thread_index() == 0) {
+    window = PlatformWindowMakeDefaultWindow("backend_benchmark",
+                                             &IgnoreEvent, nullptr);
+  }
+  for (auto _ : state) {
+    PlatformWindowSetTitle(window, "title");
+  }
+  if (state.thread_index() == 0) {
+    PlatformWindowDestroyWindow(window);
+  }
+}
+BENCHMARK(BM_SetTitleContended)->ThreadRange(1, 8);
+}  // namespace
@@ -0,0 +1,173 @@
+// Per-event cost of getting a translated event to the application: the
+// backends' EventDispatcher, the C++ wrapper's std::function trampoline, the
+// polling queue, and plain event copies. Needs no display.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "event_dispatcher.h"
+#include "event_queue.h"
+#include "platform_window/platform_window.h"
+#include "platform_window/platform_window_cpp.h"
+#include "platform_window_cpp_internal.h"
+
+namespace {
+std::vector<PlatformWindowTimedEvent> MakeTimedEvents(size_t count) {
+  std::vector<PlatformWindowTimedEvent> events(count);
+  for (size_t i = 0; i < count; ++i) {
+    events[i].event.type = kPlatformWindowEventTypeMouseMove;
+    events[i].event.data.mouse_move = {
+        static_cast<int32_t>(i), static_cast<int32_t>(i),
+        static_cast<float>(i), static_cast<float>(i)};
+    events[i].timestamp_ns = platform_window::MonotonicNowNs();
+    events[i].received_ns = events[i].timestamp_ns;
+  }
+  return events;
+}
+
+std::vector<PlatformWindowEvent> MakeEvents(size_t count) {
+  std::vector<PlatformWindowEvent> events;
+  for (const PlatformWindowTimedEvent& event : MakeTimedEvents(count)) {
+    events.push_back(event.event);
+  }
+  return events;
+}
+
+// The argument of each benchmark is the number of events per batch.
+void BatchSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(1)->Arg(16)->Arg(256);
+}
+
+void BM_DispatchToEventCallback(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  platform_window::EventDispatcher dispatcher(
+      [](void* context, PlatformWindowEvent event) {
+        benchmark::DoNotOptimize(event);
+      },
+      nullptr);
+  for (auto _ : state) {
+    dispatcher.Dispatch(events.data(), events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_DispatchToEventCallback)->Apply(BatchSizes);
+
+void BM_DispatchToBatchCallback(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  platform_window::EventDispatcher dispatcher(
+      [](void* context, const PlatformWindowEvent* events, size_t count) {
+        benchmark::DoNotOptimize(events);
+      },
+      nullptr);
+  for (auto _ : state) {
+    dispatcher.Dispatch(events.data(), events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_DispatchToBatchCallback)->Apply(BatchSizes);
+
+void BM_DispatchToTimedBatchCallback(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  platform_window::EventDispatcher dispatcher(
+      [](void* context, const PlatformWindowTimedEvent* events, size_t count) {
+        benchmark::DoNotOptimize(events);
+      },
+      nullptr);
+  for (auto _ : state) {
+    dispatcher.Dispatch(events.data(), events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_DispatchToTimedBatchCallback)->Apply(BatchSizes);
+
+// The same, for a window created with kPlatformWindowFlagCollectStats.
+void BM_DispatchToTimedBatchCallbackWithStats(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  platform_window::EventDispatcher dispatcher(
+      [](void* context, const PlatformWindowTimedEvent* events, size_t count) {
+        benchmark::DoNotOptimize(events);
+      },
+      nullptr);
+  dispatcher.stats()->Enable();
+  for (auto _ : state) {
+    dispatcher.Dispatch(events.data(), events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_DispatchToTimedBatchCallbackWithStats)->Apply(BatchSizes);
+
+void BM_DispatchToQueue(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  platform_window::EventDispatcher dispatcher(
+      std::make_unique<platform_window::EventQueue>());
+  std::vector<PlatformWindowEvent> polled(events.size());
+  for (auto _ : state) {
+    dispatcher.Dispatch(events.data(), events.size());
+    benchmark::DoNotOptimize(
+        dispatcher.queue()->Pop(polled.data(), polled.size()));
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_DispatchToQueue)->Apply(BatchSizes);
+
+// platform_window::Window::Create()'s path: C callback, into the batch
+// std::function, into the adapted single event std::function.
+void BM_CppEventHandlerTrampoline(benchmark::State& state) {
+  const auto events = MakeEvents(state.range(0));
+  platform_window::Window::BatchEventHandlerFunction handler =
+      platform_window::internal::AdaptEventHandler(
+          [](PlatformWindowEvent event) { benchmark::DoNotOptimize(event); });
+  for (auto _ : state) {
+    platform_window::internal::CallBatchEventHandler(&handler, events.data(),
+                                                     events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_CppEventHandlerTrampoline)->Apply(BatchSizes);
+
+void BM_CppBatchEventHandlerTrampoline(benchmark::State& state) {
+  const auto events = MakeEvents(state.range(0));
+  platform_window::Window::BatchEventHandlerFunction handler =
+      [](const PlatformWindowEvent* events, size_t count) {
+        benchmark::DoNotOptimize(events);
+      };
+  for (auto _ : state) {
+    platform_window::internal::CallBatchEventHandler(&handler, events.data(),
+                                                     events.size());
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_CppBatchEventHandlerTrampoline)->Apply(BatchSizes);
+
+void BM_CopyEvent(benchmark::State& state) {
+  const auto events = MakeEvents(state.range(0));
+  std::vector<PlatformWindowEvent> copies(events.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < events.size(); ++i) {
+      copies[i] = events[i];
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  state.SetBytesProcessed(state.iterations() * events.size() *
+                          sizeof(PlatformWindowEvent));
+}
+BENCHMARK(BM_CopyEvent)->Apply(BatchSizes);
+
+void BM_CopyTimedEvent(benchmark::State& state) {
+  const auto events = MakeTimedEvents(state.range(0));
+  std::vector<PlatformWindowTimedEvent> copies(events.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < events.size(); ++i) {
+      copies[i] = events[i];
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+  state.SetBytesProcessed(state.iterations() * events.size() *
+                          sizeof(PlatformWindowTimedEvent));
+}
+BENCHMARK(BM_CopyTimedEvent)->Apply(BatchSizes);
+}  // namespace
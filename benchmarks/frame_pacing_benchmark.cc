@@ -0,0 +1,69 @@
+// How closely PlatformWindowWaitForNextFrame() follows the display's vblanks,
+// with the window's own event thread and with the application pumping the
+// window itself. Each iteration is one frame, so the time per iteration is the
+// refresh interval; wake_up_latency is how long after the vblank the wait
+// returned.
+//
+// Requires a running X server with the Present extension (e.g. Xvfb, whose
+// vblanks are simulated) reachable through $DISPLAY.
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+#include "platform_window/frame_timing.h"
+#include "platform_window/platform_window.h"
+
+namespace {
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+void BM_WaitForNextFrame(benchmark::State& state, uint32_t flags) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeWindow(
+      "frame_pacing_benchmark", flags, &IgnoreEvent, nullptr);
+  PlatformWindowShow(window);
+  // The first wait only finds out where the display is.
+  if (!PlatformWindowWaitForNextFrame(window)) {
+    state.SkipWithError("Frame pacing is not supported.");
+    PlatformWindowDestroyWindow(window);
+    return;
+  }
+  PlatformWindowFrameTiming first;
+  PlatformWindowGetFrameTiming(window, &first);
+
+  int64_t total_latency_ns = 0;
+  int64_t frames = 0;
+  PlatformWindowFrameTiming timing = first;
+  for (auto _ : state) {
+    PlatformWindowWaitForNextFrame(window);
+    // Frame timings are on the steady clock, like event timestamps.
+    const int64_t now_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    PlatformWindowGetFrameTiming(window, &timing);
+    total_latency_ns += now_ns - timing.vblank_time_ns;
+    ++frames;
+  }
+  state.counters["wake_up_latency_us"] =
+      frames ? total_latency_ns / frames / 1000.0 : 0.0;
+  state.counters["refresh_interval_us"] = timing.refresh_interval_ns / 1000.0;
+  state.counters["missed_frames"] = static_cast<double>(
+      timing.missed_frames - first.missed_frames);
+
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK_CAPTURE(BM_WaitForNextFrame, event_thread,
+                  uint32_t{kPlatformWindowFlagsNone})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_WaitForNextFrame, no_event_thread,
+                  uint32_t{kPlatformWindowFlagNoEventThread})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+}  // namespace
@@ -0,0 +1,58 @@
+// Per-key cost of the table-free parts of X11 key translation. Needs no X
+// server.
+
+#include <X11/keysym.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "x11_keycode_table.h"
+
+namespace {
+// The keysyms of every keycode that has a default, which covers the common
+// keys that the switch in KeysymToPlatformWindowKey() has to get through.
+std::vector<KeySym> DefaultKeysyms() {
+  std::vector<KeySym> keysyms;
+  for (uint32_t keycode = 0; keycode < 256; ++keycode) {
+    uint32_t keysym = platform_window::HardwareKeycodeToDefaultXKeysym(keycode);
+    if (keysym != 0) {
+      keysyms.push_back(keysym);
+    }
+  }
+  return keysyms;
+}
+
+void BM_KeysymToPlatformWindowKey(benchmark::State& state) {
+  const std::vector<KeySym> keysyms = DefaultKeysyms();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        platform_window::KeysymToPlatformWindowKey(keysyms[i]));
+    i = (i + 1) % keysyms.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_KeysymToPlatformWindowKey);
+
+void BM_KeysymToPlatformWindowKeyUnknown(benchmark::State& state) {
+  // Misses fall all the way through the switch.
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        platform_window::KeysymToPlatformWindowKey(XK_VoidSymbol));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_KeysymToPlatformWindowKeyUnknown);
+
+void BM_HardwareKeycodeToDefaultXKeysym(benchmark::State& state) {
+  uint32_t keycode = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        platform_window::HardwareKeycodeToDefaultXKeysym(keycode));
+    keycode = (keycode + 1) & 0xff;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HardwareKeycodeToDefaultXKeysym);
+}  // namespace
@@ -0,0 +1,67 @@
+// Per-row cost of converting the application's pixels for
+// PlatformWindowSoftwarePresentImage(), for each format and each kernel this
+// CPU supports. Needs no X server.
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "pixel_conversion.h"
+
+namespace {
+using platform_window::PixelKernel;
+
+// A 1080p row.
+constexpr size_t kRowPixels = 1920;
+
+void BM_ConvertRow(benchmark::State& state,
+                   PlatformWindowSoftwarePixelFormat format,
+                   PixelKernel kernel) {
+  const platform_window::ConvertRowFunction convert =
+      platform_window::GetConvertRowFunction(format, kernel);
+  if (!convert) {
+    state.SkipWithError("Not supported by this CPU.");
+    return;
+  }
+  std::vector<uint8_t> source(
+      kRowPixels * platform_window::BytesPerPixel(format));
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = static_cast<uint8_t>(i * 31);
+  }
+  std::vector<uint32_t> destination(kRowPixels);
+  for (auto _ : state) {
+    convert(source.data(), destination.data(), kRowPixels);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * kRowPixels);
+  state.SetBytesProcessed(state.iterations() * source.size());
+}
+BENCHMARK_CAPTURE(BM_ConvertRow, xrgb8888,
+                  kPlatformWindowSoftwarePixelFormatXRGB8888,
+                  PixelKernel::kScalar);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgba8888_scalar,
+                  kPlatformWindowSoftwarePixelFormatRGBA8888,
+                  PixelKernel::kScalar);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgba8888_sse2,
+                  kPlatformWindowSoftwarePixelFormatRGBA8888,
+                  PixelKernel::kSse2);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgba8888_avx2,
+                  kPlatformWindowSoftwarePixelFormatRGBA8888,
+                  PixelKernel::kAvx2);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgba8888_neon,
+                  kPlatformWindowSoftwarePixelFormatRGBA8888,
+                  PixelKernel::kNeon);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgb565_scalar,
+                  kPlatformWindowSoftwarePixelFormatRGB565,
+                  PixelKernel::kScalar);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgb565_sse2,
+                  kPlatformWindowSoftwarePixelFormatRGB565,
+                  PixelKernel::kSse2);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgb565_avx2,
+                  kPlatformWindowSoftwarePixelFormatRGB565,
+                  PixelKernel::kAvx2);
+BENCHMARK_CAPTURE(BM_ConvertRow, rgb565_neon,
+                  kPlatformWindowSoftwarePixelFormatRGB565,
+                  PixelKernel::kNeon);
+}  // namespace
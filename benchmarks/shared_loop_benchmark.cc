@@ -0,0 +1,109 @@
+// Stress test of the X11 backend's two event loop modes: creates
+// state.range(0) windows, either each with its own display connection and
+// event thread or all sharing one (kPlatformWindowFlagSharedEventLoop), and
+// then destroys them. Counters report what the process holds while all of the
+// windows are alive, and what it still holds once they are gone.
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY. The
+// per-window mode opens one connection per window, so large counts may run
+// into the server's client limit (256 by default on Xorg).
+
+#include <benchmark/benchmark.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+
+namespace {
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+// Number of entries in a /proc/self directory, excluding "." and "..".
+int CountEntries(const char* path) {
+  DIR* dir = opendir(path);
+  if (!dir) {
+    return -1;
+  }
+  int count = 0;
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      ++count;
+    }
+  }
+  closedir(dir);
+  return count;
+}
+
+int64_t ResidentBytes() {
+  FILE* file = std::fopen("/proc/self/statm", "r");
+  if (!file) {
+    return -1;
+  }
+  long size_pages = 0;
+  long resident_pages = 0;
+  const int read = std::fscanf(file, "%ld %ld", &size_pages, &resident_pages);
+  std::fclose(file);
+  return read == 2 ? int64_t{resident_pages} * sysconf(_SC_PAGESIZE) : -1;
+}
+
+void BM_CreateDestroyManyWindows(benchmark::State& state, uint32_t flags) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  const int window_count = state.range(0);
+  std::vector<PlatformWindow> windows(window_count);
+
+  const int threads_before = CountEntries("/proc/self/task");
+  const int fds_before = CountEntries("/proc/self/fd");
+  const int64_t resident_before = ResidentBytes();
+  int threads_alive = 0;
+  int fds_alive = 0;
+  int64_t resident_alive = 0;
+  for (auto _ : state) {
+    for (PlatformWindow& window : windows) {
+      window = PlatformWindowMakeWindow("shared_loop_benchmark", flags,
+                                        &IgnoreEvent, nullptr);
+    }
+
+    state.PauseTiming();
+    threads_alive = CountEntries("/proc/self/task");
+    fds_alive = CountEntries("/proc/self/fd");
+    resident_alive = ResidentBytes();
+    state.ResumeTiming();
+
+    for (PlatformWindow window : windows) {
+      PlatformWindowDestroyWindow(window);
+    }
+  }
+
+  state.counters["threads_alive"] = threads_alive - threads_before;
+  state.counters["fds_alive"] = fds_alive - fds_before;
+  state.counters["rss_alive_kb"] = (resident_alive - resident_before) / 1024;
+  // Anything still held after the windows are destroyed, besides the
+  // process-wide connections created on first use, is a leak.
+  state.counters["threads_after"] =
+      CountEntries("/proc/self/task") - threads_before;
+  state.counters["fds_after"] = CountEntries("/proc/self/fd") - fds_before;
+  state.counters["windows_per_second"] = benchmark::Counter(
+      static_cast<double>(window_count) * state.iterations(),
+      benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_CreateDestroyManyWindows, per_window,
+                  uint32_t{kPlatformWindowFlagsNone})
+    ->Arg(16)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_CreateDestroyManyWindows, shared,
+                  uint32_t{kPlatformWindowFlagSharedEventLoop})
+    ->Arg(16)
+    ->Arg(128)
+    ->Arg(1024)
+    ->Arg(4096)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+}  // namespace
@@ -0,0 +1,145 @@
+// Frame rate of the software framebuffer with and without MIT-SHM, for the
+// window's default size (half the screen), and of presenting images that
+// change only in part, as most UIs do, against ones that change everywhere.
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+#include "platform_window/software.h"
+
+namespace {
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+void BM_AcquireDrawPresent(benchmark::State& state, uint32_t flags) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeDefaultWindow(
+      "software_benchmark", &IgnoreEvent, nullptr);
+  PlatformWindowShow(window);
+  PlatformWindowSoftwareFramebuffer framebuffer =
+      PlatformWindowSoftwareCreateFramebuffer(window, flags);
+  if (!framebuffer) {
+    state.SkipWithError("The display does not use 32-bit pixels.");
+    PlatformWindowDestroyWindow(window);
+    return;
+  }
+
+  uint32_t color = 0;
+  int64_t pixels_presented = 0;
+  for (auto _ : state) {
+    PlatformWindowSoftwareBuffer buffer;
+    if (!PlatformWindowSoftwareAcquireBuffer(framebuffer, &buffer)) {
+      state.SkipWithError("Could not allocate the buffers.");
+      break;
+    }
+    // Touch every pixel, as a renderer would.
+    for (int32_t y = 0; y < buffer.height; ++y) {
+      uint32_t* row = buffer.pixels + y * buffer.stride;
+      for (int32_t x = 0; x < buffer.width; ++x) {
+        row[x] = color;
+      }
+    }
+    color += 0x010101;
+    PlatformWindowSoftwarePresent(framebuffer);
+    pixels_presented += int64_t{buffer.width} * buffer.height;
+  }
+  state.SetBytesProcessed(pixels_presented * sizeof(uint32_t));
+  state.counters["shared_memory"] =
+      PlatformWindowSoftwareIsSharedMemory(framebuffer);
+
+  PlatformWindowSoftwareDestroyFramebuffer(framebuffer);
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK_CAPTURE(BM_AcquireDrawPresent, shared_memory,
+                  uint32_t{kPlatformWindowSoftwareFramebufferFlagsNone})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(
+    BM_AcquireDrawPresent, put_image,
+    uint32_t{kPlatformWindowSoftwareFramebufferFlagNoSharedMemory})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Presents a 1080p RGBA image in which a |damage_size| pixel square moves
+// around every frame, or which changes everywhere if |damage_size| is 0.
+void BM_PresentImage(benchmark::State& state, int32_t damage_size) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeDefaultWindow(
+      "software_benchmark", &IgnoreEvent, nullptr);
+  PlatformWindowShow(window);
+  PlatformWindowSoftwareFramebuffer framebuffer =
+      PlatformWindowSoftwareCreateFramebuffer(
+          window, kPlatformWindowSoftwareFramebufferFlagsNone);
+  if (!framebuffer) {
+    state.SkipWithError("The display does not use 32-bit pixels.");
+    PlatformWindowDestroyWindow(window);
+    return;
+  }
+
+  constexpr int32_t kWidth = 1920;
+  constexpr int32_t kHeight = 1080;
+  std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+  const PlatformWindowSoftwareImage image = {
+      pixels.data(), kPlatformWindowSoftwarePixelFormatRGBA8888, kWidth,
+      kHeight, kWidth * 4};
+
+  uint8_t value = 0;
+  int32_t x = 0;
+  uint64_t bytes_uploaded = 0;
+  uint64_t pixels_converted = 0;
+  uint64_t request_count = 0;
+  for (auto _ : state) {
+    PlatformWindowSoftwareRect damage = {x, x % (kHeight - damage_size),
+                                         damage_size, damage_size};
+    if (damage_size == 0) {
+      damage = {0, 0, kWidth, kHeight};
+    }
+    for (int32_t y = damage.y; y < damage.y + damage.height; ++y) {
+      std::fill_n(pixels.data() + (y * kWidth + damage.x) * 4,
+                  damage.width * 4, value);
+    }
+    ++value;
+    x = (x + 37) % (kWidth - damage_size);
+
+    PlatformWindowSoftwarePresentStats stats;
+    if (!PlatformWindowSoftwarePresentImage(framebuffer, &image, &damage, 1,
+                                            &stats)) {
+      state.SkipWithError("Could not allocate the buffers.");
+      break;
+    }
+    bytes_uploaded += stats.bytes_uploaded;
+    pixels_converted += stats.pixels_converted;
+    request_count += stats.request_count;
+  }
+  state.counters["bytes_uploaded"] =
+      benchmark::Counter(bytes_uploaded, benchmark::Counter::kAvgIterations);
+  state.counters["pixels_converted"] =
+      benchmark::Counter(pixels_converted, benchmark::Counter::kAvgIterations);
+  state.counters["requests"] =
+      benchmark::Counter(request_count, benchmark::Counter::kAvgIterations);
+
+  PlatformWindowSoftwareDestroyFramebuffer(framebuffer);
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK_CAPTURE(BM_PresentImage, full, 0)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PresentImage, damage_64, 64)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_PresentImage, damage_256, 256)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+}  // namespace
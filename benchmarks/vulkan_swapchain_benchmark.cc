@@ -0,0 +1,256 @@
+// Frame rate of the Vulkan swapchain helper, clearing every frame of a window
+// of the default size (half the screen), in low latency and in FIFO mode.
+// Works with any driver that can present to the window, including lavapipe,
+// which is picked by pointing VK_ICD_FILENAMES at its manifest (e.g.
+// /usr/share/vulkan/icd.d/lvp_icd.x86_64.json).
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY.
+
+#include <benchmark/benchmark.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+#include "platform_window/vulkan.h"
+#include "platform_window/vulkan_swapchain.h"
+
+namespace {
+constexpr uint32_t kFramesInFlight = 2;
+
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+struct VulkanContext {
+  VkInstance instance = VK_NULL_HANDLE;
+  VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+  uint32_t queue_family_index = 0;
+  VkDevice device = VK_NULL_HANDLE;
+  VkQueue queue = VK_NULL_HANDLE;
+  VkCommandPool command_pool = VK_NULL_HANDLE;
+};
+
+// Sets up |context| with the first device that has a graphics queue which can
+// present to |window|. Returns an error message on failure.
+const char* CreateContext(PlatformWindow window, VulkanContext* context) {
+  VkInstanceCreateInfo instance_info{};
+  instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+  instance_info.enabledExtensionCount = static_cast<uint32_t>(
+      PlatformWindowVulkanGetRequiredInstanceExtensionsCount());
+  instance_info.ppEnabledExtensionNames =
+      PlatformWindowVulkanGetRequiredInstanceExtensions();
+  if (vkCreateInstance(&instance_info, nullptr, &context->instance) !=
+      VK_SUCCESS) {
+    return "Could not create a Vulkan instance.";
+  }
+
+  uint32_t count = 0;
+  vkEnumeratePhysicalDevices(context->instance, &count, nullptr);
+  std::vector<VkPhysicalDevice> physical_devices(count);
+  vkEnumeratePhysicalDevices(context->instance, &count,
+                             physical_devices.data());
+  for (VkPhysicalDevice physical_device : physical_devices) {
+    uint32_t family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count,
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &family_count,
+                                             families.data());
+    for (uint32_t i = 0; i < family_count; ++i) {
+      if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+          PlatformWindowVulkanGetPresentationSupport(physical_device, i,
+                                                     window)) {
+        context->physical_device = physical_device;
+        context->queue_family_index = i;
+        break;
+      }
+    }
+    if (context->physical_device != VK_NULL_HANDLE) {
+      break;
+    }
+  }
+  if (context->physical_device == VK_NULL_HANDLE) {
+    return "No Vulkan device can present to the window.";
+  }
+
+  const float queue_priority = 1.0f;
+  VkDeviceQueueCreateInfo queue_info{};
+  queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+  queue_info.queueFamilyIndex = context->queue_family_index;
+  queue_info.queueCount = 1;
+  queue_info.pQueuePriorities = &queue_priority;
+  const char* const device_extension = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+  VkDeviceCreateInfo device_info{};
+  device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  device_info.queueCreateInfoCount = 1;
+  device_info.pQueueCreateInfos = &queue_info;
+  device_info.enabledExtensionCount = 1;
+  device_info.ppEnabledExtensionNames = &device_extension;
+  if (vkCreateDevice(context->physical_device, &device_info, nullptr,
+                     &context->device) != VK_SUCCESS) {
+    return "Could not create a Vulkan device.";
+  }
+  vkGetDeviceQueue(context->device, context->queue_family_index, 0,
+                   &context->queue);
+
+  VkCommandPoolCreateInfo pool_info{};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  pool_info.queueFamilyIndex = context->queue_family_index;
+  if (vkCreateCommandPool(context->device, &pool_info, nullptr,
+                          &context->command_pool) != VK_SUCCESS) {
+    return "Could not create a command pool.";
+  }
+  return nullptr;
+}
+
+void DestroyContext(VulkanContext* context) {
+  if (context->device != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(context->device, context->command_pool, nullptr);
+    vkDestroyDevice(context->device, nullptr);
+  }
+  if (context->instance != VK_NULL_HANDLE) {
+    vkDestroyInstance(context->instance, nullptr);
+  }
+}
+
+// Records a clear of |frame|'s image to grey |value|, leaving the image ready
+// to be presented.
+void RecordClear(VkCommandBuffer command_buffer,
+                 const PlatformWindowVulkanFrame& frame, float value) {
+  VkCommandBufferBeginInfo begin_info{};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(command_buffer, &begin_info);
+
+  const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0,
+                                         1};
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = frame.image;
+  barrier.subresourceRange = range;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkClearColorValue color;
+  color.float32[0] = color.float32[1] = color.float32[2] = value;
+  color.float32[3] = 1.0f;
+  vkCmdClearColorImage(command_buffer, frame.image,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1,
+                       &range);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+  vkEndCommandBuffer(command_buffer);
+}
+
+void BM_ClearAndPresent(benchmark::State& state, uint32_t flags) {
+  if (std::getenv("DISPLAY") == nullptr) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  PlatformWindow window = PlatformWindowMakeDefaultWindow(
+      "vulkan_swapchain_benchmark", &IgnoreEvent, nullptr);
+  PlatformWindowShow(window);
+
+  VulkanContext context;
+  PlatformWindowVulkanSwapchain swapchain = nullptr;
+  if (const char* error = CreateContext(window, &context)) {
+    state.SkipWithError(error);
+  } else {
+    PlatformWindowVulkanSwapchainCreateInfo info{};
+    info.instance = context.instance;
+    info.physical_device = context.physical_device;
+    info.device = context.device;
+    info.present_queue = context.queue;
+    info.window = window;
+    info.flags = flags;
+    info.frames_in_flight = kFramesInFlight;
+    info.image_usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (PlatformWindowVulkanCreateSwapchain(&info, &swapchain) != VK_SUCCESS) {
+      state.SkipWithError("Could not create the swapchain.");
+    }
+  }
+  if (swapchain == nullptr) {
+    DestroyContext(&context);
+    PlatformWindowDestroyWindow(window);
+    return;
+  }
+
+  VkCommandBuffer command_buffers[kFramesInFlight];
+  VkCommandBufferAllocateInfo allocate_info{};
+  allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocate_info.commandPool = context.command_pool;
+  allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocate_info.commandBufferCount = kFramesInFlight;
+  vkAllocateCommandBuffers(context.device, &allocate_info, command_buffers);
+
+  float value = 0.0f;
+  int64_t frames = 0;
+  int64_t recreations = 0;
+  for (auto _ : state) {
+    PlatformWindowVulkanFrame frame;
+    const VkResult result = PlatformWindowVulkanAcquireFrame(swapchain, &frame);
+    if (result == VK_NOT_READY) {
+      // Not mapped yet.
+      continue;
+    }
+    if (result != VK_SUCCESS) {
+      state.SkipWithError("Could not acquire a frame.");
+      break;
+    }
+    recreations += frame.recreated;
+
+    VkCommandBuffer command_buffer =
+        command_buffers[frame.frame_in_flight_index];
+    vkResetCommandBuffer(command_buffer, 0);
+    RecordClear(command_buffer, frame, value);
+    value = value < 1.0f ? value + 1.0f / 64 : 0.0f;
+
+    const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.waitSemaphoreCount = 1;
+    submit_info.pWaitSemaphores = &frame.image_available;
+    submit_info.pWaitDstStageMask = &wait_stage;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &frame.render_finished;
+    if (vkQueueSubmit(context.queue, 1, &submit_info, frame.in_flight_fence) !=
+            VK_SUCCESS ||
+        PlatformWindowVulkanPresent(swapchain) != VK_SUCCESS) {
+      state.SkipWithError("Could not submit the frame.");
+      break;
+    }
+    ++frames;
+  }
+  state.SetItemsProcessed(frames);
+  state.counters["recreations"] = recreations;
+
+  PlatformWindowVulkanDestroySwapchain(swapchain);
+  DestroyContext(&context);
+  PlatformWindowDestroyWindow(window);
+}
+BENCHMARK_CAPTURE(BM_ClearAndPresent, low_latency,
+                  uint32_t{kPlatformWindowVulkanSwapchainFlagsNone})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ClearAndPresent, fifo,
+                  uint32_t{kPlatformWindowVulkanSwapchainFlagFifo})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+}  // namespace
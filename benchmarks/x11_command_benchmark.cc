@@ -0,0 +1,123 @@
+// Compares the per-call latency of the X11 window setters against the old
+// approach of opening a fresh display connection for every request.
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY.
+
+#include <X11/Xlib.h>
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+
+#include "platform_window/platform_window.h"
+
+namespace {
+class ScopedWindow {
+ public:
+  ScopedWindow()
+      : window_(std::getenv("DISPLAY") == nullptr
+                    ? INVALID_PLATFORM_WINDOW
+                    : PlatformWindowMakeDefaultWindow(
+                          "x11_command_benchmark",
+                          [](void*, PlatformWindowEvent) {}, nullptr)) {}
+  ~ScopedWindow() {
+    if (window_ != INVALID_PLATFORM_WINDOW) {
+      PlatformWindowDestroyWindow(window_);
+    }
+  }
+
+  PlatformWindow window() const { return window_; }
+  Window native_window() const {
+    return reinterpret_cast<Window>(PlatformWindowGetNativeWindow(window_));
+  }
+
+ private:
+  PlatformWindow window_;
+};
+
+void BM_SetTitlePerCallConnection(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    Display* display = XOpenDisplay(NULL);
+    XStoreName(display, window.native_window(), "title");
+    XFlush(display);
+    XCloseDisplay(display);
+  }
+}
+BENCHMARK(BM_SetTitlePerCallConnection);
+
+void BM_SetTitle(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    PlatformWindowSetTitle(window.window(), "title");
+  }
+}
+BENCHMARK(BM_SetTitle);
+
+void BM_ShowHidePerCallConnection(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    Display* display = XOpenDisplay(NULL);
+    XMapWindow(display, window.native_window());
+    XFlush(display);
+    XCloseDisplay(display);
+    display = XOpenDisplay(NULL);
+    XUnmapWindow(display, window.native_window());
+    XFlush(display);
+    XCloseDisplay(display);
+  }
+}
+BENCHMARK(BM_ShowHidePerCallConnection);
+
+void BM_ShowHide(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    PlatformWindowShow(window.window());
+    PlatformWindowHide(window.window());
+  }
+}
+BENCHMARK(BM_ShowHide);
+
+void BM_GetSizePerCallConnection(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    Display* display = XOpenDisplay(NULL);
+    XWindowAttributes attributes;
+    XGetWindowAttributes(display, window.native_window(), &attributes);
+    XCloseDisplay(display);
+    benchmark::DoNotOptimize(attributes.width);
+  }
+}
+BENCHMARK(BM_GetSizePerCallConnection);
+
+void BM_GetSize(benchmark::State& state) {
+  ScopedWindow window;
+  if (window.window() == INVALID_PLATFORM_WINDOW) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(PlatformWindowGetSize(window.window()));
+  }
+}
+BENCHMARK(BM_GetSize);
+}  // namespace
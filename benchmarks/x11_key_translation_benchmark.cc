@@ -0,0 +1,69 @@
+// Compares key event translation through XLookupString and the keysym switch
+// against the precomputed KeycodeTable.
+//
+// Requires a running X server (e.g. Xvfb) reachable through $DISPLAY.
+
+#include <X11/Xlib.h>
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "x11_key_translation.h"
+
+namespace {
+// Key press events for every keycode in the server's keyboard mapping.
+std::vector<XKeyEvent> MakeKeyEvents(Display* display) {
+  int min_keycode = 0;
+  int max_keycode = 0;
+  XDisplayKeycodes(display, &min_keycode, &max_keycode);
+
+  std::vector<XKeyEvent> events;
+  for (int keycode = min_keycode; keycode <= max_keycode; ++keycode) {
+    XKeyEvent event = {};
+    event.type = KeyPress;
+    event.display = display;
+    event.keycode = keycode;
+    events.push_back(event);
+  }
+  return events;
+}
+
+void BM_XLookupStringTranslation(benchmark::State& state) {
+  Display* display = XOpenDisplay(NULL);
+  if (!display) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  std::vector<XKeyEvent> events = MakeKeyEvents(display);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        platform_window::XKeyEventToPlatformWindowKey(&events[i]));
+    i = (i + 1) % events.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  XCloseDisplay(display);
+}
+BENCHMARK(BM_XLookupStringTranslation);
+
+void BM_KeycodeTableTranslation(benchmark::State& state) {
+  Display* display = XOpenDisplay(NULL);
+  if (!display) {
+    state.SkipWithError("No X display available.");
+    return;
+  }
+  std::vector<XKeyEvent> events = MakeKeyEvents(display);
+  const std::unique_ptr<platform_window::KeycodeTable> table =
+      platform_window::MakeKeycodeTable(display);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        platform_window::TranslateKeyEvent(*table, &events[i]));
+    i = (i + 1) % events.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  XCloseDisplay(display);
+}
+BENCHMARK(BM_KeycodeTableTranslation);
+}  // namespace
@@ -19,7 +19,17 @@ def Build(registry, out_dir, platform, configured_toolchain, stdext_modules):
     platform_window_build_kwargs = {
       'sources': [
         'platform_window_win32.cc',
+        'event_coalescer.h',
+        'event_dispatcher.h',
+        'event_queue.h',
+        'event_recorder.cc',
+        'event_recorder.h',
+        'event_stats.h',
+        'event_time.h',
+        'include/platform_window/event_loop.h',
+        'include/platform_window/frame_timing.h',
         'include/platform_window/platform_window.h',
+        'include/platform_window/recording.h',
       ],
       'public_include_paths': [
         'include',
@@ -49,24 +59,82 @@ def Build(registry, out_dir, platform, configured_toolchain, stdext_modules):
   elif platform == 'linux':
     platform_window_build_kwargs = {
       'sources': [
+        'flat_window_map.h',
         'platform_window_x11.cc',
+        'resize_tracker.h',
+        'x11_key_translation.cc',
+        'x11_key_translation.h',
+        'x11_keycode_table.cc',
+        'x11_keycode_table.h',
+        'event_coalescer.h',
+        'event_dispatcher.h',
+        'event_queue.h',
+        'event_recorder.cc',
+        'event_recorder.h',
+        'event_stats.h',
+        'event_time.h',
+        'include/platform_window/event_loop.h',
+        'include/platform_window/frame_timing.h',
         'include/platform_window/platform_window.h',
+        'include/platform_window/recording.h',
+        'include/platform_window/x11.h',
       ],
       'public_include_paths': [
         'include',
       ],
       'system_libraries': [
         'X11',
+        'X11-xcb',
+        'Xext',
+        'Xi',
+        'Xpresent',
+      ]
+    }
+  elif platform == 'linux_xcb':
+    platform_window_build_kwargs = {
+      'sources': [
+        'platform_window_xcb.cc',
+        'x11_keycode_table.cc',
+        'x11_keycode_table.h',
+        'event_coalescer.h',
+        'event_dispatcher.h',
+        'event_queue.h',
+        'event_recorder.cc',
+        'event_recorder.h',
+        'event_stats.h',
+        'event_time.h',
+        'include/platform_window/event_loop.h',
+        'include/platform_window/frame_timing.h',
+        'include/platform_window/platform_window.h',
+        'include/platform_window/recording.h',
+        'include/platform_window/x11.h',
+      ],
+      'public_include_paths': [
+        'include',
+      ],
+      'system_libraries': [
+        'xcb',
       ]
     }
   elif platform == 'jetson':
-    # We use a stub window for Jetson because it follows the EGLDevice/EGLOutput
-    # path, which doesn't have the concept of "window"s and doesn't go through
-    # eglCreateWindowSurface.
+    # We use the headless window for Jetson because it follows the
+    # EGLDevice/EGLOutput path, which doesn't have the concept of "window"s and
+    # doesn't go through eglCreateWindowSurface.
     platform_window_build_kwargs = {
       'sources': [
         'platform_window_stub.cc',
+        'event_coalescer.h',
+        'event_dispatcher.h',
+        'event_queue.h',
+        'event_recorder.cc',
+        'event_recorder.h',
+        'event_stats.h',
+        'event_time.h',
+        'include/platform_window/headless.h',
+        'include/platform_window/event_loop.h',
+        'include/platform_window/frame_timing.h',
         'include/platform_window/platform_window.h',
+        'include/platform_window/recording.h',
       ],
       'public_include_paths': [
         'include',
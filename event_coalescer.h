@@ -0,0 +1,103 @@
+#ifndef _PLATFORM_WINDOW_EVENT_COALESCER_H_
+#define _PLATFORM_WINDOW_EVENT_COALESCER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// Implements kPlatformWindowFlagCoalesceMotion for backends that collect
+// events into batches: a mouse move or mouse wheel event that directly
+// follows one of the same type in the batch is merged into it. Since only
+// adjacent events are merged, ordering relative to key and button events is
+// preserved.
+//
+// Raw mouse motion is summed whether or not coalescing is enabled, since
+// adding up deltas loses nothing.
+class EventCoalescer {
+ public:
+  explicit EventCoalescer(bool enabled) : enabled_(enabled) {}
+
+  // Must only be called from one thread at a time.
+  void Append(const PlatformWindowTimedEvent& event,
+              std::vector<PlatformWindowTimedEvent>* events) {
+    if (event.event.type == kPlatformWindowEventTypeRawMouseMotion) {
+      AppendRawMouseMotion(event, events);
+      return;
+    }
+    if (enabled_ && !events->empty() &&
+        events->back().event.type == event.event.type) {
+      // The merged event takes on the timestamps of the newest event.
+      PlatformWindowTimedEvent* last = &events->back();
+      const PlatformWindowEventData& data = event.event.data;
+      if (event.event.type == kPlatformWindowEventTypeMouseMove) {
+        last->event.data.mouse_move = data.mouse_move;
+        last->timestamp_ns = event.timestamp_ns;
+        last->received_ns = event.received_ns;
+        Increment(&mouse_move_events_merged_);
+        return;
+      } else if (event.event.type == kPlatformWindowEventTypeMouseWheel) {
+        last->event.data.mouse_wheel.angle_in_degrees +=
+            data.mouse_wheel.angle_in_degrees;
+        last->event.data.mouse_wheel.x = data.mouse_wheel.x;
+        last->event.data.mouse_wheel.y = data.mouse_wheel.y;
+        last->timestamp_ns = event.timestamp_ns;
+        last->received_ns = event.received_ns;
+        Increment(&mouse_wheel_events_merged_);
+        return;
+      }
+    }
+    events->push_back(event);
+  }
+
+  PlatformWindowCoalescingStats stats() const {
+    return {mouse_move_events_merged_.load(std::memory_order_relaxed),
+            mouse_wheel_events_merged_.load(std::memory_order_relaxed)};
+  }
+  uint64_t total_merged() const {
+    PlatformWindowCoalescingStats merged = stats();
+    return merged.mouse_move_events_merged + merged.mouse_wheel_events_merged;
+  }
+
+ private:
+  // Platforms interleave raw motion with the resulting pointer moves, so the
+  // previous raw motion event is looked for past any moves. Anything else
+  // ends the search, keeping raw motion ordered relative to e.g. buttons.
+  static void AppendRawMouseMotion(
+      const PlatformWindowTimedEvent& event,
+      std::vector<PlatformWindowTimedEvent>* events) {
+    for (auto it = events->rbegin(); it != events->rend(); ++it) {
+      if (it->event.type == kPlatformWindowEventTypeRawMouseMotion) {
+        PlatformWindowEventDataRawMouseMotion* raw =
+            &it->event.data.raw_mouse_motion;
+        raw->dx += event.event.data.raw_mouse_motion.dx;
+        raw->dy += event.event.data.raw_mouse_motion.dy;
+        raw->sample_count += event.event.data.raw_mouse_motion.sample_count;
+        it->timestamp_ns = event.timestamp_ns;
+        it->received_ns = event.received_ns;
+        return;
+      }
+      if (it->event.type != kPlatformWindowEventTypeMouseMove) {
+        break;
+      }
+    }
+    events->push_back(event);
+  }
+
+  // Single writer, so no read-modify-write is needed.
+  static void Increment(std::atomic<uint64_t>* counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
+  const bool enabled_;
+  std::atomic<uint64_t> mouse_move_events_merged_ = 0;
+  std::atomic<uint64_t> mouse_wheel_events_merged_ = 0;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_COALESCER_H_
@@ -0,0 +1,156 @@
+#ifndef _PLATFORM_WINDOW_EVENT_DISPATCHER_H_
+#define _PLATFORM_WINDOW_EVENT_DISPATCHER_H_
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "event_queue.h"
+#include "event_recorder.h"
+#include "event_stats.h"
+#include "event_time.h"
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// Shared by the backends to forward translated events to the user. Everything
+// goes through the timed batch path; batch and single event callbacks are
+// supported by adapters that strip the timestamps and, for the latter, loop
+// over the batch. In polling mode the batch is pushed into an EventQueue
+// instead of being handed to a callback.
+class EventDispatcher {
+ public:
+  EventDispatcher(PlatformWindowTimedBatchEventCallback timed_batch_callback,
+                  void* context)
+      : timed_batch_callback_(timed_batch_callback),
+        timed_batch_context_(context) {}
+  EventDispatcher(PlatformWindowBatchEventCallback batch_callback,
+                  void* context)
+      : timed_batch_callback_(&EventDispatcher::DispatchBatch),
+        timed_batch_context_(this),
+        batch_callback_(batch_callback),
+        context_(context) {}
+  EventDispatcher(PlatformWindowEventCallback event_callback, void* context)
+      : timed_batch_callback_(&EventDispatcher::DispatchEach),
+        timed_batch_context_(this),
+        event_callback_(event_callback),
+        context_(context) {}
+  explicit EventDispatcher(std::unique_ptr<EventQueue> queue)
+      : timed_batch_callback_(&EventDispatcher::PushToQueue),
+        timed_batch_context_(this),
+        queue_(std::move(queue)) {}
+
+  // |timed_batch_context_| may point at this object, so it must stay put.
+  EventDispatcher(const EventDispatcher&) = delete;
+  EventDispatcher& operator=(const EventDispatcher&) = delete;
+
+  // Must only be called from one thread at a time.
+  void Dispatch(const PlatformWindowTimedEvent* events, size_t count) {
+    if (recording_.load(std::memory_order_relaxed)) {
+      Record(events, count);
+    }
+    if (stats_.enabled()) {
+      const int64_t start_ns = MonotonicNowNs();
+      stats_.RecordDispatch(events, count, start_ns);
+      timed_batch_callback_(timed_batch_context_, events, count);
+      stats_.RecordCallbackTime(MonotonicNowNs() - start_ns);
+    } else {
+      timed_batch_callback_(timed_batch_context_, events, count);
+    }
+  }
+  void Dispatch(const PlatformWindowTimedEvent& event) { Dispatch(&event, 1); }
+
+  // Starts recording every dispatched batch to |recorder|, or stops recording
+  // if it is null. May be called from any thread.
+  void SetRecorder(std::unique_ptr<EventRecorder> recorder) {
+    std::lock_guard<std::mutex> lock(recorder_mutex_);
+    recorder_ = std::move(recorder);
+    recording_.store(recorder_ != nullptr, std::memory_order_relaxed);
+  }
+
+  // Only non-null if the window was created with
+  // kPlatformWindowFlagPollEvents.
+  EventQueue* queue() const { return queue_.get(); }
+
+  EventStats* stats() { return &stats_; }
+
+  // Fills in |stats|, with |events_coalesced| supplied by the backend.
+  void GetStats(uint64_t events_coalesced, PlatformWindowStats* stats) const {
+    stats_.Get(stats);
+    stats->events_dropped = queue_ ? queue_->dropped() : 0;
+    stats->events_coalesced = events_coalesced;
+  }
+
+ private:
+  void Record(const PlatformWindowTimedEvent* events, size_t count) {
+    std::lock_guard<std::mutex> lock(recorder_mutex_);
+    if (recorder_) {
+      recorder_->Record(events, count);
+    }
+  }
+
+  static void DispatchBatch(void* context,
+                            const PlatformWindowTimedEvent* events,
+                            size_t count) {
+    EventDispatcher* dispatcher = static_cast<EventDispatcher*>(context);
+    dispatcher->untimed_events_.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+      dispatcher->untimed_events_[i] = events[i].event;
+    }
+    dispatcher->batch_callback_(dispatcher->context_,
+                                dispatcher->untimed_events_.data(), count);
+  }
+  static void DispatchEach(void* context,
+                           const PlatformWindowTimedEvent* events,
+                           size_t count) {
+    EventDispatcher* dispatcher = static_cast<EventDispatcher*>(context);
+    for (size_t i = 0; i < count; ++i) {
+      dispatcher->event_callback_(dispatcher->context_, events[i].event);
+    }
+  }
+  static void PushToQueue(void* context,
+                          const PlatformWindowTimedEvent* events,
+                          size_t count) {
+    static_cast<EventDispatcher*>(context)->queue_->Push(events, count);
+  }
+
+  PlatformWindowTimedBatchEventCallback timed_batch_callback_;
+  void* timed_batch_context_;
+
+  PlatformWindowBatchEventCallback batch_callback_ = nullptr;
+  PlatformWindowEventCallback event_callback_ = nullptr;
+  void* context_ = nullptr;
+  // Scratch space for stripping timestamps before calling |batch_callback_|.
+  std::vector<PlatformWindowEvent> untimed_events_;
+
+  std::unique_ptr<EventQueue> queue_;
+
+  EventStats stats_;
+
+  // Checked on every dispatch so that the lock is only taken while recording.
+  std::atomic<bool> recording_ = false;
+  std::mutex recorder_mutex_;
+  std::unique_ptr<EventRecorder> recorder_;
+};
+
+// Creates the dispatcher matching |flags|, ignoring |callback| if the window
+// is to be polled.
+template <typename Callback>
+std::unique_ptr<EventDispatcher> MakeEventDispatcher(uint32_t flags,
+                                                     Callback callback,
+                                                     void* context) {
+  std::unique_ptr<EventDispatcher> dispatcher =
+      (flags & kPlatformWindowFlagPollEvents)
+          ? std::make_unique<EventDispatcher>(std::make_unique<EventQueue>())
+          : std::make_unique<EventDispatcher>(callback, context);
+  if (flags & kPlatformWindowFlagCollectStats) {
+    dispatcher->stats()->Enable();
+  }
+  return dispatcher;
+}
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_DISPATCHER_H_
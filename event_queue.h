@@ -0,0 +1,137 @@
+#ifndef _PLATFORM_WINDOW_EVENT_QUEUE_H_
+#define _PLATFORM_WINDOW_EVENT_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// A bounded, lock-free, single-producer/single-consumer ring buffer of events.
+// The backend's event thread is the only producer and the application thread
+// calling PlatformWindowPollEvents() is the only consumer. Pushing and popping
+// never take a lock; the mutex is only touched when the consumer has to go to
+// sleep in Wait() and the producer has to wake it up.
+class EventQueue {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  // |capacity| must be a power of two.
+  explicit EventQueue(size_t capacity = kDefaultCapacity)
+      : mask_(capacity - 1), events_(capacity) {
+    assert(capacity > 0 && (capacity & mask_) == 0);
+  }
+
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
+
+  // Called from the producer thread only. Events that do not fit are dropped
+  // and counted, rather than blocking the event thread.
+  void Push(const PlatformWindowTimedEvent* events, size_t count) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const size_t available = events_.size() - static_cast<size_t>(tail - head);
+    const size_t pushed = count < available ? count : available;
+    for (size_t i = 0; i < pushed; ++i) {
+      events_[(tail + i) & mask_] = events[i];
+    }
+    if (pushed < count) {
+      dropped_.fetch_add(count - pushed, std::memory_order_relaxed);
+    }
+    if (pushed == 0) {
+      return;
+    }
+
+    // Sequentially consistent, so that either the consumer sees the new tail
+    // before going to sleep or we see that it is waiting.
+    tail_.store(tail + pushed, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      condition_.notify_all();
+    }
+  }
+
+  // Called from the consumer thread only. Copies up to |max_count| events into
+  // |out| and returns how many were copied.
+  size_t Pop(PlatformWindowTimedEvent* out, size_t max_count) {
+    return PopWith(max_count,
+                   [out](size_t i, const PlatformWindowTimedEvent& event) {
+                     out[i] = event;
+                   });
+  }
+  size_t Pop(PlatformWindowEvent* out, size_t max_count) {
+    return PopWith(max_count,
+                   [out](size_t i, const PlatformWindowTimedEvent& event) {
+                     out[i] = event.event;
+                   });
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_relaxed) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Blocks until at least one event is queued, or until |timeout| elapses.
+  // A negative timeout waits forever. Returns true if events are queued.
+  bool Wait(std::chrono::milliseconds timeout) {
+    if (!empty()) {
+      return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    auto has_events = [this] {
+      return head_.load(std::memory_order_relaxed) !=
+             tail_.load(std::memory_order_seq_cst);
+    };
+    bool result;
+    if (timeout.count() < 0) {
+      condition_.wait(lock, has_events);
+      result = true;
+    } else {
+      result = condition_.wait_for(lock, timeout, has_events);
+    }
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+    return result;
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  template <typename F>
+  size_t PopWith(size_t max_count, F&& copy) {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    const size_t queued = static_cast<size_t>(tail - head);
+    const size_t popped = max_count < queued ? max_count : queued;
+    for (size_t i = 0; i < popped; ++i) {
+      copy(i, events_[(head + i) & mask_]);
+    }
+    head_.store(head + popped, std::memory_order_release);
+    return popped;
+  }
+
+  const size_t mask_;
+  std::vector<PlatformWindowTimedEvent> events_;
+
+  // Kept on separate cache lines so that the producer and consumer don't
+  // contend on them.
+  alignas(64) std::atomic<uint64_t> head_ = 0;
+  alignas(64) std::atomic<uint64_t> tail_ = 0;
+  alignas(64) std::atomic<uint64_t> dropped_ = 0;
+
+  std::atomic<int> waiters_ = 0;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_QUEUE_H_
@@ -0,0 +1,386 @@
+#include "event_recorder.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "event_time.h"
+#include "platform_window/recording.h"
+
+namespace platform_window {
+
+namespace {
+// The fixed part of the header, before the per-type sizes.
+const size_t kHeaderSize = sizeof(EventRecorder::kMagic) + 3 * sizeof(uint32_t);
+// Must be kept up to date as event types are added.
+const uint32_t kEventTypeCount = kPlatformWindowEventTypeVisibilityChanged + 1;
+
+// The size of the member of PlatformWindowEventData that is live for |type|.
+// Copying only that much keeps uninitialized bytes of the rest of the union
+// out of the file.
+size_t EventDataSize(PlatformWindowEventType type) {
+  switch (type) {
+    case kPlatformWindowEventTypeNoEvent:
+    case kPlatformWindowEventTypeQuitRequest:
+      return 0;
+    case kPlatformWindowEventTypeResized:
+    case kPlatformWindowEventTypeResizeStarted:
+    case kPlatformWindowEventTypeResizeEnded:
+      return sizeof(PlatformWindowEventDataResized);
+    case kPlatformWindowEventTypeMouseMove:
+      return sizeof(PlatformWindowEventDataMouseMove);
+    case kPlatformWindowEventTypeMouseButton:
+      return sizeof(PlatformWindowEventDataMouseButton);
+    case kPlatformWindowEventTypeMouseWheel:
+      return sizeof(PlatformWindowEventDataMouseWheel);
+    case kPlatformWindowEventTypeKey:
+      return sizeof(PlatformWindowEventDataKeyEvent);
+    case kPlatformWindowEventTypeRawMouseMotion:
+      return sizeof(PlatformWindowEventDataRawMouseMotion);
+    case kPlatformWindowEventTypeMoved:
+      return sizeof(PlatformWindowEventDataMoved);
+    case kPlatformWindowEventTypeExpose:
+      return sizeof(PlatformWindowEventDataExpose);
+    case kPlatformWindowEventTypeFocusChanged:
+      return sizeof(PlatformWindowEventDataFocusChanged);
+    case kPlatformWindowEventTypeVisibilityChanged:
+      return sizeof(PlatformWindowEventDataVisibilityChanged);
+  }
+  return sizeof(PlatformWindowEventData);
+}
+
+// Copies the live member of |data| for |type| to |bytes| with the padding
+// inside it zeroed, since backends fill in events field by field, and returns
+// its size.
+size_t CopyEventData(PlatformWindowEventType type,
+                     const PlatformWindowEventData& data, uint8_t* bytes) {
+  const size_t size = EventDataSize(type);
+  memcpy(bytes, &data, size);
+  switch (type) {
+    case kPlatformWindowEventTypeMouseButton: {
+      using Data = PlatformWindowEventDataMouseButton;
+      const size_t begin = offsetof(Data, pressed) + sizeof(bool);
+      memset(bytes + begin, 0, offsetof(Data, x) - begin);
+    } break;
+    case kPlatformWindowEventTypeKey: {
+      using Data = PlatformWindowEventDataKeyEvent;
+      const size_t begin = offsetof(Data, pressed) + sizeof(bool);
+      memset(bytes + begin, 0, offsetof(Data, key) - begin);
+    } break;
+    default:
+      break;
+  }
+  return size;
+}
+
+void WriteUint32(uint32_t value, FILE* file) {
+  uint8_t bytes[4] = {
+      static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+      static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24)};
+  fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+uint32_t ReadUint32(const uint8_t* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// A read-only view of a whole file.
+class MappedFile {
+ public:
+  explicit MappedFile(const char* path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Null if the file could not be mapped.
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+#if defined(_WIN32)
+MappedFile::MappedFile(const char* path) {
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      data_ = static_cast<const uint8_t*>(
+          MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+      if (data_) {
+        size_ = static_cast<size_t>(size.QuadPart);
+      }
+      // The view keeps the mapping alive.
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+}
+#else
+MappedFile::MappedFile(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* data =
+        mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      // Replay reads the file front to back exactly once.
+      madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+      data_ = static_cast<const uint8_t*>(data);
+      size_ = file_stat.st_size;
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+#endif
+
+// Reads the records written by EventRecorder. Every read fails once the end
+// of the data is reached, so a truncated file ends the replay cleanly.
+class RecordReader {
+ public:
+  RecordReader(const uint8_t* data, size_t size)
+      : position_(data), end_(data + size) {}
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && position_ < end_; shift += 7) {
+      const uint8_t byte = *position_++;
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadSignedVarint(int64_t* value) {
+    uint64_t zigzag;
+    if (!ReadVarint(&zigzag)) {
+      return false;
+    }
+    *value = static_cast<int64_t>(zigzag >> 1) ^
+             -static_cast<int64_t>(zigzag & 1);
+    return true;
+  }
+
+  bool Read(void* destination, size_t size) {
+    if (static_cast<size_t>(end_ - position_) < size) {
+      return false;
+    }
+    memcpy(destination, position_, size);
+    position_ += size;
+    return true;
+  }
+
+  // Reads one batch into |events|, rebasing timestamps off
+  // |previous_timestamp_ns|, which is updated.
+  bool ReadBatch(std::vector<PlatformWindowTimedEvent>* events,
+                 int64_t* previous_timestamp_ns) {
+    uint64_t count;
+    if (!ReadVarint(&count)) {
+      return false;
+    }
+    events->clear();
+    for (uint64_t i = 0; i < count; ++i) {
+      PlatformWindowTimedEvent event = {};
+      uint64_t type;
+      int64_t timestamp_delta_ns;
+      int64_t receive_delay_ns;
+      uint8_t data_size;
+      if (!ReadVarint(&type) || !ReadSignedVarint(&timestamp_delta_ns) ||
+          !ReadSignedVarint(&receive_delay_ns) ||
+          !Read(&data_size, sizeof(data_size)) ||
+          data_size > sizeof(event.event.data) ||
+          !Read(&event.event.data, data_size)) {
+        return false;
+      }
+      event.event.type = static_cast<PlatformWindowEventType>(type);
+      *previous_timestamp_ns += timestamp_delta_ns;
+      event.timestamp_ns = *previous_timestamp_ns;
+      event.received_ns = event.timestamp_ns + receive_delay_ns;
+      events->push_back(event);
+    }
+    return true;
+  }
+
+ private:
+  const uint8_t* position_;
+  const uint8_t* end_;
+};
+}  // namespace
+
+std::unique_ptr<EventRecorder> EventRecorder::Create(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return nullptr;
+  }
+  fwrite(kMagic, 1, sizeof(kMagic), file);
+  WriteUint32(kVersion, file);
+  WriteUint32(sizeof(PlatformWindowEventData), file);
+  WriteUint32(kEventTypeCount, file);
+  for (uint32_t type = 0; type < kEventTypeCount; ++type) {
+    fputc(static_cast<uint8_t>(
+              EventDataSize(static_cast<PlatformWindowEventType>(type))),
+          file);
+  }
+  return std::unique_ptr<EventRecorder>(new EventRecorder(file));
+}
+
+EventRecorder::EventRecorder(FILE* file) : file_(file) {}
+
+EventRecorder::~EventRecorder() { fclose(file_); }
+
+void EventRecorder::Record(const PlatformWindowTimedEvent* events,
+                           size_t count) {
+  WriteVarint(count);
+  for (size_t i = 0; i < count; ++i) {
+    const PlatformWindowTimedEvent& event = events[i];
+    WriteVarint(event.event.type);
+    WriteSignedVarint(event.timestamp_ns - previous_timestamp_ns_);
+    WriteSignedVarint(event.received_ns - event.timestamp_ns);
+    previous_timestamp_ns_ = event.timestamp_ns;
+
+    uint8_t data[sizeof(PlatformWindowEventData)];
+    uint8_t data_size =
+        static_cast<uint8_t>(CopyEventData(event.event.type, event.event.data,
+                                           data));
+    while (data_size > 0 && data[data_size - 1] == 0) {
+      --data_size;
+    }
+    fputc(data_size, file_);
+    fwrite(data, 1, data_size, file_);
+  }
+}
+
+void EventRecorder::WriteVarint(uint64_t value) {
+  while (value >= 0x80) {
+    fputc(static_cast<uint8_t>(value) | 0x80, file_);
+    value >>= 7;
+  }
+  fputc(static_cast<uint8_t>(value), file_);
+}
+
+void EventRecorder::WriteSignedVarint(int64_t value) {
+  WriteVarint((static_cast<uint64_t>(value) << 1) ^
+              static_cast<uint64_t>(value >> 63));
+}
+
+}  // namespace platform_window
+
+PlatformWindowReplayResult PlatformWindowReplayRecording(
+    const char* path, double speed,
+    PlatformWindowTimedBatchEventCallback event_handler_func, void* context) {
+  PlatformWindowReplayResult result = {};
+
+  platform_window::MappedFile file(path);
+  if (!file.data() || file.size() < platform_window::kHeaderSize ||
+      memcmp(file.data(), platform_window::EventRecorder::kMagic,
+             sizeof(platform_window::EventRecorder::kMagic)) != 0) {
+    return result;
+  }
+  const uint8_t* header_fields =
+      file.data() + sizeof(platform_window::EventRecorder::kMagic);
+  if (platform_window::ReadUint32(header_fields) !=
+          platform_window::EventRecorder::kVersion ||
+      platform_window::ReadUint32(header_fields + sizeof(uint32_t)) !=
+          sizeof(PlatformWindowEventData)) {
+    return result;
+  }
+  // Types added since the recording was made can't appear in it, and types
+  // this build doesn't know are replayed as is, so only the sizes of the types
+  // known to both must match.
+  const uint32_t type_count =
+      platform_window::ReadUint32(header_fields + 2 * sizeof(uint32_t));
+  if (file.size() - platform_window::kHeaderSize < type_count) {
+    return result;
+  }
+  const uint8_t* type_sizes = file.data() + platform_window::kHeaderSize;
+  for (uint32_t type = 0;
+       type < type_count && type < platform_window::kEventTypeCount; ++type) {
+    if (type_sizes[type] != platform_window::EventDataSize(
+                                static_cast<PlatformWindowEventType>(type))) {
+      return result;
+    }
+  }
+  result.success = true;
+
+  const size_t records_offset = platform_window::kHeaderSize + type_count;
+  platform_window::RecordReader reader(file.data() + records_offset,
+                                       file.size() - records_offset);
+  std::vector<PlatformWindowTimedEvent> events;
+  int64_t previous_timestamp_ns = 0;
+  bool have_first_batch = false;
+  int64_t first_received_ns = 0;
+
+  const int64_t start_ns = platform_window::MonotonicNowNs();
+  while (reader.ReadBatch(&events, &previous_timestamp_ns)) {
+    if (events.empty()) {
+      continue;
+    }
+
+    int64_t now_ns = platform_window::MonotonicNowNs();
+    if (speed > 0) {
+      // Batches were dispatched when their last event was received.
+      const int64_t batch_received_ns = events.back().received_ns;
+      if (!have_first_batch) {
+        first_received_ns = batch_received_ns;
+        have_first_batch = true;
+      }
+      const int64_t due_ns =
+          start_ns + static_cast<int64_t>(
+                         (batch_received_ns - first_received_ns) / speed);
+      if (due_ns > now_ns) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(due_ns - now_ns));
+        now_ns = platform_window::MonotonicNowNs();
+      }
+    }
+
+    // Each event is received now, but keeps its original latency.
+    for (PlatformWindowTimedEvent& event : events) {
+      event.timestamp_ns = now_ns - (event.received_ns - event.timestamp_ns);
+      event.received_ns = now_ns;
+    }
+
+    event_handler_func(context, events.data(), events.size());
+    result.events_replayed += events.size();
+    ++result.batches_replayed;
+  }
+  result.duration_ns = platform_window::MonotonicNowNs() - start_ns;
+
+  return result;
+}
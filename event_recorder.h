@@ -0,0 +1,58 @@
+#ifndef _PLATFORM_WINDOW_EVENT_RECORDER_H_
+#define _PLATFORM_WINDOW_EVENT_RECORDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// Writes the event recording format read by PlatformWindowReplayRecording().
+//
+// The file starts with a header:
+//   char[8]  "PWEVREC\0"
+//   uint32   format version (little endian)
+//   uint32   sizeof(PlatformWindowEventData) of the writer
+//   uint32   number of event types the writer knows
+//   uint8[]  size of each of those types' event data
+// and is followed by one record per dispatched batch:
+//   varint   number of events in the batch
+//   per event:
+//     varint   PlatformWindowEventType
+//     svarint  timestamp_ns minus the previous event's timestamp_ns
+//     svarint  received_ns minus timestamp_ns
+//     uint8    length of the event data that follows
+//     bytes    the event's data, with padding zeroed and trailing zero
+//              bytes trimmed
+// where varints are LEB128 and svarints are zigzag encoded LEB128.
+//
+// kVersion must be bumped whenever the layout of any event's data changes;
+// the per-type sizes only catch the changes that resize it.
+class EventRecorder {
+ public:
+  static constexpr char kMagic[8] = {'P', 'W', 'E', 'V', 'R', 'E', 'C', '\0'};
+  static constexpr uint32_t kVersion = 2;
+
+  // Returns null if |path| could not be opened for writing.
+  static std::unique_ptr<EventRecorder> Create(const std::string& path);
+  ~EventRecorder();
+
+  void Record(const PlatformWindowTimedEvent* events, size_t count);
+
+ private:
+  explicit EventRecorder(FILE* file);
+
+  void WriteVarint(uint64_t value);
+  void WriteSignedVarint(int64_t value);
+
+  FILE* file_;
+  int64_t previous_timestamp_ns_ = 0;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_RECORDER_H_
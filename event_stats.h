@@ -0,0 +1,179 @@
+#ifndef _PLATFORM_WINDOW_EVENT_STATS_H_
+#define _PLATFORM_WINDOW_EVENT_STATS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// Telemetry for a window's event pipeline, backing PlatformWindowGetStats().
+// Every counter has a single writer (the window's event thread), so updates
+// are plain relaxed loads and stores rather than read-modify-write
+// operations, and readers on other threads may see slightly stale values.
+// Nothing is recorded until Enable() is called, for
+// kPlatformWindowFlagCollectStats. Per-event work is kept to plain local
+// arithmetic, with the counters published once per batch. Defining
+// PLATFORM_WINDOW_DISABLE_STATS compiles all of the recording out.
+class EventStats {
+ public:
+  // Must be called before the event thread starts.
+  void Enable() {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    enabled_ = true;
+#endif
+  }
+
+  bool enabled() const {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    return enabled_;
+#else
+    return false;
+#endif
+  }
+
+  void RecordNativeEvent(int type) {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    if (!enabled_) {
+      return;
+    }
+    if (type < 0 || type >= kPlatformWindowStatsMaxNativeEventTypes) {
+      type = kPlatformWindowStatsMaxNativeEventTypes - 1;
+    }
+    Increment(&native_events_received_[type]);
+#endif
+  }
+
+  void RecordQueueDepth(size_t depth) {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    if (enabled_ &&
+        depth > max_queue_depth_.load(std::memory_order_relaxed)) {
+      max_queue_depth_.store(depth, std::memory_order_relaxed);
+    }
+#endif
+  }
+
+  // Called with the batch about to be handed to the user, and |now_ns| taken
+  // just before doing so. Like RecordCallbackTime(), only called while
+  // enabled(), by the dispatcher.
+  void RecordDispatch(const PlatformWindowTimedEvent* events, size_t count,
+                      int64_t now_ns) {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    // Batches are mostly runs of one type (e.g. motion), so types are counted
+    // as runs rather than per event.
+    uint64_t delays[kPlatformWindowStatsHistogramBuckets] = {};
+    int run_type = -1;
+    uint64_t run_length = 0;
+    for (size_t i = 0; i < count; ++i) {
+      int type = events[i].event.type;
+      if (type >= kPlatformWindowStatsMaxEventTypes) {
+        type = kPlatformWindowStatsMaxEventTypes - 1;
+      }
+      if (type != run_type) {
+        if (run_length != 0) {
+          Add(&events_dispatched_[run_type], run_length);
+        }
+        run_type = type;
+        run_length = 0;
+      }
+      ++run_length;
+      ++delays[HistogramBucket(now_ns - events[i].received_ns)];
+    }
+    if (run_length != 0) {
+      Add(&events_dispatched_[run_type], run_length);
+    }
+    for (size_t bucket = 0; bucket < kPlatformWindowStatsHistogramBuckets;
+         ++bucket) {
+      if (delays[bucket] != 0) {
+        Add(&dispatch_delay_histogram_[bucket], delays[bucket]);
+      }
+    }
+#endif
+  }
+
+  void RecordCallbackTime(int64_t duration_ns) {
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    Increment(&callback_time_histogram_[HistogramBucket(duration_ns)]);
+#endif
+  }
+
+  // Fills in everything but the fields that the backend tracks itself
+  // (dropped and coalesced events).
+  void Get(PlatformWindowStats* stats) const {
+    *stats = {};
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+    Load(native_events_received_, stats->native_events_received,
+         kPlatformWindowStatsMaxNativeEventTypes);
+    Load(events_dispatched_, stats->events_dispatched,
+         kPlatformWindowStatsMaxEventTypes);
+    stats->max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+    Load(callback_time_histogram_, stats->callback_time_histogram,
+         kPlatformWindowStatsHistogramBuckets);
+    Load(dispatch_delay_histogram_, stats->dispatch_delay_histogram,
+         kPlatformWindowStatsHistogramBuckets);
+#endif
+  }
+
+ private:
+  static void Increment(std::atomic<uint64_t>* counter) { Add(counter, 1); }
+
+  static void Add(std::atomic<uint64_t>* counter, uint64_t value) {
+    counter->store(counter->load(std::memory_order_relaxed) + value,
+                   std::memory_order_relaxed);
+  }
+
+  static void Load(const std::atomic<uint64_t>* counters, uint64_t* out,
+                   size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = counters[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  // See PlatformWindowStats for the bucket boundaries: bucket n holds
+  // durations of n significant bits of microseconds.
+  static size_t HistogramBucket(int64_t duration_ns) {
+    const uint64_t microseconds = duration_ns > 0 ? duration_ns / 1000 : 0;
+    const size_t bucket = BitWidth(microseconds);
+    return bucket < kPlatformWindowStatsHistogramBuckets - 1
+               ? bucket
+               : kPlatformWindowStatsHistogramBuckets - 1;
+  }
+
+  static size_t BitWidth(uint64_t value) {
+#if defined(__GNUC__)
+    return value != 0 ? 64 - __builtin_clzll(value) : 0;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    return _BitScanReverse64(&index, value) ? index + 1 : 0;
+#else
+    size_t width = 0;
+    for (; value != 0; value >>= 1) {
+      ++width;
+    }
+    return width;
+#endif
+  }
+
+#if !defined(PLATFORM_WINDOW_DISABLE_STATS)
+  bool enabled_ = false;
+  std::atomic<uint64_t>
+      native_events_received_[kPlatformWindowStatsMaxNativeEventTypes] = {};
+  std::atomic<uint64_t> events_dispatched_[kPlatformWindowStatsMaxEventTypes] =
+      {};
+  std::atomic<uint64_t> max_queue_depth_ = 0;
+  std::atomic<uint64_t>
+      callback_time_histogram_[kPlatformWindowStatsHistogramBuckets] = {};
+  std::atomic<uint64_t>
+      dispatch_delay_histogram_[kPlatformWindowStatsHistogramBuckets] = {};
+#endif
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_STATS_H_
@@ -0,0 +1,59 @@
+#ifndef _PLATFORM_WINDOW_EVENT_TIME_H_
+#define _PLATFORM_WINDOW_EVENT_TIME_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace platform_window {
+
+// The clock that PlatformWindowTimedEvent timestamps are expressed in. On
+// Linux, std::chrono::steady_clock is CLOCK_MONOTONIC.
+inline int64_t MonotonicNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Maps the 32-bit, wrapping, millisecond timestamps that platforms attach to
+// input events (X server Time, Win32 GetMessageTime()) onto MonotonicNowNs().
+// The offset between the two clocks is calibrated from the events themselves:
+// the smallest (receive time - event time) difference seen is the one with
+// the least transport delay, and so the best estimate of the true offset.
+// Only to be used from a single thread.
+class EventTimeMapper {
+ public:
+  int64_t ToMonotonicNs(uint32_t event_time_ms, int64_t received_ns) {
+    // Extend the event time to 64 bits, accounting for wrap around.
+    if (calibrated_ && event_time_ms < last_event_time_ms_ &&
+        last_event_time_ms_ - event_time_ms > 0x80000000u) {
+      wraps_ += 1;
+    }
+    last_event_time_ms_ = event_time_ms;
+    const int64_t event_ns =
+        ((wraps_ << 32) + static_cast<int64_t>(event_time_ms)) * 1000000;
+
+    const int64_t offset_ns = received_ns - event_ns;
+    // Recalibrate from scratch if the clocks jumped apart, e.g. the event
+    // source restarted or the machine was suspended.
+    constexpr int64_t kMaxDriftNs = 1000000000;
+    if (!calibrated_ || offset_ns < offset_ns_ ||
+        offset_ns - offset_ns_ > kMaxDriftNs) {
+      offset_ns_ = offset_ns;
+      calibrated_ = true;
+    }
+
+    // An event can't have happened after we received it.
+    const int64_t mapped_ns = event_ns + offset_ns_;
+    return mapped_ns < received_ns ? mapped_ns : received_ns;
+  }
+
+ private:
+  bool calibrated_ = false;
+  uint32_t last_event_time_ms_ = 0;
+  int64_t wraps_ = 0;
+  int64_t offset_ns_ = 0;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_EVENT_TIME_H_
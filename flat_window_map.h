@@ -0,0 +1,109 @@
+#ifndef _PLATFORM_WINDOW_FLAT_WINDOW_MAP_H_
+#define _PLATFORM_WINDOW_FLAT_WINDOW_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace platform_window {
+
+// An open addressing hash map from native window ids to windows, used to
+// route events that arrive on a connection shared by many windows. Every
+// event does a lookup, which here probes one contiguous array instead of
+// chasing std::unordered_map's per-node allocations.
+//
+// Ids 0 and ~0 are reserved, which is fine for X11 window ids: 0 is None, and
+// ids never have their top three bits set.
+template <typename Value>
+class FlatWindowMap {
+ public:
+  using Key = uint64_t;
+
+  FlatWindowMap() : slots_(kInitialCapacity) {}
+
+  // Returns null if |key| is not in the map.
+  Value* Find(Key key) const {
+    for (size_t i = Hash(key);; ++i) {
+      const Slot& slot = slots_[i & (slots_.size() - 1)];
+      if (slot.key == key) {
+        return slot.value;
+      }
+      if (slot.key == kEmpty) {
+        return nullptr;
+      }
+    }
+  }
+
+  // |key| must not already be in the map.
+  void Insert(Key key, Value* value) {
+    // Keep at least half of the slots empty so that probes stay short and
+    // always terminate. Erased slots count as used until the next rehash.
+    if ((used_ + 1) * 2 > slots_.size()) {
+      Rehash(size_ * 4 > slots_.size() ? slots_.size() * 2 : slots_.size());
+    }
+    for (size_t i = Hash(key);; ++i) {
+      Slot& slot = slots_[i & (slots_.size() - 1)];
+      if (slot.key == kEmpty || slot.key == kErased) {
+        used_ += slot.key == kEmpty;
+        slot = {key, value};
+        ++size_;
+        return;
+      }
+    }
+  }
+
+  void Erase(Key key) {
+    for (size_t i = Hash(key);; ++i) {
+      Slot& slot = slots_[i & (slots_.size() - 1)];
+      if (slot.key == key) {
+        slot = {kErased, nullptr};
+        --size_;
+        return;
+      }
+      if (slot.key == kEmpty) {
+        return;
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kInitialCapacity = 16;
+  static constexpr Key kEmpty = 0;
+  static constexpr Key kErased = ~Key{0};
+
+  struct Slot {
+    Key key = kEmpty;
+    Value* value = nullptr;
+  };
+
+  static size_t Hash(Key key) {
+    // Window ids are allocated sequentially within a client's id range, so
+    // mix them before using the low bits.
+    const uint64_t mixed = key * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(mixed ^ (mixed >> 32));
+  }
+
+  void Rehash(size_t capacity) {
+    std::vector<Slot> old_slots(capacity);
+    old_slots.swap(slots_);
+    size_ = 0;
+    used_ = 0;
+    for (const Slot& slot : old_slots) {
+      if (slot.key != kEmpty && slot.key != kErased) {
+        Insert(slot.key, slot.value);
+      }
+    }
+  }
+
+  // The capacity is always a power of 2.
+  std::vector<Slot> slots_;
+  size_t size_ = 0;
+  // Slots that are not empty, including erased ones.
+  size_t used_ = 0;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_FLAT_WINDOW_MAP_H_
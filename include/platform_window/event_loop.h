@@ -0,0 +1,43 @@
+#ifndef _PLATFORM_WINDOW_EVENT_LOOP_H_
+#define _PLATFORM_WINDOW_EVENT_LOOP_H_
+
+#include <cstddef>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// For windows created with kPlatformWindowFlagNoEventThread, which have no
+// event thread and instead rely on the application to pump them from its own
+// event loop. Callbacks then run on the thread calling
+// PlatformWindowDispatchPending().
+
+// Returns a file descriptor that becomes readable when events arrive for
+// |window|, to be added to the application's poll/epoll/io_uring set. It is
+// owned by the window and must not be read from or closed. On X11 this is an
+// epoll descriptor covering the window's display connection and a timer.
+//
+// Returns -1 where there is no such descriptor. On Windows, messages arrive in
+// the message queue of the thread that created the window, so wait on that
+// with MsgWaitForMultipleObjects() instead.
+int PlatformWindowGetEventFd(PlatformWindow window);
+
+// Translates and dispatches every event that is queued for |window|, on the
+// calling thread and without blocking. Returns the number of native events
+// processed, which may be more than the number of events delivered, e.g. when
+// motion is coalesced.
+//
+// Must always be called from the same thread, and on Windows from the thread
+// that created the window. Since readiness of the event fd is not a guarantee
+// that an event is pending (or vice versa, once Xlib has buffered them), call
+// this whenever the fd is readable and before going back to sleep after doing
+// anything that may have read from the connection.
+size_t PlatformWindowDispatchPending(PlatformWindow window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_EVENT_LOOP_H_
@@ -0,0 +1,68 @@
+#ifndef _PLATFORM_WINDOW_FRAME_TIMING_H_
+#define _PLATFORM_WINDOW_FRAME_TIMING_H_
+
+#include <cstdint>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Frame pacing against the display's vertical blanks, so that renderers can
+// start each frame just in time for the next one instead of spinning or
+// sleeping by guesswork. Vblanks are counted by the display's media stream
+// counter (MSC), which increments once per refresh.
+//
+// Only supported by the X11 (Xlib) backend, through the Present extension, and
+// not for windows created with kPlatformWindowFlagSharedEventLoop. The XCB,
+// Wayland, Win32 and headless backends always return false. While the
+// window is unmapped the X server only fakes a slow vblank (once per second on
+// Xorg), so waits time out instead; see PlatformWindowGetVisibility() for
+// pausing rendering then.
+
+struct PlatformWindowFrameTiming {
+  // The vblank that the last PlatformWindowWaitForNextFrame() waited for,
+  // which is the one following the previous wait or present, and the one at
+  // which it actually returned. The latter is later if the target had already
+  // passed by the time the request reached the server, i.e. if the frame
+  // took too long.
+  uint64_t target_msc;
+  uint64_t msc;
+  // When vblank |msc| happened, in nanoseconds on the clock of event
+  // timestamps (see PlatformWindowTimedEvent).
+  int64_t vblank_time_ns;
+  // The time between vblanks, as measured between waits, or 0 until two
+  // waits have been made.
+  int64_t refresh_interval_ns;
+  // The total number of vblanks that went by between a target and the vblank
+  // actually waited for, across every wait so far.
+  uint64_t missed_frames;
+  // The vblank at which the window's contents were last replaced by a
+  // present, e.g. by a Vulkan or GL driver, and when that happened, or 0 if
+  // none has been seen yet.
+  uint64_t last_present_msc;
+  int64_t last_present_time_ns;
+};
+
+// Blocks until the next vblank of the display that |window| is on, and
+// updates its frame timing. Returns false, without blocking, where frame
+// pacing is not supported, in which case the application must pace itself
+// some other way (e.g. with a FIFO swapchain). Also returns false, without
+// updating the frame timing, if no vblank came within 100ms, if another
+// thread started a wait in the meantime, or if the window is being destroyed.
+// Meant to be called from a single thread, and not from the window's event
+// callback. For windows created with kPlatformWindowFlagNoEventThread, events
+// that arrive while waiting are dispatched on the calling thread.
+bool PlatformWindowWaitForNextFrame(PlatformWindow window);
+
+// Copies |window|'s frame timing into |timing|. Returns false if there is none
+// yet, i.e. if no PlatformWindowWaitForNextFrame() has completed.
+bool PlatformWindowGetFrameTiming(PlatformWindow window,
+                                  PlatformWindowFrameTiming* timing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_FRAME_TIMING_H_
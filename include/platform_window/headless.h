@@ -0,0 +1,33 @@
+#ifndef _PLATFORM_WINDOW_HEADLESS_H_
+#define _PLATFORM_WINDOW_HEADLESS_H_
+
+#include <cstddef>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Only available in the headless backend (platform_window_stub.cc), whose
+// windows are not backed by any display. Injected events are queued and then
+// translated and delivered by the window's event thread exactly as a real
+// backend would, including coalescing, polling and stats. Injecting a
+// kPlatformWindowEventTypeResized event also updates the window's size.
+// May be called from any thread.
+void PlatformWindowHeadlessInjectEvent(PlatformWindow window,
+                                       const PlatformWindowEvent* event);
+// Injects |count| events at once, which amortizes the cost of handing them
+// over to the event thread.
+void PlatformWindowHeadlessInjectEvents(PlatformWindow window,
+                                        const PlatformWindowEvent* events,
+                                        size_t count);
+
+// Returns whether the window has been shown through PlatformWindowShow().
+bool PlatformWindowHeadlessIsVisible(PlatformWindow window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_HEADLESS_H_
@@ -1,6 +1,7 @@
 #ifndef _PLATFORM_WINDOW_PLATFORM_WINDOW_H_
 #define _PLATFORM_WINDOW_PLATFORM_WINDOW_H_
 
+#include <cstddef>
 #include <cstdint>
 
 #include "platform_window/platform_window_key.h"
@@ -27,12 +28,44 @@ enum PlatformWindowEventType {
   kPlatformWindowEventTypeMouseButton,
   kPlatformWindowEventTypeMouseWheel,
   kPlatformWindowEventTypeKey,
+  kPlatformWindowEventTypeRawMouseMotion,
+  kPlatformWindowEventTypeMoved,
+  // Bracket a burst of size changes, such as an interactive resize, so that
+  // renderers can e.g. stretch their last frame until the size settles rather
+  // than recreate their swapchain at every step. Both carry |resized|: the
+  // size before the burst, and the size it settled at. Only reported by the
+  // X11 backend, which considers a burst over once the size has not changed
+  // for 100ms.
+  kPlatformWindowEventTypeResizeStarted,
+  kPlatformWindowEventTypeResizeEnded,
+  // Part of the window's contents were lost, e.g. because it was uncovered,
+  // and must be redrawn. Only reported by the X11 backend.
+  kPlatformWindowEventTypeExpose,
+  // Only reported by the X11 backend, when the value changes.
+  kPlatformWindowEventTypeFocusChanged,
+  kPlatformWindowEventTypeVisibilityChanged,
 };
 
 struct PlatformWindowEventDataQuitRequest {};
 
+// Only sent when the size actually changes.
 struct PlatformWindowEventDataResized {
   PlatformWindowSize size;
+  // The low and high halves of a 64-bit serial, which is nonzero if the
+  // window manager holds off the rest of the resize until a frame of the new
+  // |size| has been presented, which the application signals with
+  // PlatformWindowAckFrame(). Only for windows created with
+  // kPlatformWindowFlagSyncResize. Split in two to keep the alignment, and so
+  // the size, of PlatformWindowEvent unchanged.
+  uint32_t sync_serial_low;
+  uint32_t sync_serial_high;
+};
+
+// The position of the window's top left corner, excluding any decorations,
+// in screen coordinates.
+struct PlatformWindowEventDataMoved {
+  int32_t x;
+  int32_t y;
 };
 
 struct PlatformWindowEventDataMouseMove {
@@ -40,6 +73,11 @@ struct PlatformWindowEventDataMouseMove {
   // window, in units of pixels.
   int32_t x;
   int32_t y;
+  // The same position with sub-pixel precision, where the platform reports it
+  // (Wayland, and X11 with kPlatformWindowFlagRawMouseMotion). Elsewhere these
+  // are just |x| and |y|.
+  float precise_x;
+  float precise_y;
 };
 
 enum PlatformWindowMouseButton {
@@ -61,9 +99,57 @@ struct PlatformWindowEventDataMouseWheel {
   int32_t y;
 };
 
+// Relative pointer motion straight from the device, before pointer
+// acceleration is applied and unaffected by the pointer reaching the edge of
+// the screen, for e.g. camera controls. Only delivered to windows created with
+// kPlatformWindowFlagRawMouseMotion.
+struct PlatformWindowEventDataRawMouseMotion {
+  // In device units (mickeys), not pixels. Summed over |sample_count|
+  // consecutive device reports, so that no motion is lost even though a high
+  // rate mouse produces far more reports than are worth dispatching one by one.
+  float dx;
+  float dy;
+  uint32_t sample_count;
+};
+
 struct PlatformWindowEventDataKeyEvent {
   bool pressed;
   PlatformWindowKey key;
+  // The platform's raw code for the physical key, independent of the keyboard
+  // layout (the X11 keycode, or the Win32 scan code with the extended key
+  // flag in bit 8). Useful for positional bindings such as WASD.
+  uint32_t scancode;
+};
+
+// The bounding box of the area to redraw, merged from every rectangle that
+// the platform reported for one exposure (on X11, a chain of Expose events
+// linked by their |count|).
+struct PlatformWindowEventDataExpose {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+struct PlatformWindowEventDataFocusChanged {
+  // Whether the window now receives keyboard input.
+  bool focused;
+};
+
+// How much of the window can be seen, for throttling or pausing rendering
+// while little or none of it can. See also PlatformWindowGetVisibility().
+enum PlatformWindowVisibility {
+  // Not shown, e.g. before PlatformWindowShow() or after PlatformWindowHide().
+  kPlatformWindowVisibilityUnmapped,
+  // Minimized by the user, which on X11 may or may not unmap the window.
+  kPlatformWindowVisibilityMinimized,
+  // Shown, but entirely covered by other windows.
+  kPlatformWindowVisibilityFullyObscured,
+  kPlatformWindowVisibilityPartiallyVisible,
+  kPlatformWindowVisibilityVisible,
+};
+struct PlatformWindowEventDataVisibilityChanged {
+  PlatformWindowVisibility visibility;
 };
 
 union PlatformWindowEventData {
@@ -73,31 +159,241 @@ union PlatformWindowEventData {
   PlatformWindowEventDataMouseButton mouse_button;
   PlatformWindowEventDataMouseWheel mouse_wheel;
   PlatformWindowEventDataKeyEvent key;
+  PlatformWindowEventDataRawMouseMotion raw_mouse_motion;
+  PlatformWindowEventDataMoved moved;
+  PlatformWindowEventDataExpose expose;
+  PlatformWindowEventDataFocusChanged focus_changed;
+  PlatformWindowEventDataVisibilityChanged visibility_changed;
 };
 
 struct PlatformWindowEvent {
   PlatformWindowEventType type;
   PlatformWindowEventData data;
 };
+static_assert(alignof(PlatformWindowEventData) == 4,
+              "Event data must stay 4-byte aligned, like it always was.");
+
+// Extends PlatformWindowEvent with timing information, leaving the layout of
+// PlatformWindowEvent itself untouched for existing callers. Times are in
+// nanoseconds on the monotonic clock (CLOCK_MONOTONIC on Linux, the
+// QueryPerformanceCounter based std::chrono::steady_clock on Windows).
+struct PlatformWindowTimedEvent {
+  PlatformWindowEvent event;
+  // When the event was generated, mapped from the platform's own event time
+  // (e.g. the X server timestamp) through a continuously calibrated offset.
+  // Equal to |received_ns| for events that carry no platform time.
+  int64_t timestamp_ns;
+  // When the library's event thread received the event from the platform.
+  int64_t received_ns;
+};
 
 typedef void (*PlatformWindowEventCallback)(void* context,
                                             PlatformWindowEvent event);
+// Receives every event that was translated in a single drain of the backend's
+// event queue, in order. |events| is only valid for the duration of the call.
+typedef void (*PlatformWindowBatchEventCallback)(
+    void* context, const PlatformWindowEvent* events, size_t count);
+typedef void (*PlatformWindowTimedBatchEventCallback)(
+    void* context, const PlatformWindowTimedEvent* events, size_t count);
+
+// Bit flags that can be combined and passed to PlatformWindowMakeWindow().
+enum PlatformWindowFlags {
+  kPlatformWindowFlagsNone = 0,
+  // When more events are already queued behind them, consecutive mouse move
+  // events are collapsed into the newest position and consecutive mouse wheel
+  // events are collapsed into a single event with their angles summed. Key
+  // and button events are never coalesced, and event order is preserved.
+  kPlatformWindowFlagCoalesceMotion = 1 << 0,
+  // Events are not delivered to a callback (which may then be NULL), but are
+  // queued in a bounded lock-free single-producer/single-consumer ring buffer
+  // owned by the window. A single application thread drains it with
+  // PlatformWindowPollEvents() and PlatformWindowWaitEvents(). If the ring
+  // fills up, new events are dropped.
+  kPlatformWindowFlagPollEvents = 1 << 1,
+  // The window shares a single display connection and event thread with every
+  // other window created with this flag, rather than getting its own. Callbacks
+  // of all such windows are then called from that one thread, so a slow
+  // handler delays the others. Only the X11 backend changes behavior; the XCB
+  // and Wayland backends always work this way, and the others ignore the flag.
+  kPlatformWindowFlagSharedEventLoop = 1 << 2,
+  // No event thread is started for the window. The application pumps it from
+  // its own loop instead, with PlatformWindowGetEventFd() and
+  // PlatformWindowDispatchPending() (see platform_window/event_loop.h), and
+  // callbacks run on the pumping thread. Must not be combined with
+  // kPlatformWindowFlagSharedEventLoop. Only supported by the X11 and Win32
+  // backends.
+  kPlatformWindowFlagNoEventThread = 1 << 3,
+  // Mouse input comes from XInput2 rather than from core X11 events: moves
+  // carry sub-pixel positions, and kPlatformWindowEventTypeRawMouseMotion
+  // events carry unaccelerated relative motion. Raw motion is reported for as
+  // long as the window exists, wherever the pointer is, so applications
+  // typically act on it only while they have focus or hold a pointer lock (see
+  // PlatformWindowSetPointerLock()). Only supported by the X11 backend, and not
+  // together with kPlatformWindowFlagSharedEventLoop; elsewhere, or if the X
+  // server lacks XInput 2, the flag is ignored.
+  kPlatformWindowFlagRawMouseMotion = 1 << 4,
+  // kPlatformWindowEventTypeResized events are held back while a resize is
+  // in progress, and only the final size is reported, right before
+  // kPlatformWindowEventTypeResizeEnded. PlatformWindowGetSize() still follows
+  // every step, and the steps are not synchronized with the window manager
+  // (see PlatformWindowAckFrame()), since they are never drawn. Only supported
+  // by the X11 backend.
+  kPlatformWindowFlagThrottleResize = 1 << 5,
+  // For applications that only draw when something changed, rather than
+  // continuously. Every batch of events after which the window must be
+  // redrawn, because of exposures or a new size, ends with a single
+  // kPlatformWindowEventTypeExpose covering all of it, so that handling that
+  // event is all it takes to keep the window's contents correct. Only
+  // supported by the X11 backend.
+  kPlatformWindowFlagRenderOnDemand = 1 << 6,
+  // Collects the telemetry reported by PlatformWindowGetStats(). Off by
+  // default, since timing the callbacks costs two clock reads per batch.
+  kPlatformWindowFlagCollectStats = 1 << 7,
+  // Advertises _NET_WM_SYNC_REQUEST, so that the window manager holds off
+  // each step of an interactive resize until the application has drawn the
+  // previous one and called PlatformWindowAckFrame(), which it then must. Only
+  // supported by the X11 backend, with window managers that implement the
+  // protocol.
+  kPlatformWindowFlagSyncResize = 1 << 8,
+};
 
 // The |event_callback| may be called from an arbitrary thread.
 PlatformWindow PlatformWindowMakeDefaultWindow(
     const char* title, PlatformWindowEventCallback event_handler_func,
     void* context);
+// Same as PlatformWindowMakeDefaultWindow(), but with |flags| being a
+// combination of PlatformWindowFlags values.
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_handler_func, void* context);
+// Events are delivered in batches instead of one at a time. The single event
+// variants above are implemented as a thin adapter over this one, calling
+// |event_handler_func| once for each event in the batch.
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_handler_func, void* context);
+// Like PlatformWindowMakeWindowWithBatchCallback(), but events are delivered
+// with their timestamps.
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_handler_func,
+    void* context);
+// Windows on a shared event loop (kPlatformWindowFlagSharedEventLoop, and
+// every XCB and Wayland window) may be destroyed from an event handler, even
+// one of their own, after which they receive no further events.
 void PlatformWindowDestroyWindow(PlatformWindow window);
 
 NativeWindow PlatformWindowGetNativeWindow(PlatformWindow window);
 
 void PlatformWindowSetTitle(PlatformWindow window, const char* title);
 
+// Nothing may be presented to a window while it is hidden, that is before
+// PlatformWindowShow() or after PlatformWindowHide(). On Wayland, Show() waits
+// for the compositor to configure the window, without which presenting is a
+// protocol error, unless it is called from an event handler, which cannot
+// wait for the event thread. Show Wayland windows from other threads.
 void PlatformWindowShow(PlatformWindow window);
 void PlatformWindowHide(PlatformWindow window);
 
 PlatformWindowSize PlatformWindowGetSize(PlatformWindow window);
 
+// Returns the window's visibility as of its last
+// kPlatformWindowEventTypeVisibilityChanged event, without a round trip to the
+// display server. Under a compositing window manager, X11 reports windows as
+// visible even while they are covered, so only being unmapped or minimized is
+// reliable there. The other backends only tell shown and hidden windows apart
+// (kPlatformWindowVisibilityVisible and kPlatformWindowVisibilityUnmapped),
+// and Win32 also minimized ones.
+PlatformWindowVisibility PlatformWindowGetVisibility(PlatformWindow window);
+
+enum PlatformWindowPointerLock {
+  kPlatformWindowPointerLockNone,
+  // The pointer stays visible but cannot leave the window.
+  kPlatformWindowPointerLockConfined,
+  // The pointer is also hidden, for e.g. mouse look, which is then driven by
+  // kPlatformWindowEventTypeRawMouseMotion.
+  kPlatformWindowPointerLockLocked,
+};
+// Grabs the pointer for |window| as described by |lock|, or releases it with
+// kPlatformWindowPointerLockNone. The window must be visible. Returns false if
+// the grab failed, e.g. because another client holds it.
+//
+// Only the X11 (Xlib) backend supports pointer locks. The XCB, Wayland, Win32
+// and headless backends return false for any other lock than
+// kPlatformWindowPointerLockNone, which always succeeds there since nothing
+// is held, and applications must fall back to e.g. plain mouse moves.
+bool PlatformWindowSetPointerLock(PlatformWindow window,
+                                  PlatformWindowPointerLock lock);
+
+// Tells the window manager that a frame of the size last reported by a
+// kPlatformWindowEventTypeResized event with a sync serial has been
+// presented, so that it can carry on resizing the window at the rate the
+// application renders at. Meant to be called after presenting every frame,
+// and does nothing while no resize is waiting for one, or if |window| was not
+// created with kPlatformWindowFlagSyncResize.
+void PlatformWindowAckFrame(PlatformWindow window);
+
+// Only valid for windows created with kPlatformWindowFlagPollEvents, and must
+// always be called from the same thread. Copies up to |max_count| queued
+// events into |events| without blocking, and returns how many were copied.
+size_t PlatformWindowPollEvents(PlatformWindow window,
+                                PlatformWindowEvent* events, size_t max_count);
+// Same as PlatformWindowPollEvents(), but including event timestamps.
+size_t PlatformWindowPollTimedEvents(PlatformWindow window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count);
+// Blocks until at least one event can be polled or |timeout_in_milliseconds|
+// elapses, whichever comes first. A negative timeout waits indefinitely.
+// Returns true if there are events to poll.
+bool PlatformWindowWaitEvents(PlatformWindow window,
+                              int32_t timeout_in_milliseconds);
+
+struct PlatformWindowCoalescingStats {
+  // Number of events that were merged into a neighboring event instead of
+  // being delivered, when kPlatformWindowFlagCoalesceMotion is set.
+  uint64_t mouse_move_events_merged;
+  uint64_t mouse_wheel_events_merged;
+};
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow window);
+
+enum {
+  kPlatformWindowStatsMaxNativeEventTypes = 64,
+  kPlatformWindowStatsMaxEventTypes = 32,
+  kPlatformWindowStatsHistogramBuckets = 16,
+};
+
+// Telemetry for a window's event thread. All counters are cumulative since
+// the window was created. Only the dropped and coalesced counts are tracked
+// unless the window was created with kPlatformWindowFlagCollectStats, and the
+// library can be built with PLATFORM_WINDOW_DISABLE_STATS defined to compile
+// the rest out entirely; either way, everything else reads as zero.
+struct PlatformWindowStats {
+  // Events read from the platform, indexed by native event type (e.g. the X11
+  // event type). Types that don't fit are counted in the last entry. Not
+  // tracked by the Win32 backend.
+  uint64_t native_events_received[kPlatformWindowStatsMaxNativeEventTypes];
+  // Events handed to the application, indexed by PlatformWindowEventType.
+  uint64_t events_dispatched[kPlatformWindowStatsMaxEventTypes];
+  // Events lost because the kPlatformWindowFlagPollEvents queue was full.
+  uint64_t events_dropped;
+  // Events merged away by kPlatformWindowFlagCoalesceMotion.
+  uint64_t events_coalesced;
+  // The most events seen waiting in the platform's queue at once.
+  uint64_t max_queue_depth;
+  // Histograms over durations in microseconds. Bucket 0 counts durations
+  // under 1us, bucket i counts [2^(i-1), 2^i) and the last bucket also counts
+  // everything longer.
+  // Time spent in the event callback, per batch.
+  uint64_t callback_time_histogram[kPlatformWindowStatsHistogramBuckets];
+  // Time from an event being received from the platform until it is handed
+  // to the application.
+  uint64_t dispatch_delay_histogram[kPlatformWindowStatsHistogramBuckets];
+};
+
+void PlatformWindowGetStats(PlatformWindow window, PlatformWindowStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,10 +1,14 @@
 #ifndef _PLATFORM_WINDOW_PLATFORM_WINDOW_CPP_H_
 #define _PLATFORM_WINDOW_PLATFORM_WINDOW_CPP_H_
 
+#include <chrono>
 #include <functional>
 #include <optional>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "platform_window/frame_timing.h"
 #include "platform_window/platform_window.h"
 
 namespace platform_window {
@@ -15,17 +19,30 @@ class Window {
   Window& operator=(const Window&) = delete;
   Window(Window&& x) { operator=(std::move(x)); }
   Window& operator=(Window&& x) {
-    event_handler_function_ = std::move(x.event_handler_function_);
+    batch_event_handler_function_ = std::move(x.batch_event_handler_function_);
     window_ = std::move(x.window_);
     x.window_ = INVALID_PLATFORM_WINDOW;
+    polled_events_ = std::move(x.polled_events_);
     return *this;
   }
 
   using EventHandlerFunction = std::function<void(PlatformWindowEvent)>;
+  using BatchEventHandlerFunction =
+      std::function<void(const PlatformWindowEvent* events, size_t count)>;
 
+  // |flags| is a combination of PlatformWindowFlags values.
   static std::optional<Window> Create(
       const std::string& title,
-      const EventHandlerFunction& event_handler_function);
+      const EventHandlerFunction& event_handler_function,
+      uint32_t flags = kPlatformWindowFlagsNone);
+  static std::optional<Window> CreateWithBatchHandler(
+      const std::string& title,
+      const BatchEventHandlerFunction& batch_event_handler_function,
+      uint32_t flags = kPlatformWindowFlagsNone);
+  // Creates a window with kPlatformWindowFlagPollEvents set, whose events are
+  // retrieved with PollEvents() instead of through a handler.
+  static std::optional<Window> CreateForPolling(
+      const std::string& title, uint32_t flags = kPlatformWindowFlagsNone);
 
   ~Window();
 
@@ -36,15 +53,61 @@ class Window {
   void Show();
   void Hide();
   PlatformWindowSize GetSize();
+  PlatformWindowVisibility GetVisibility();
+  bool SetPointerLock(PlatformWindowPointerLock lock);
+  void AckFrame();
+  PlatformWindowCoalescingStats GetCoalescingStats();
+  PlatformWindowStats GetStats();
+
+  // See platform_window/recording.h.
+  bool StartRecording(const std::string& path);
+  void StopRecording();
+
+  // See platform_window/event_loop.h. Only meaningful for windows created
+  // with kPlatformWindowFlagNoEventThread.
+  int GetEventFd();
+  size_t DispatchPending();
+
+  // See platform_window/frame_timing.h. GetFrameTiming() is empty until the
+  // first WaitForNextFrame() has completed.
+  bool WaitForNextFrame();
+  std::optional<PlatformWindowFrameTiming> GetFrameTiming();
+
+  // A view over the events returned by PollEvents(), usable in range-based
+  // for loops. It is invalidated by the next call to PollEvents().
+  class Events {
+   public:
+    Events(const PlatformWindowEvent* begin, const PlatformWindowEvent* end)
+        : begin_(begin), end_(end) {}
+    const PlatformWindowEvent* begin() const { return begin_; }
+    const PlatformWindowEvent* end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+   private:
+    const PlatformWindowEvent* begin_;
+    const PlatformWindowEvent* end_;
+  };
+
+  // Only valid for windows created with CreateForPolling(). Drains every
+  // event that is currently queued, without blocking.
+  Events PollEvents();
+  // Blocks until there are events to poll, or until |timeout| elapses. A
+  // negative |timeout| waits indefinitely.
+  bool WaitEvents(std::chrono::milliseconds timeout =
+                      std::chrono::milliseconds(-1));
 
  private:
-  Window(std::unique_ptr<EventHandlerFunction> event_handler_function,
+  Window(std::unique_ptr<BatchEventHandlerFunction>
+             batch_event_handler_function,
          PlatformWindow window)
-      : event_handler_function_(std::move(event_handler_function)),
+      : batch_event_handler_function_(std::move(batch_event_handler_function)),
         window_(window){};
 
-  std::unique_ptr<EventHandlerFunction> event_handler_function_;
+  std::unique_ptr<BatchEventHandlerFunction> batch_event_handler_function_;
   PlatformWindow window_;
+
+  std::vector<PlatformWindowEvent> polled_events_;
 };
 
 }  // namespace platform_window
@@ -0,0 +1,48 @@
+#ifndef _PLATFORM_WINDOW_RECORDING_H_
+#define _PLATFORM_WINDOW_RECORDING_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Starts appending every event that |window| delivers, exactly as delivered
+// (after coalescing, with timestamps and batch boundaries), to a compact
+// binary file at |path|, replacing any existing file. Returns false if the
+// file could not be opened. Any previous recording on |window| is stopped.
+bool PlatformWindowStartRecording(PlatformWindow window, const char* path);
+// Stops recording and flushes the file. Does nothing if not recording.
+void PlatformWindowStopRecording(PlatformWindow window);
+
+struct PlatformWindowReplayResult {
+  // False if the file could not be mapped or is not a recording. A recording
+  // that is truncated (e.g. the process died while writing it) is replayed up
+  // to the last complete batch.
+  bool success;
+  uint64_t events_replayed;
+  uint64_t batches_replayed;
+  // Wall time spent replaying, including time spent in |event_handler_func|.
+  int64_t duration_ns;
+};
+
+// Memory maps the recording at |path| and feeds it, batch by batch, to
+// |event_handler_func| on the calling thread. Each event is delivered with
+// received_ns set to the time it is replayed and timestamp_ns set to keep its
+// original latency.
+//   |speed| == 1.0 reproduces the original timing.
+//   |speed| > 0 scales it, e.g. 2.0 replays twice as fast.
+//   |speed| <= 0 replays as fast as possible, which makes the result a
+//   throughput benchmark of the handler.
+PlatformWindowReplayResult PlatformWindowReplayRecording(
+    const char* path, double speed,
+    PlatformWindowTimedBatchEventCallback event_handler_func, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_RECORDING_H_
@@ -0,0 +1,123 @@
+#ifndef _PLATFORM_WINDOW_SOFTWARE_H_
+#define _PLATFORM_WINDOW_SOFTWARE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Presents frames rendered by the CPU into a window, for machines without a
+// GPU. On X11 the pixel buffers are shared with the X server through MIT-SHM,
+// so presenting a frame does not copy it through the socket; where that is
+// not possible (e.g. a remote display), frames are sent with plain XPutImage.
+typedef struct PlatformWindowSoftwareFramebufferImpl*
+    PlatformWindowSoftwareFramebuffer;
+
+enum PlatformWindowSoftwareFramebufferFlags {
+  kPlatformWindowSoftwareFramebufferFlagsNone = 0,
+  // Always send frames through the socket, even if MIT-SHM is available.
+  kPlatformWindowSoftwareFramebufferFlagNoSharedMemory = 1 << 0,
+};
+
+struct PlatformWindowSoftwareBuffer {
+  // Rows of 32-bit pixels, top row first, with each pixel being 0x00RRGGBB in
+  // native byte order. The top byte is ignored.
+  uint32_t* pixels;
+  int32_t width;
+  int32_t height;
+  // Distance between the starts of two rows, in pixels.
+  int32_t stride;
+};
+
+// Returns NULL if |window| cannot be presented to, e.g. because the display
+// does not use 32-bit pixels. |flags| is a combination of
+// PlatformWindowSoftwareFramebufferFlags values. The framebuffer must be
+// destroyed before |window|, and used from one thread at a time.
+PlatformWindowSoftwareFramebuffer PlatformWindowSoftwareCreateFramebuffer(
+    PlatformWindow window, uint32_t flags);
+void PlatformWindowSoftwareDestroyFramebuffer(
+    PlatformWindowSoftwareFramebuffer framebuffer);
+
+// Returns whether frames are presented through shared memory.
+bool PlatformWindowSoftwareIsSharedMemory(
+    PlatformWindowSoftwareFramebuffer framebuffer);
+
+// Fills in |buffer| with the back buffer, into which the next frame is to be
+// drawn. There are two buffers, so its contents are those of the frame before
+// last, unless the window has been resized since, in which case the buffers
+// are reallocated at the new size and their contents are undefined. Blocks if
+// the display is still reading the buffer from that frame. Returns false if
+// the buffers could not be allocated.
+bool PlatformWindowSoftwareAcquireBuffer(
+    PlatformWindowSoftwareFramebuffer framebuffer,
+    PlatformWindowSoftwareBuffer* buffer);
+
+// Presents the buffer returned by the last call to
+// PlatformWindowSoftwareAcquireBuffer(), and makes the other one the back
+// buffer. Does not block.
+void PlatformWindowSoftwarePresent(
+    PlatformWindowSoftwareFramebuffer framebuffer);
+
+// Alternatively, the application renders into a frame of its own, in any of
+// these formats, and the library converts and uploads the parts that changed.
+enum PlatformWindowSoftwarePixelFormat {
+  // 32-bit 0x00RRGGBB in native byte order, like the framebuffer itself, so no
+  // conversion is needed. The top byte is ignored.
+  kPlatformWindowSoftwarePixelFormatXRGB8888,
+  // Bytes R, G, B, A in memory order. Alpha is ignored.
+  kPlatformWindowSoftwarePixelFormatRGBA8888,
+  // 16-bit 5:6:5 in native byte order, red in the top bits.
+  kPlatformWindowSoftwarePixelFormatRGB565,
+};
+
+struct PlatformWindowSoftwareImage {
+  const void* pixels;
+  PlatformWindowSoftwarePixelFormat format;
+  int32_t width;
+  int32_t height;
+  // Distance between the starts of two rows, in bytes.
+  int32_t stride_in_bytes;
+};
+
+struct PlatformWindowSoftwareRect {
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+struct PlatformWindowSoftwarePresentStats {
+  // Pixel data the display read for this frame, whether out of shared memory
+  // or through the socket.
+  uint64_t bytes_uploaded;
+  // Pixels converted into the back buffer. Besides this frame's damage, this
+  // includes the previous frame's, which went into the other buffer.
+  uint64_t pixels_converted;
+  // Put-image requests issued, after merging the damaged tiles.
+  uint32_t request_count;
+};
+
+// Presents |image|, which holds the application's whole frame, drawn at the
+// top left of the window and clipped to it. Only the |damage_count|
+// rectangles in |damage| are assumed to have changed since the previous call,
+// or everything if |damage| is NULL. Damage is tracked in 64x64 pixel tiles,
+// which are merged into as few rectangles as possible; only those are
+// converted and uploaded, with large updates converted by a pool of worker
+// threads. The first frame, and the first after a resize or a call to
+// PlatformWindowSoftwarePresent(), is presented in full regardless. |stats|
+// may be NULL. Returns false if the buffers could not be allocated.
+bool PlatformWindowSoftwarePresentImage(
+    PlatformWindowSoftwareFramebuffer framebuffer,
+    const PlatformWindowSoftwareImage* image,
+    const PlatformWindowSoftwareRect* damage, size_t damage_count,
+    PlatformWindowSoftwarePresentStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_SOFTWARE_H_
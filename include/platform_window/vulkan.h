@@ -11,12 +11,23 @@
 extern "C" {
 #endif
 
+// The instance extensions that surfaces need, to be enabled when creating
+// the instance. Where the platform has more than one way to create surfaces,
+// the one chosen depends on what the Vulkan loader offers.
 size_t PlatformWindowVulkanGetRequiredInstanceExtensionsCount();
 const char** PlatformWindowVulkanGetRequiredInstanceExtensions();
 VkResult PlatformWindowVulkanCreateSurface(VkInstance vk_instance,
                                            PlatformWindow window,
                                            VkSurfaceKHR* surface);
 
+// Returns whether queue family |queue_family_index| of |physical_device| can
+// present to |window|, for picking the device and queue to render with before
+// any surface exists. Answers that take a round trip to the display server
+// are cached, so this is cheap to call for every new window.
+VkBool32 PlatformWindowVulkanGetPresentationSupport(
+    VkPhysicalDevice physical_device, uint32_t queue_family_index,
+    PlatformWindow window);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,103 @@
+#ifndef _PLATFORM_WINDOW_VULKAN_SWAPCHAIN_H_
+#define _PLATFORM_WINDOW_VULKAN_SWAPCHAIN_H_
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An optional helper that owns a window's surface and swapchain. It picks a
+// low latency present mode, keeps several frames in flight, and recreates the
+// swapchain when the window's size changes, so applications do not have to
+// handle kPlatformWindowEventTypeResized for it. Retired swapchains are
+// destroyed once the frames that used them have completed, rather than by
+// waiting for the device to go idle.
+typedef struct PlatformWindowVulkanSwapchainImpl* PlatformWindowVulkanSwapchain;
+
+enum PlatformWindowVulkanSwapchainFlags {
+  kPlatformWindowVulkanSwapchainFlagsNone = 0,
+  // Present in FIFO mode, i.e. in sync with the display and never tearing.
+  // Otherwise MAILBOX is used where available, then IMMEDIATE, then FIFO.
+  kPlatformWindowVulkanSwapchainFlagFifo = 1 << 0,
+};
+
+struct PlatformWindowVulkanSwapchainCreateInfo {
+  VkInstance instance;
+  VkPhysicalDevice physical_device;
+  VkDevice device;
+  // The queue that frames are presented on, which must support presenting to
+  // the window (see PlatformWindowVulkanGetPresentationSupport()).
+  VkQueue present_queue;
+  PlatformWindow window;
+  // A combination of PlatformWindowVulkanSwapchainFlags values.
+  uint32_t flags;
+  // How many frames may be in flight at once, or 0 for 2.
+  uint32_t frames_in_flight;
+  // Usage of the swapchain images, or 0 for
+  // VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT.
+  VkImageUsageFlags image_usage;
+  // Format of the swapchain images, or VK_FORMAT_UNDEFINED for
+  // VK_FORMAT_B8G8R8A8_UNORM. Falls back to the surface's first format if the
+  // one asked for is not supported.
+  VkFormat format;
+};
+
+struct PlatformWindowVulkanFrame {
+  VkImage image;
+  VkImageView image_view;
+  uint32_t image_index;
+  VkFormat format;
+  VkExtent2D extent;
+  // Which of the frames in flight this is, from 0 to frames_in_flight - 1, for
+  // indexing per-frame resources such as command buffers.
+  uint32_t frame_in_flight_index;
+  // Set if the swapchain has been recreated since the previous frame, e.g.
+  // because the window was resized, so that resources which depend on the
+  // images or their size must be recreated.
+  bool recreated;
+  // The application's first submission for the frame must wait on this
+  // before writing to |image|.
+  VkSemaphore image_available;
+  // The application's last submission for the frame must signal both of
+  // these. Presenting waits on |render_finished|, and the helper waits on
+  // |in_flight_fence| before reusing this frame's resources, which is how
+  // frames overlap without ever waiting for the device to go idle.
+  VkSemaphore render_finished;
+  VkFence in_flight_fence;
+};
+
+// Creates a surface for |info->window| and a swapchain for it. The helper must
+// be destroyed before the window and the device.
+VkResult PlatformWindowVulkanCreateSwapchain(
+    const PlatformWindowVulkanSwapchainCreateInfo* info,
+    PlatformWindowVulkanSwapchain* swapchain);
+// Waits for the device to go idle, then destroys the swapchain and the
+// surface.
+void PlatformWindowVulkanDestroySwapchain(
+    PlatformWindowVulkanSwapchain swapchain);
+
+// Waits until the oldest frame in flight has completed, recreates the
+// swapchain if the window's size has changed (as last reported by its event
+// thread, so without a round trip to the display server) or the swapchain went
+// out of date, and acquires the next image into |frame|. Returns VK_NOT_READY
+// while the window has no area, e.g. when minimized, in which case there is no
+// frame to render. Every VK_SUCCESS must be followed by
+// PlatformWindowVulkanPresent().
+VkResult PlatformWindowVulkanAcquireFrame(
+    PlatformWindowVulkanSwapchain swapchain, PlatformWindowVulkanFrame* frame);
+
+// Presents the frame returned by the last PlatformWindowVulkanAcquireFrame().
+// An out of date or suboptimal swapchain is not reported as an error, it is
+// recreated by the next PlatformWindowVulkanAcquireFrame().
+VkResult PlatformWindowVulkanPresent(PlatformWindowVulkanSwapchain swapchain);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_VULKAN_SWAPCHAIN_H_
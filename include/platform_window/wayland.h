@@ -0,0 +1,22 @@
+#ifndef _PLATFORM_WINDOW_WAYLAND_H_
+#define _PLATFORM_WINDOW_WAYLAND_H_
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct wl_display;
+
+// Only available in the Wayland backend (platform_window_wayland.cc), where
+// PlatformWindowGetNativeWindow() returns the window's wl_surface. Returns
+// the display connection that every window shares, which is needed alongside
+// the surface to create e.g. Vulkan or EGL surfaces for the window.
+struct wl_display* PlatformWindowWaylandGetDisplay();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_WAYLAND_H_
@@ -0,0 +1,33 @@
+#ifndef _PLATFORM_WINDOW_X11_H_
+#define _PLATFORM_WINDOW_X11_H_
+
+#include <cstdint>
+
+#include "platform_window/platform_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct xcb_connection_t;
+
+// Only available in the X11 backends (platform_window_x11.cc and
+// platform_window_xcb.cc), where PlatformWindowGetNativeWindow() returns the
+// window's XID. Returns the XCB connection that |window| was created on, which
+// in the Xlib backend is the one underneath its Display. The connection stays
+// open for as long as the window does, and is needed alongside the XID to
+// create e.g. Vulkan surfaces without opening a connection of one's own. It
+// may be used from any thread: the Xlib backend calls XInitThreads() before
+// opening its first display, so applications that make Xlib calls of their
+// own before creating a window must call XInitThreads() first themselves.
+struct xcb_connection_t* PlatformWindowX11GetXcbConnection(
+    PlatformWindow window);
+
+// Returns the ID of the visual that |window| was created with.
+uint32_t PlatformWindowX11GetVisualId(PlatformWindow window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // #ifndef _PLATFORM_WINDOW_X11_H_
@@ -0,0 +1,295 @@
+#include "pixel_conversion.h"
+
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define PLATFORM_WINDOW_HAVE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+// Compiled for AVX2 through target attributes, and only used when the CPU
+// reports it.
+#define PLATFORM_WINDOW_HAVE_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#if defined(__ARM_NEON)
+#define PLATFORM_WINDOW_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+// The kernels read RGBA8888 pixels as little-endian words.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Only little-endian targets are supported.");
+
+namespace platform_window {
+namespace {
+
+void CopyRow(const void* source, uint32_t* destination, size_t count) {
+  std::memcpy(destination, source, count * sizeof(uint32_t));
+}
+
+// Each kernel handles as many pixels as fit its vectors, and leaves the rest
+// of the row to the scalar one.
+
+uint32_t RgbaToXrgb(uint32_t rgba) {
+  return ((rgba & 0xff) << 16) | (rgba & 0xff00) | ((rgba >> 16) & 0xff);
+}
+
+void ConvertRgbaRowScalar(const void* source, uint32_t* destination,
+                          size_t count) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(source);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t rgba;
+    std::memcpy(&rgba, bytes + i * 4, sizeof(rgba));
+    destination[i] = RgbaToXrgb(rgba);
+  }
+}
+
+// Widens 5 and 6 bit channels by replicating their top bits, so that full
+// intensity maps to 0xff.
+uint32_t Rgb565ToXrgb(uint16_t rgb565) {
+  const uint32_t r = (rgb565 >> 11) & 0x1f;
+  const uint32_t g = (rgb565 >> 5) & 0x3f;
+  const uint32_t b = rgb565 & 0x1f;
+  return (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) |
+         ((b << 3) | (b >> 2));
+}
+
+void ConvertRgb565RowScalar(const void* source, uint32_t* destination,
+                            size_t count) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(source);
+  for (size_t i = 0; i < count; ++i) {
+    uint16_t rgb565;
+    std::memcpy(&rgb565, bytes + i * 2, sizeof(rgb565));
+    destination[i] = Rgb565ToXrgb(rgb565);
+  }
+}
+
+#if defined(PLATFORM_WINDOW_HAVE_SSE2)
+void ConvertRgbaRowSse2(const void* source, uint32_t* destination,
+                        size_t count) {
+  const __m128i* in = static_cast<const __m128i*>(source);
+  __m128i* out = reinterpret_cast<__m128i*>(destination);
+  const __m128i low_byte = _mm_set1_epi32(0xff);
+  const __m128i green = _mm_set1_epi32(0xff00);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m128i rgba = _mm_loadu_si128(in++);
+    const __m128i r = _mm_slli_epi32(_mm_and_si128(rgba, low_byte), 16);
+    const __m128i g = _mm_and_si128(rgba, green);
+    const __m128i b = _mm_and_si128(_mm_srli_epi32(rgba, 16), low_byte);
+    _mm_storeu_si128(out++, _mm_or_si128(_mm_or_si128(r, g), b));
+  }
+  ConvertRgbaRowScalar(static_cast<const uint8_t*>(source) + i * 4,
+                       destination + i, count - i);
+}
+
+// Works on 32-bit lanes holding one 5:6:5 pixel each.
+inline __m128i Rgb565ToXrgbSse2(__m128i pixels) {
+  const __m128i five_bits = _mm_set1_epi32(0x1f);
+  const __m128i six_bits = _mm_set1_epi32(0x3f);
+  __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 11), five_bits);
+  __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 5), six_bits);
+  __m128i b = _mm_and_si128(pixels, five_bits);
+  r = _mm_or_si128(_mm_slli_epi32(r, 3), _mm_srli_epi32(r, 2));
+  g = _mm_or_si128(_mm_slli_epi32(g, 2), _mm_srli_epi32(g, 4));
+  b = _mm_or_si128(_mm_slli_epi32(b, 3), _mm_srli_epi32(b, 2));
+  return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 16), _mm_slli_epi32(g, 8)),
+                      b);
+}
+
+void ConvertRgb565RowSse2(const void* source, uint32_t* destination,
+                          size_t count) {
+  const __m128i* in = static_cast<const __m128i*>(source);
+  __m128i* out = reinterpret_cast<__m128i*>(destination);
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m128i pixels = _mm_loadu_si128(in++);
+    _mm_storeu_si128(out++,
+                     Rgb565ToXrgbSse2(_mm_unpacklo_epi16(pixels, zero)));
+    _mm_storeu_si128(out++,
+                     Rgb565ToXrgbSse2(_mm_unpackhi_epi16(pixels, zero)));
+  }
+  ConvertRgb565RowScalar(static_cast<const uint8_t*>(source) + i * 2,
+                         destination + i, count - i);
+}
+#endif  // defined(PLATFORM_WINDOW_HAVE_SSE2)
+
+#if defined(PLATFORM_WINDOW_HAVE_AVX2)
+__attribute__((target("avx2"))) void ConvertRgbaRowAvx2(const void* source,
+                                                        uint32_t* destination,
+                                                        size_t count) {
+  const __m256i* in = static_cast<const __m256i*>(source);
+  __m256i* out = reinterpret_cast<__m256i*>(destination);
+  // Swaps R and B in every pixel, and clears alpha.
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1,  //
+      2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    _mm256_storeu_si256(
+        out++, _mm256_shuffle_epi8(_mm256_loadu_si256(in++), shuffle));
+  }
+  ConvertRgbaRowScalar(static_cast<const uint8_t*>(source) + i * 4,
+                       destination + i, count - i);
+}
+
+__attribute__((target("avx2"))) void ConvertRgb565RowAvx2(
+    const void* source, uint32_t* destination, size_t count) {
+  const __m128i* in = static_cast<const __m128i*>(source);
+  __m256i* out = reinterpret_cast<__m256i*>(destination);
+  const __m256i five_bits = _mm256_set1_epi32(0x1f);
+  const __m256i six_bits = _mm256_set1_epi32(0x3f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m256i pixels = _mm256_cvtepu16_epi32(_mm_loadu_si128(in++));
+    __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 11), five_bits);
+    __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 5), six_bits);
+    __m256i b = _mm256_and_si256(pixels, five_bits);
+    r = _mm256_or_si256(_mm256_slli_epi32(r, 3), _mm256_srli_epi32(r, 2));
+    g = _mm256_or_si256(_mm256_slli_epi32(g, 2), _mm256_srli_epi32(g, 4));
+    b = _mm256_or_si256(_mm256_slli_epi32(b, 3), _mm256_srli_epi32(b, 2));
+    _mm256_storeu_si256(
+        out++, _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 16),
+                                               _mm256_slli_epi32(g, 8)),
+                               b));
+  }
+  ConvertRgb565RowScalar(static_cast<const uint8_t*>(source) + i * 2,
+                         destination + i, count - i);
+}
+#endif  // defined(PLATFORM_WINDOW_HAVE_AVX2)
+
+#if defined(PLATFORM_WINDOW_HAVE_NEON)
+void ConvertRgbaRowNeon(const void* source, uint32_t* destination,
+                        size_t count) {
+  const uint8_t* in = static_cast<const uint8_t*>(source);
+  uint8_t* out = reinterpret_cast<uint8_t*>(destination);
+  const uint8x16_t zero = vdupq_n_u8(0);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8x16x4_t rgba = vld4q_u8(in + i * 4);
+    const uint8x16x4_t bgrx = {{rgba.val[2], rgba.val[1], rgba.val[0], zero}};
+    vst4q_u8(out + i * 4, bgrx);
+  }
+  ConvertRgbaRowScalar(in + i * 4, destination + i, count - i);
+}
+
+void ConvertRgb565RowNeon(const void* source, uint32_t* destination,
+                          size_t count) {
+  const uint16_t* in = static_cast<const uint16_t*>(source);
+  uint8_t* out = reinterpret_cast<uint8_t*>(destination);
+  const uint16x8_t five_bits = vdupq_n_u16(0x1f);
+  const uint16x8_t six_bits = vdupq_n_u16(0x3f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const uint16x8_t pixels = vld1q_u16(in + i);
+    uint16x8_t r = vshrq_n_u16(pixels, 11);
+    uint16x8_t g = vandq_u16(vshrq_n_u16(pixels, 5), six_bits);
+    uint16x8_t b = vandq_u16(pixels, five_bits);
+    r = vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2));
+    g = vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4));
+    b = vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2));
+    const uint8x8x4_t bgrx = {
+        {vmovn_u16(b), vmovn_u16(g), vmovn_u16(r), vdup_n_u8(0)}};
+    vst4_u8(out + i * 4, bgrx);
+  }
+  ConvertRgb565RowScalar(in + i, destination + i, count - i);
+}
+#endif  // defined(PLATFORM_WINDOW_HAVE_NEON)
+
+bool IsSupported(PixelKernel kernel) {
+  switch (kernel) {
+    case PixelKernel::kScalar:
+      return true;
+    case PixelKernel::kSse2:
+#if defined(PLATFORM_WINDOW_HAVE_SSE2)
+      return true;
+#else
+      return false;
+#endif
+    case PixelKernel::kAvx2:
+#if defined(PLATFORM_WINDOW_HAVE_AVX2)
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    case PixelKernel::kNeon:
+#if defined(PLATFORM_WINDOW_HAVE_NEON)
+      return true;
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+}  // namespace
+
+ConvertRowFunction GetConvertRowFunction(
+    PlatformWindowSoftwarePixelFormat format, PixelKernel kernel) {
+  if (!IsSupported(kernel)) {
+    return nullptr;
+  }
+  switch (format) {
+    case kPlatformWindowSoftwarePixelFormatXRGB8888:
+      // memcpy() is already vectorized.
+      return &CopyRow;
+    case kPlatformWindowSoftwarePixelFormatRGBA8888:
+      switch (kernel) {
+        case PixelKernel::kScalar:
+          return &ConvertRgbaRowScalar;
+#if defined(PLATFORM_WINDOW_HAVE_SSE2)
+        case PixelKernel::kSse2:
+          return &ConvertRgbaRowSse2;
+#endif
+#if defined(PLATFORM_WINDOW_HAVE_AVX2)
+        case PixelKernel::kAvx2:
+          return &ConvertRgbaRowAvx2;
+#endif
+#if defined(PLATFORM_WINDOW_HAVE_NEON)
+        case PixelKernel::kNeon:
+          return &ConvertRgbaRowNeon;
+#endif
+        default:
+          return nullptr;
+      }
+    case kPlatformWindowSoftwarePixelFormatRGB565:
+      switch (kernel) {
+        case PixelKernel::kScalar:
+          return &ConvertRgb565RowScalar;
+#if defined(PLATFORM_WINDOW_HAVE_SSE2)
+        case PixelKernel::kSse2:
+          return &ConvertRgb565RowSse2;
+#endif
+#if defined(PLATFORM_WINDOW_HAVE_AVX2)
+        case PixelKernel::kAvx2:
+          return &ConvertRgb565RowAvx2;
+#endif
+#if defined(PLATFORM_WINDOW_HAVE_NEON)
+        case PixelKernel::kNeon:
+          return &ConvertRgb565RowNeon;
+#endif
+        default:
+          return nullptr;
+      }
+  }
+  return nullptr;
+}
+
+ConvertRowFunction GetConvertRowFunction(
+    PlatformWindowSoftwarePixelFormat format) {
+  for (PixelKernel kernel : {PixelKernel::kAvx2, PixelKernel::kNeon,
+                             PixelKernel::kSse2, PixelKernel::kScalar}) {
+    if (ConvertRowFunction function = GetConvertRowFunction(format, kernel)) {
+      return function;
+    }
+  }
+  return nullptr;
+}
+
+size_t BytesPerPixel(PlatformWindowSoftwarePixelFormat format) {
+  return format == kPlatformWindowSoftwarePixelFormatRGB565 ? 2 : 4;
+}
+
+}  // namespace platform_window
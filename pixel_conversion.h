@@ -0,0 +1,38 @@
+#ifndef _PLATFORM_WINDOW_PIXEL_CONVERSION_H_
+#define _PLATFORM_WINDOW_PIXEL_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "platform_window/software.h"
+
+namespace platform_window {
+
+// Converts |count| pixels of some PlatformWindowSoftwarePixelFormat at
+// |source| into 0x00RRGGBB pixels at |destination|. Neither needs to be
+// aligned.
+typedef void (*ConvertRowFunction)(const void* source, uint32_t* destination,
+                                   size_t count);
+
+enum class PixelKernel {
+  kScalar,
+  kSse2,
+  kAvx2,
+  kNeon,
+};
+
+// Returns the implementation for |format| using |kernel|, or null if that
+// kernel is not compiled in or not supported by this CPU.
+ConvertRowFunction GetConvertRowFunction(
+    PlatformWindowSoftwarePixelFormat format, PixelKernel kernel);
+
+// Returns the fastest implementation for |format| that this CPU supports.
+ConvertRowFunction GetConvertRowFunction(
+    PlatformWindowSoftwarePixelFormat format);
+
+// Bytes per pixel of |format|.
+size_t BytesPerPixel(PlatformWindowSoftwarePixelFormat format);
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_PIXEL_CONVERSION_H_
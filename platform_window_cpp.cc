@@ -1,25 +1,67 @@
 #include "platform_window/platform_window_cpp.h"
 
+#include "platform_window/event_loop.h"
+#include "platform_window/recording.h"
+
+#include "platform_window_cpp_internal.h"
+
 namespace platform_window {
 
+namespace internal {
+
+Window::BatchEventHandlerFunction AdaptEventHandler(
+    const Window::EventHandlerFunction& event_handler_function) {
+  return [event_handler_function](const PlatformWindowEvent* events,
+                                  size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      event_handler_function(events[i]);
+    }
+  };
+}
+
+void CallBatchEventHandler(void* context, const PlatformWindowEvent* events,
+                           size_t count) {
+  (*reinterpret_cast<Window::BatchEventHandlerFunction*>(context))(events,
+                                                                   count);
+}
+
+}  // namespace internal
+
 std::optional<Window> Window::Create(
     const std::string& title,
-    const EventHandlerFunction& event_handler_function) {
-  auto event_handler_function_ptr =
-      std::make_unique<EventHandlerFunction>(event_handler_function);
+    const EventHandlerFunction& event_handler_function, uint32_t flags) {
+  return CreateWithBatchHandler(
+      title, internal::AdaptEventHandler(event_handler_function), flags);
+}
+
+std::optional<Window> Window::CreateWithBatchHandler(
+    const std::string& title,
+    const BatchEventHandlerFunction& batch_event_handler_function,
+    uint32_t flags) {
+  auto batch_event_handler_function_ptr =
+      std::make_unique<BatchEventHandlerFunction>(batch_event_handler_function);
 
-  PlatformWindow window = PlatformWindowMakeDefaultWindow(
-      title.c_str(),
-      [](void* context, PlatformWindowEvent event) {
-        (*reinterpret_cast<EventHandlerFunction*>(context))(event);
-      },
-      event_handler_function_ptr.get());
+  PlatformWindow window = PlatformWindowMakeWindowWithBatchCallback(
+      title.c_str(), flags, &internal::CallBatchEventHandler,
+      batch_event_handler_function_ptr.get());
 
   if (window == INVALID_PLATFORM_WINDOW) {
     return std::nullopt;
   }
 
-  return Window(std::move(event_handler_function_ptr), std::move(window));
+  return Window(std::move(batch_event_handler_function_ptr), std::move(window));
+}
+
+std::optional<Window> Window::CreateForPolling(const std::string& title,
+                                               uint32_t flags) {
+  PlatformWindow window = PlatformWindowMakeWindow(
+      title.c_str(), flags | kPlatformWindowFlagPollEvents, nullptr, nullptr);
+
+  if (window == INVALID_PLATFORM_WINDOW) {
+    return std::nullopt;
+  }
+
+  return Window(nullptr, std::move(window));
 }
 
 Window::~Window() {
@@ -37,4 +79,69 @@ void Window::Hide() { PlatformWindowHide(window_); }
 
 PlatformWindowSize Window::GetSize() { return PlatformWindowGetSize(window_); }
 
+PlatformWindowVisibility Window::GetVisibility() {
+  return PlatformWindowGetVisibility(window_);
+}
+
+bool Window::SetPointerLock(PlatformWindowPointerLock lock) {
+  return PlatformWindowSetPointerLock(window_, lock);
+}
+
+void Window::AckFrame() { PlatformWindowAckFrame(window_); }
+
+PlatformWindowCoalescingStats Window::GetCoalescingStats() {
+  return PlatformWindowGetCoalescingStats(window_);
+}
+
+PlatformWindowStats Window::GetStats() {
+  PlatformWindowStats stats;
+  PlatformWindowGetStats(window_, &stats);
+  return stats;
+}
+
+bool Window::StartRecording(const std::string& path) {
+  return PlatformWindowStartRecording(window_, path.c_str());
+}
+
+void Window::StopRecording() { PlatformWindowStopRecording(window_); }
+
+int Window::GetEventFd() { return PlatformWindowGetEventFd(window_); }
+
+size_t Window::DispatchPending() {
+  return PlatformWindowDispatchPending(window_);
+}
+
+bool Window::WaitForNextFrame() {
+  return PlatformWindowWaitForNextFrame(window_);
+}
+
+std::optional<PlatformWindowFrameTiming> Window::GetFrameTiming() {
+  PlatformWindowFrameTiming timing;
+  if (!PlatformWindowGetFrameTiming(window_, &timing)) {
+    return std::nullopt;
+  }
+  return timing;
+}
+
+Window::Events Window::PollEvents() {
+  // Grow the buffer for as long as the queue keeps filling it.
+  constexpr size_t kPollChunkSize = 256;
+  size_t count = 0;
+  while (true) {
+    polled_events_.resize(count + kPollChunkSize);
+    size_t polled = PlatformWindowPollEvents(
+        window_, polled_events_.data() + count, kPollChunkSize);
+    count += polled;
+    if (polled < kPollChunkSize) {
+      break;
+    }
+  }
+  return Events(polled_events_.data(), polled_events_.data() + count);
+}
+
+bool Window::WaitEvents(std::chrono::milliseconds timeout) {
+  return PlatformWindowWaitEvents(window_,
+                                  static_cast<int32_t>(timeout.count()));
+}
+
 }  // namespace platform_window
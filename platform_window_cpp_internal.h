@@ -0,0 +1,25 @@
+#ifndef _PLATFORM_WINDOW_PLATFORM_WINDOW_CPP_INTERNAL_H_
+#define _PLATFORM_WINDOW_PLATFORM_WINDOW_CPP_INTERNAL_H_
+
+#include <cstddef>
+
+#include "platform_window/platform_window_cpp.h"
+
+// Pieces of the C++ wrapper's event path, exposed so that they can be
+// benchmarked without creating a window.
+namespace platform_window {
+namespace internal {
+
+// Wraps a single event handler so that it can be called with batches.
+Window::BatchEventHandlerFunction AdaptEventHandler(
+    const Window::EventHandlerFunction& event_handler_function);
+
+// The PlatformWindowBatchEventCallback registered by Window, with |context|
+// pointing at a Window::BatchEventHandlerFunction.
+void CallBatchEventHandler(void* context, const PlatformWindowEvent* events,
+                           size_t count);
+
+}  // namespace internal
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_PLATFORM_WINDOW_CPP_INTERNAL_H_
@@ -1,23 +1,313 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "event_coalescer.h"
+#include "event_dispatcher.h"
+#include "event_time.h"
+#include "platform_window/event_loop.h"
+#include "platform_window/frame_timing.h"
+#include "platform_window/headless.h"
 #include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
+
+// A headless backend, for platforms that have no concept of windows (e.g. the
+// EGLDevice/EGLOutput path on Jetson) and for exercising applications' input
+// handling without a display. Events come from
+// PlatformWindowHeadlessInjectEvents() rather than from a window system.
+
+namespace {
+const int kInitialWindowWidth = 1920;
+const int kInitialWindowHeight = 1080;
+
+class PlatformWindowHeadless {
+ public:
+  PlatformWindowHeadless(
+      std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+      uint32_t flags);
+  ~PlatformWindowHeadless();
+
+  platform_window::EventDispatcher* dispatcher() const {
+    return dispatcher_.get();
+  }
+
+  void Show() { visible_.store(true, std::memory_order_relaxed); }
+  void Hide() { visible_.store(false, std::memory_order_relaxed); }
+  bool IsVisible() const { return visible_.load(std::memory_order_relaxed); }
+
+  PlatformWindowSize GetSize() const {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  void InjectEvents(const PlatformWindowEvent* events, size_t count);
+
+  PlatformWindowCoalescingStats GetCoalescingStats() const {
+    return coalescer_.stats();
+  }
+  void GetStats(PlatformWindowStats* stats) const {
+    dispatcher_->GetStats(coalescer_.total_merged(), stats);
+  }
+
+ private:
+  void Run();
+
+  std::unique_ptr<platform_window::EventDispatcher> dispatcher_;
+
+  std::atomic<bool> visible_ = false;
+  // Updated by the event thread as it delivers resize events.
+  std::atomic<PlatformWindowSize> size_;
+  static_assert(std::atomic<PlatformWindowSize>::is_always_lock_free);
+
+  // Only appended to from the event thread.
+  platform_window::EventCoalescer coalescer_;
+
+  // Injected events waiting for the event thread, guarded by |mutex_|. The
+  // event thread swaps the whole vector out, so that injecting threads hold
+  // the lock only for as long as it takes to append.
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<PlatformWindowTimedEvent> pending_events_;
+  bool shutdown_ = false;
+
+  std::thread thread_;
+};
+
+PlatformWindowHeadless::PlatformWindowHeadless(
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+    uint32_t flags)
+    : dispatcher_(std::move(dispatcher)),
+      size_(PlatformWindowSize{kInitialWindowWidth, kInitialWindowHeight}),
+      coalescer_(flags & kPlatformWindowFlagCoalesceMotion),
+      thread_([this] { Run(); }) {}
+
+PlatformWindowHeadless::~PlatformWindowHeadless() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  condition_.notify_one();
+
+  thread_.join();
+}
+
+void PlatformWindowHeadless::InjectEvents(const PlatformWindowEvent* events,
+                                          size_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  // Injection stands in for the platform generating and us receiving the
+  // event, so both timestamps are taken now.
+  const int64_t now_ns = platform_window::MonotonicNowNs();
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    was_empty = pending_events_.empty();
+    for (size_t i = 0; i < count; ++i) {
+      pending_events_.push_back({events[i], now_ns, now_ns});
+    }
+  }
+  if (was_empty) {
+    condition_.notify_one();
+  }
+}
+
+void PlatformWindowHeadless::Run() {
+  std::vector<PlatformWindowTimedEvent> received_events;
+  std::vector<PlatformWindowTimedEvent> events;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock,
+                      [this] { return shutdown_ || !pending_events_.empty(); });
+      if (shutdown_) {
+        return;
+      }
+      received_events.swap(pending_events_);
+    }
+
+    dispatcher_->stats()->RecordQueueDepth(received_events.size());
+    events.clear();
+    for (const PlatformWindowTimedEvent& event : received_events) {
+      dispatcher_->stats()->RecordNativeEvent(event.event.type);
+      if (event.event.type == kPlatformWindowEventTypeResized) {
+        size_.store(event.event.data.resized.size, std::memory_order_release);
+      }
+      coalescer_.Append(event, &events);
+    }
+    received_events.clear();
+
+    dispatcher_->Dispatch(events.data(), events.size());
+  }
+}
+
+PlatformWindow MakeWindow(
+    uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher) {
+  return new PlatformWindowHeadless(std::move(dispatcher), flags);
+}
+
+PlatformWindowHeadless* ToHeadless(PlatformWindow window) {
+  assert(window != INVALID_PLATFORM_WINDOW);
+  return static_cast<PlatformWindowHeadless*>(window);
+}
+}  // namespace
 
 PlatformWindow PlatformWindowMakeDefaultWindow(
     const char* title, PlatformWindowEventCallback event_callback,
     void* context) {
-  // Return any non-zero value to indicate that it is not null/invalid.
-  return reinterpret_cast<PlatformWindow>(sizeof(PlatformWindow));
+  return PlatformWindowMakeWindow(title, kPlatformWindowFlagsNone,
+                                  event_callback, context);
+}
+
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_callback, void* context) {
+  return MakeWindow(
+      flags, platform_window::MakeEventDispatcher(flags, event_callback,
+                                                  context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_callback, void* context) {
+  return MakeWindow(
+      flags, platform_window::MakeEventDispatcher(flags, batch_event_callback,
+                                                  context));
 }
 
-void PlatformWindowDestroyWindow(PlatformWindow platform_window) {}
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_callback,
+    void* context) {
+  return MakeWindow(flags, platform_window::MakeEventDispatcher(
+                               flags, timed_batch_event_callback, context));
+}
+
+void PlatformWindowDestroyWindow(PlatformWindow platform_window) {
+  delete ToHeadless(platform_window);
+}
 
 NativeWindow PlatformWindowGetNativeWindow(PlatformWindow platform_window) {
-  // Return any non-zero value to indicate that it is not null/invalid.
-  return reinterpret_cast<NativeWindow>(sizeof(NativeWindow));
+  // There is no native window, but callers expect a non-null value.
+  return static_cast<NativeWindow>(ToHeadless(platform_window));
+}
+
+void PlatformWindowSetTitle(PlatformWindow platform_window, const char* title) {
+}
+
+void PlatformWindowShow(PlatformWindow platform_window) {
+  ToHeadless(platform_window)->Show();
+}
+
+void PlatformWindowHide(PlatformWindow platform_window) {
+  ToHeadless(platform_window)->Hide();
+}
+
+PlatformWindowSize PlatformWindowGetSize(PlatformWindow platform_window) {
+  return ToHeadless(platform_window)->GetSize();
+}
+
+PlatformWindowVisibility PlatformWindowGetVisibility(
+    PlatformWindow platform_window) {
+  return ToHeadless(platform_window)->IsVisible()
+             ? kPlatformWindowVisibilityVisible
+             : kPlatformWindowVisibilityUnmapped;
+}
+
+bool PlatformWindowSetPointerLock(PlatformWindow platform_window,
+                                  PlatformWindowPointerLock lock) {
+  // There is no pointer to lock.
+  return lock == kPlatformWindowPointerLockNone;
+}
+
+void PlatformWindowAckFrame(PlatformWindow platform_window) {}
+
+bool PlatformWindowWaitForNextFrame(PlatformWindow platform_window) {
+  // There is no display to sync with.
+  return false;
+}
+
+bool PlatformWindowGetFrameTiming(PlatformWindow platform_window,
+                                  PlatformWindowFrameTiming* timing) {
+  return false;
+}
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow platform_window) {
+  return ToHeadless(platform_window)->GetCoalescingStats();
+}
+
+void PlatformWindowGetStats(PlatformWindow platform_window,
+                            PlatformWindowStats* stats) {
+  ToHeadless(platform_window)->GetStats(stats);
+}
+
+size_t PlatformWindowPollEvents(PlatformWindow platform_window,
+                                PlatformWindowEvent* events, size_t max_count) {
+  platform_window::EventQueue* queue =
+      ToHeadless(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+size_t PlatformWindowPollTimedEvents(PlatformWindow platform_window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count) {
+  platform_window::EventQueue* queue =
+      ToHeadless(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+bool PlatformWindowWaitEvents(PlatformWindow platform_window,
+                              int32_t timeout_in_milliseconds) {
+  platform_window::EventQueue* queue =
+      ToHeadless(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Wait(std::chrono::milliseconds(timeout_in_milliseconds));
+}
+
+int PlatformWindowGetEventFd(PlatformWindow platform_window) {
+  // Injected events are always handed to the window's own thread.
+  return -1;
+}
+
+size_t PlatformWindowDispatchPending(PlatformWindow platform_window) {
+  return 0;
+}
+
+bool PlatformWindowStartRecording(PlatformWindow platform_window,
+                                  const char* path) {
+  std::unique_ptr<platform_window::EventRecorder> recorder =
+      platform_window::EventRecorder::Create(path);
+  if (!recorder) {
+    return false;
+  }
+  ToHeadless(platform_window)->dispatcher()->SetRecorder(std::move(recorder));
+  return true;
+}
+
+void PlatformWindowStopRecording(PlatformWindow platform_window) {
+  ToHeadless(platform_window)->dispatcher()->SetRecorder(nullptr);
+}
+
+void PlatformWindowHeadlessInjectEvent(PlatformWindow platform_window,
+                                       const PlatformWindowEvent* event) {
+  ToHeadless(platform_window)->InjectEvents(event, 1);
 }
 
-int32_t PlatformWindowGetWidth(PlatformWindow window) {
-  return 1920;
+void PlatformWindowHeadlessInjectEvents(PlatformWindow platform_window,
+                                        const PlatformWindowEvent* events,
+                                        size_t count) {
+  ToHeadless(platform_window)->InjectEvents(events, count);
 }
 
-int32_t PlatformWindowGetHeight(PlatformWindow window) {
-  return 1080;
+bool PlatformWindowHeadlessIsVisible(PlatformWindow platform_window) {
+  return ToHeadless(platform_window)->IsVisible();
 }
@@ -0,0 +1,1075 @@
+#include <linux/input-event-codes.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include <xkbcommon/xkbcommon.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "event_coalescer.h"
+#include "event_dispatcher.h"
+#include "event_time.h"
+#include "platform_window/event_loop.h"
+#include "platform_window/frame_timing.h"
+#include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
+#include "platform_window/wayland.h"
+#include "x11_keycode_table.h"
+#include "xdg-shell-client-protocol.h"
+
+// A Wayland backend, so that clients on Wayland compositors don't go through
+// Xwayland. Like the XCB backend, every window shares one wl_display: any
+// thread may send requests, which libwayland-client serializes, and a single
+// event thread reads and dispatches events for all windows. Listener
+// callbacks only translate events into per-window batches, which are handed
+// to the windows' dispatchers once everything that was read has been
+// dispatched.
+
+namespace {
+class PlatformWindowWayland;
+
+// There is no single event type enumeration in the protocol, so these stand
+// in as the native event types for PlatformWindowStats.
+enum WaylandNativeEvent {
+  kWaylandNativeEventPointerFrame,
+  kWaylandNativeEventPointerButton,
+  kWaylandNativeEventKey,
+  kWaylandNativeEventConfigure,
+  kWaylandNativeEventClose,
+};
+
+// Used when no wl_output reports its current mode before the first window is
+// created. Otherwise windows start at half of the output's size, as on X11.
+const int kDefaultWindowWidth = 1280;
+const int kDefaultWindowHeight = 720;
+
+// Compositors report 10 units of axis motion per wheel detent, which we map
+// to the 15 degrees of an X11 wheel button press.
+const float kDegreesPerAxisUnit = 1.5f;
+const float kDegreesPerDiscreteStep = 15.0f;
+
+// evdev keycodes are offset by 8 from X11 (and xkb) keycodes.
+const uint32_t kEvdevToXkbKeycodeOffset = 8;
+
+// Newer versions of these interfaces add events whose listeners we would
+// otherwise have to provide.
+const uint32_t kCompositorVersion = 4;
+const uint32_t kWmBaseVersion = 1;
+const uint32_t kSeatVersion = 5;
+const uint32_t kOutputVersion = 1;
+
+// The process-wide display connection, and the event thread that serves it.
+class WaylandConnection {
+ public:
+  static WaylandConnection* Get() {
+    // Intentionally leaked, it lives for the lifetime of the process.
+    static WaylandConnection* connection = new WaylandConnection();
+    return connection;
+  }
+
+  wl_display* display() const { return display_; }
+  wl_compositor* compositor() const { return compositor_; }
+  xdg_wm_base* wm_base() const { return wm_base_; }
+  PlatformWindowSize initial_window_size() const {
+    return initial_window_size_;
+  }
+
+  void AddWindow(PlatformWindowWayland* window);
+  // Unregisters |window| and destroys its Wayland objects. Once this returns,
+  // the event thread is done with |window|.
+  void RemoveWindow(PlatformWindowWayland* window);
+  // Destroys |window|, or if called from an event handler, which may be one
+  // of |window|'s own and so still be running, stops routing events to it
+  // right away and destroys it once the event thread is back out of the
+  // handlers.
+  void DestroyWindow(PlatformWindowWayland* window);
+
+  // Called by listeners, on the event thread, with |mutex_| held.
+  void AddWindowWithEvents(PlatformWindowWayland* window) {
+    windows_with_events_.push_back(window);
+  }
+  void NotifyConfigured() { configure_done_.notify_all(); }
+
+  // Returns once |window| has been configured, or right away on the event
+  // thread, which would otherwise wait on itself.
+  void WaitUntilConfigured(PlatformWindowWayland* window);
+  // Lets Show() wait for the configure that the next commit asks for.
+  void ResetConfigured(PlatformWindowWayland* window);
+  int64_t received_ns() const { return received_ns_; }
+
+ private:
+  // A pointer frame's worth of state, delivered as a whole on wl_pointer.frame.
+  struct PointerFrame {
+    bool moved = false;
+    uint32_t motion_time = 0;
+    struct Button {
+      uint32_t time;
+      uint32_t button;
+      bool pressed;
+    };
+    std::vector<Button> buttons;
+    bool scrolled = false;
+    uint32_t axis_time = 0;
+    double axis_value = 0;
+    int32_t axis_discrete = 0;
+  };
+
+  WaylandConnection();
+
+  void Run();
+  // Returns once the connection is gone.
+  void RunLoop();
+  void DispatchPending();
+  bool IsRegistered(PlatformWindowWayland* window) const {
+    return windows_.count(window) != 0;
+  }
+  // Stops routing events to |window|. Called with |mutex_| held.
+  void UnregisterWindow(PlatformWindowWayland* window);
+
+  void FlushPointerFrame();
+  // Seats older than version 5 send no wl_pointer.frame, so every event is a
+  // frame of its own.
+  void OnPointerEvent(wl_pointer* pointer) {
+    if (wl_pointer_get_version(pointer) < WL_POINTER_FRAME_SINCE_VERSION) {
+      FlushPointerFrame();
+    }
+  }
+
+  static void OnGlobal(void* data, wl_registry* registry, uint32_t name,
+                       const char* interface, uint32_t version);
+  static void OnGlobalRemove(void* data, wl_registry* registry,
+                             uint32_t name) {}
+  static void OnPing(void* data, xdg_wm_base* wm_base, uint32_t serial) {
+    xdg_wm_base_pong(wm_base, serial);
+  }
+  static void OnOutputGeometry(void* data, wl_output* output, int32_t x,
+                               int32_t y, int32_t physical_width,
+                               int32_t physical_height, int32_t subpixel,
+                               const char* make, const char* model,
+                               int32_t transform) {}
+  static void OnOutputMode(void* data, wl_output* output, uint32_t flags,
+                           int32_t width, int32_t height, int32_t refresh);
+  static void OnSeatCapabilities(void* data, wl_seat* seat,
+                                 uint32_t capabilities);
+  static void OnSeatName(void* data, wl_seat* seat, const char* name) {}
+
+  static void OnPointerEnter(void* data, wl_pointer* pointer, uint32_t serial,
+                             wl_surface* surface, wl_fixed_t x, wl_fixed_t y);
+  static void OnPointerLeave(void* data, wl_pointer* pointer, uint32_t serial,
+                             wl_surface* surface);
+  static void OnPointerMotion(void* data, wl_pointer* pointer, uint32_t time,
+                              wl_fixed_t x, wl_fixed_t y);
+  static void OnPointerButton(void* data, wl_pointer* pointer, uint32_t serial,
+                              uint32_t time, uint32_t button, uint32_t state);
+  static void OnPointerAxis(void* data, wl_pointer* pointer, uint32_t time,
+                            uint32_t axis, wl_fixed_t value);
+  static void OnPointerFrame(void* data, wl_pointer* pointer);
+  static void OnPointerAxisSource(void* data, wl_pointer* pointer,
+                                  uint32_t axis_source) {}
+  static void OnPointerAxisStop(void* data, wl_pointer* pointer, uint32_t time,
+                                uint32_t axis) {}
+  static void OnPointerAxisDiscrete(void* data, wl_pointer* pointer,
+                                    uint32_t axis, int32_t discrete);
+
+  static void OnKeyboardKeymap(void* data, wl_keyboard* keyboard,
+                               uint32_t format, int32_t fd, uint32_t size);
+  static void OnKeyboardEnter(void* data, wl_keyboard* keyboard,
+                              uint32_t serial, wl_surface* surface,
+                              wl_array* keys);
+  static void OnKeyboardLeave(void* data, wl_keyboard* keyboard,
+                              uint32_t serial, wl_surface* surface);
+  static void OnKeyboardKey(void* data, wl_keyboard* keyboard, uint32_t serial,
+                            uint32_t time, uint32_t key, uint32_t state);
+  static void OnKeyboardModifiers(void* data, wl_keyboard* keyboard,
+                                  uint32_t serial, uint32_t mods_depressed,
+                                  uint32_t mods_latched, uint32_t mods_locked,
+                                  uint32_t group);
+  static void OnKeyboardRepeatInfo(void* data, wl_keyboard* keyboard,
+                                   int32_t rate, int32_t delay) {}
+
+  static PlatformWindowWayland* WindowFromSurface(wl_surface* surface);
+
+  wl_display* display_;
+  wl_registry* registry_ = nullptr;
+  wl_compositor* compositor_ = nullptr;
+  xdg_wm_base* wm_base_ = nullptr;
+  wl_seat* seat_ = nullptr;
+  wl_output* output_ = nullptr;
+  PlatformWindowSize initial_window_size_ = {kDefaultWindowWidth,
+                                             kDefaultWindowHeight};
+
+  // The rest is guarded by |mutex_|, and in practice only touched by the
+  // event thread, except for window registration.
+  std::mutex mutex_;
+  std::condition_variable dispatch_done_;
+  std::condition_variable configure_done_;
+  // Set once the event thread stops, after which nothing gets configured.
+  bool closed_ = false;
+  std::unordered_set<PlatformWindowWayland*> windows_;
+  // The window whose events the event thread is currently dispatching, if
+  // any.
+  PlatformWindowWayland* dispatching_ = nullptr;
+  std::vector<PlatformWindowWayland*> windows_with_events_;
+  int64_t received_ns_ = 0;
+  // Only accessed from the event thread.
+  std::vector<PlatformWindowWayland*> windows_to_destroy_;
+
+  wl_pointer* pointer_ = nullptr;
+  PlatformWindowWayland* pointer_focus_ = nullptr;
+  // Kept in 24.8 fixed point, as sent, for sub-pixel mouse moves.
+  wl_fixed_t pointer_x_ = 0;
+  wl_fixed_t pointer_y_ = 0;
+  PointerFrame pointer_frame_;
+
+  wl_keyboard* keyboard_ = nullptr;
+  PlatformWindowWayland* keyboard_focus_ = nullptr;
+  xkb_context* xkb_context_;
+  xkb_keymap* xkb_keymap_ = nullptr;
+  xkb_state* xkb_state_ = nullptr;
+
+  std::thread thread_;
+};
+
+class PlatformWindowWayland {
+ public:
+  PlatformWindowWayland(
+      std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+      uint32_t flags, const char* title);
+  ~PlatformWindowWayland();
+
+  wl_surface* surface() const { return surface_; }
+  platform_window::EventDispatcher* dispatcher() const {
+    return dispatcher_.get();
+  }
+
+  void Show();
+  void Hide();
+
+  void SetTitle(const char* title);
+
+  PlatformWindowSize GetSize() const {
+    return size_.load(std::memory_order_acquire);
+  }
+  // Only whether the window was last shown or hidden, as the backend has no
+  // finer visibility to report.
+  PlatformWindowVisibility GetVisibility() const {
+    return shown_.load(std::memory_order_relaxed)
+               ? kPlatformWindowVisibilityVisible
+               : kPlatformWindowVisibilityUnmapped;
+  }
+
+  PlatformWindowCoalescingStats GetCoalescingStats() const {
+    return coalescer_.stats();
+  }
+  void GetStats(PlatformWindowStats* stats) const {
+    dispatcher_->GetStats(coalescer_.total_merged(), stats);
+  }
+
+  // The following are only called from the event thread.
+
+  // Returns when an event stamped with |time_ms| was generated.
+  int64_t GetTimestampNs(uint32_t time_ms, int64_t received_ns) {
+    return time_mapper_.ToMonotonicNs(time_ms, received_ns);
+  }
+  // Queues an event for the next DispatchPendingEvents().
+  void Append(WaylandNativeEvent native_type, PlatformWindowEventType type,
+              const PlatformWindowEventData& data, int64_t timestamp_ns);
+  void DispatchPendingEvents();
+  // Only called by WaylandConnection::RemoveWindow().
+  void DestroySurface();
+
+  // Only called with the WaylandConnection's mutex held.
+  bool configured() const { return configured_; }
+  void set_configured(bool configured) { configured_ = configured; }
+
+ private:
+  static void OnSurfaceConfigure(void* data, xdg_surface* xdg_surface,
+                                 uint32_t serial);
+  static void OnToplevelConfigure(void* data, xdg_toplevel* toplevel,
+                                  int32_t width, int32_t height,
+                                  wl_array* states);
+  static void OnToplevelClose(void* data, xdg_toplevel* toplevel);
+
+  std::unique_ptr<platform_window::EventDispatcher> dispatcher_;
+
+  wl_display* display_;
+  wl_surface* surface_;
+  xdg_surface* xdg_surface_;
+  xdg_toplevel* xdg_toplevel_;
+
+  std::atomic<bool> shown_ = false;
+  // Whether the compositor has configured the window since it was last
+  // hidden, which it must have before a buffer may be attached. Guarded by
+  // the WaylandConnection's mutex.
+  bool configured_ = false;
+
+  // Written by the event thread as configures are acknowledged, so that
+  // GetSize() can be answered without a round trip.
+  std::atomic<PlatformWindowSize> size_;
+  static_assert(std::atomic<PlatformWindowSize>::is_always_lock_free);
+
+  // The rest is only accessed from the event thread.
+  // The size from the last xdg_toplevel.configure, which takes effect with
+  // the xdg_surface.configure that ends the sequence.
+  PlatformWindowSize configured_size_;
+  platform_window::EventTimeMapper time_mapper_;
+  platform_window::EventCoalescer coalescer_;
+  std::vector<PlatformWindowTimedEvent> pending_events_;
+  size_t pending_native_events_ = 0;
+};
+
+WaylandConnection::WaylandConnection()
+    : display_(wl_display_connect(NULL)),
+      xkb_context_(xkb_context_new(XKB_CONTEXT_NO_FLAGS)) {
+  assert(display_);
+
+  static const wl_registry_listener kRegistryListener = {
+      &WaylandConnection::OnGlobal,
+      &WaylandConnection::OnGlobalRemove,
+  };
+  registry_ = wl_display_get_registry(display_);
+  wl_registry_add_listener(registry_, &kRegistryListener, this);
+  // The first round trip binds the globals, the second one collects the
+  // seat's capabilities and the output's mode.
+  wl_display_roundtrip(display_);
+  wl_display_roundtrip(display_);
+  assert(compositor_ && wm_base_);
+
+  thread_ = std::thread([this] { Run(); });
+}
+
+void WaylandConnection::OnGlobal(void* data, wl_registry* registry,
+                                 uint32_t name, const char* interface,
+                                 uint32_t version) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  if (strcmp(interface, wl_compositor_interface.name) == 0) {
+    connection->compositor_ = static_cast<wl_compositor*>(
+        wl_registry_bind(registry, name, &wl_compositor_interface,
+                         std::min(version, kCompositorVersion)));
+  } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+    static const xdg_wm_base_listener kWmBaseListener = {
+        &WaylandConnection::OnPing,
+    };
+    connection->wm_base_ = static_cast<xdg_wm_base*>(wl_registry_bind(
+        registry, name, &xdg_wm_base_interface, kWmBaseVersion));
+    xdg_wm_base_add_listener(connection->wm_base_, &kWmBaseListener,
+                             connection);
+  } else if (strcmp(interface, wl_seat_interface.name) == 0 &&
+             !connection->seat_) {
+    static const wl_seat_listener kSeatListener = {
+        &WaylandConnection::OnSeatCapabilities,
+        &WaylandConnection::OnSeatName,
+    };
+    connection->seat_ = static_cast<wl_seat*>(wl_registry_bind(
+        registry, name, &wl_seat_interface, std::min(version, kSeatVersion)));
+    wl_seat_add_listener(connection->seat_, &kSeatListener, connection);
+  } else if (strcmp(interface, wl_output_interface.name) == 0 &&
+             !connection->output_) {
+    static const wl_output_listener kOutputListener = {
+        &WaylandConnection::OnOutputGeometry,
+        &WaylandConnection::OnOutputMode,
+    };
+    connection->output_ = static_cast<wl_output*>(wl_registry_bind(
+        registry, name, &wl_output_interface, kOutputVersion));
+    wl_output_add_listener(connection->output_, &kOutputListener, connection);
+  }
+}
+
+void WaylandConnection::OnOutputMode(void* data, wl_output* output,
+                                     uint32_t flags, int32_t width,
+                                     int32_t height, int32_t refresh) {
+  if (flags & WL_OUTPUT_MODE_CURRENT) {
+    static_cast<WaylandConnection*>(data)->initial_window_size_ = {width / 2,
+                                                                   height / 2};
+  }
+}
+
+void WaylandConnection::OnSeatCapabilities(void* data, wl_seat* seat,
+                                           uint32_t capabilities) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+
+  const bool has_pointer = capabilities & WL_SEAT_CAPABILITY_POINTER;
+  if (has_pointer && !connection->pointer_) {
+    static const wl_pointer_listener kPointerListener = {
+        &WaylandConnection::OnPointerEnter,
+        &WaylandConnection::OnPointerLeave,
+        &WaylandConnection::OnPointerMotion,
+        &WaylandConnection::OnPointerButton,
+        &WaylandConnection::OnPointerAxis,
+        &WaylandConnection::OnPointerFrame,
+        &WaylandConnection::OnPointerAxisSource,
+        &WaylandConnection::OnPointerAxisStop,
+        &WaylandConnection::OnPointerAxisDiscrete,
+    };
+    connection->pointer_ = wl_seat_get_pointer(seat);
+    wl_pointer_add_listener(connection->pointer_, &kPointerListener,
+                            connection);
+  } else if (!has_pointer && connection->pointer_) {
+    if (wl_pointer_get_version(connection->pointer_) >=
+        WL_POINTER_RELEASE_SINCE_VERSION) {
+      wl_pointer_release(connection->pointer_);
+    } else {
+      wl_pointer_destroy(connection->pointer_);
+    }
+    connection->pointer_ = nullptr;
+    connection->pointer_focus_ = nullptr;
+  }
+
+  const bool has_keyboard = capabilities & WL_SEAT_CAPABILITY_KEYBOARD;
+  if (has_keyboard && !connection->keyboard_) {
+    static const wl_keyboard_listener kKeyboardListener = {
+        &WaylandConnection::OnKeyboardKeymap,
+        &WaylandConnection::OnKeyboardEnter,
+        &WaylandConnection::OnKeyboardLeave,
+        &WaylandConnection::OnKeyboardKey,
+        &WaylandConnection::OnKeyboardModifiers,
+        &WaylandConnection::OnKeyboardRepeatInfo,
+    };
+    connection->keyboard_ = wl_seat_get_keyboard(seat);
+    wl_keyboard_add_listener(connection->keyboard_, &kKeyboardListener,
+                             connection);
+  } else if (!has_keyboard && connection->keyboard_) {
+    if (wl_keyboard_get_version(connection->keyboard_) >=
+        WL_KEYBOARD_RELEASE_SINCE_VERSION) {
+      wl_keyboard_release(connection->keyboard_);
+    } else {
+      wl_keyboard_destroy(connection->keyboard_);
+    }
+    connection->keyboard_ = nullptr;
+    connection->keyboard_focus_ = nullptr;
+  }
+}
+
+PlatformWindowWayland* WaylandConnection::WindowFromSurface(
+    wl_surface* surface) {
+  // Events that refer to a surface that has since been destroyed carry null.
+  return surface ? static_cast<PlatformWindowWayland*>(
+                       wl_surface_get_user_data(surface))
+                 : nullptr;
+}
+
+void WaylandConnection::OnPointerEnter(void* data, wl_pointer* pointer,
+                                       uint32_t serial, wl_surface* surface,
+                                       wl_fixed_t x, wl_fixed_t y) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  connection->pointer_focus_ = WindowFromSurface(surface);
+  connection->pointer_x_ = x;
+  connection->pointer_y_ = y;
+  // Entering carries no timestamp, so the move is stamped on receipt.
+  connection->pointer_frame_.moved = true;
+  connection->pointer_frame_.motion_time = 0;
+  connection->OnPointerEvent(pointer);
+}
+
+void WaylandConnection::OnPointerLeave(void* data, wl_pointer* pointer,
+                                       uint32_t serial, wl_surface* surface) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  // Whatever the frame holds belongs to the window being left.
+  connection->FlushPointerFrame();
+  connection->pointer_focus_ = nullptr;
+}
+
+void WaylandConnection::OnPointerMotion(void* data, wl_pointer* pointer,
+                                        uint32_t time, wl_fixed_t x,
+                                        wl_fixed_t y) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  connection->pointer_x_ = x;
+  connection->pointer_y_ = y;
+  connection->pointer_frame_.moved = true;
+  connection->pointer_frame_.motion_time = time;
+  connection->OnPointerEvent(pointer);
+}
+
+void WaylandConnection::OnPointerButton(void* data, wl_pointer* pointer,
+                                        uint32_t serial, uint32_t time,
+                                        uint32_t button, uint32_t state) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  connection->pointer_frame_.buttons.push_back(
+      {time, button, state == WL_POINTER_BUTTON_STATE_PRESSED});
+  connection->OnPointerEvent(pointer);
+}
+
+void WaylandConnection::OnPointerAxis(void* data, wl_pointer* pointer,
+                                      uint32_t time, uint32_t axis,
+                                      wl_fixed_t value) {
+  if (axis != WL_POINTER_AXIS_VERTICAL_SCROLL) {
+    return;
+  }
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  PointerFrame* frame = &connection->pointer_frame_;
+  frame->scrolled = true;
+  frame->axis_time = time;
+  frame->axis_value += wl_fixed_to_double(value);
+  connection->OnPointerEvent(pointer);
+}
+
+void WaylandConnection::OnPointerAxisDiscrete(void* data, wl_pointer* pointer,
+                                              uint32_t axis,
+                                              int32_t discrete) {
+  if (axis != WL_POINTER_AXIS_VERTICAL_SCROLL) {
+    return;
+  }
+  static_cast<WaylandConnection*>(data)->pointer_frame_.axis_discrete +=
+      discrete;
+}
+
+void WaylandConnection::OnPointerFrame(void* data, wl_pointer* pointer) {
+  static_cast<WaylandConnection*>(data)->FlushPointerFrame();
+}
+
+void WaylandConnection::FlushPointerFrame() {
+  PointerFrame frame = std::move(pointer_frame_);
+  pointer_frame_ = PointerFrame();
+  PlatformWindowWayland* window = pointer_focus_;
+  if (!window) {
+    return;
+  }
+
+  // A frame may hold several events that logically happened together; the
+  // move goes first, so that buttons and the wheel apply at the new position.
+  if (frame.moved) {
+    PlatformWindowEventData data;
+    data.mouse_move.x = wl_fixed_to_int(pointer_x_);
+    data.mouse_move.y = wl_fixed_to_int(pointer_y_);
+    data.mouse_move.precise_x = wl_fixed_to_double(pointer_x_);
+    data.mouse_move.precise_y = wl_fixed_to_double(pointer_y_);
+    window->Append(kWaylandNativeEventPointerFrame,
+                   kPlatformWindowEventTypeMouseMove, data,
+                   frame.motion_time
+                       ? window->GetTimestampNs(frame.motion_time, received_ns_)
+                       : received_ns_);
+  }
+  for (const PointerFrame::Button& button : frame.buttons) {
+    PlatformWindowEventData data;
+    data.mouse_button.pressed = button.pressed;
+    data.mouse_button.button = [&button] {
+      switch (button.button) {
+        case BTN_LEFT:
+          return kPlatformWindowMouseLeft;
+        case BTN_RIGHT:
+          return kPlatformWindowMouseRight;
+        default:
+          return kPlatformWindowMouseUnknown;
+      }
+    }();
+    data.mouse_button.x = wl_fixed_to_int(pointer_x_);
+    data.mouse_button.y = wl_fixed_to_int(pointer_y_);
+    window->Append(kWaylandNativeEventPointerButton,
+                   kPlatformWindowEventTypeMouseButton, data,
+                   window->GetTimestampNs(button.time, received_ns_));
+  }
+  if (frame.scrolled) {
+    // Wayland's axis grows downwards, while positive angles scroll up. Prefer
+    // whole wheel steps when the compositor reports them.
+    PlatformWindowEventData data;
+    data.mouse_wheel.angle_in_degrees =
+        frame.axis_discrete != 0
+            ? -kDegreesPerDiscreteStep * frame.axis_discrete
+            : static_cast<float>(-kDegreesPerAxisUnit * frame.axis_value);
+    data.mouse_wheel.x = wl_fixed_to_int(pointer_x_);
+    data.mouse_wheel.y = wl_fixed_to_int(pointer_y_);
+    window->Append(kWaylandNativeEventPointerFrame,
+                   kPlatformWindowEventTypeMouseWheel, data,
+                   window->GetTimestampNs(frame.axis_time, received_ns_));
+  }
+}
+
+void WaylandConnection::OnKeyboardKeymap(void* data, wl_keyboard* keyboard,
+                                         uint32_t format, int32_t fd,
+                                         uint32_t size) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  if (format != WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1) {
+    close(fd);
+    return;
+  }
+  char* keymap_string =
+      static_cast<char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+  close(fd);
+  if (keymap_string == MAP_FAILED) {
+    return;
+  }
+  xkb_keymap* keymap = xkb_keymap_new_from_string(
+      connection->xkb_context_, keymap_string, XKB_KEYMAP_FORMAT_TEXT_V1,
+      XKB_KEYMAP_COMPILE_NO_FLAGS);
+  munmap(keymap_string, size);
+  if (!keymap) {
+    return;
+  }
+
+  xkb_state_unref(connection->xkb_state_);
+  xkb_keymap_unref(connection->xkb_keymap_);
+  connection->xkb_keymap_ = keymap;
+  connection->xkb_state_ = xkb_state_new(keymap);
+}
+
+void WaylandConnection::OnKeyboardEnter(void* data, wl_keyboard* keyboard,
+                                        uint32_t serial, wl_surface* surface,
+                                        wl_array* keys) {
+  static_cast<WaylandConnection*>(data)->keyboard_focus_ =
+      WindowFromSurface(surface);
+}
+
+void WaylandConnection::OnKeyboardLeave(void* data, wl_keyboard* keyboard,
+                                        uint32_t serial, wl_surface* surface) {
+  static_cast<WaylandConnection*>(data)->keyboard_focus_ = nullptr;
+}
+
+void WaylandConnection::OnKeyboardKey(void* data, wl_keyboard* keyboard,
+                                      uint32_t serial, uint32_t time,
+                                      uint32_t key, uint32_t state) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  PlatformWindowWayland* window = connection->keyboard_focus_;
+  if (!window) {
+    return;
+  }
+
+  // Keysyms are shared with X11, and so is their translation. Like the X11
+  // backends, fall back to the default US layout for unknown keysyms.
+  const uint32_t keycode = key + kEvdevToXkbKeycodeOffset;
+  PlatformWindowKey platform_key = kPlatformWindowKeyUnknown;
+  if (connection->xkb_state_) {
+    platform_key = platform_window::KeysymToPlatformWindowKey(
+        xkb_state_key_get_one_sym(connection->xkb_state_, keycode));
+  }
+  if (platform_key == kPlatformWindowKeyUnknown) {
+    platform_key = platform_window::KeysymToPlatformWindowKey(
+        platform_window::HardwareKeycodeToDefaultXKeysym(keycode));
+  }
+
+  PlatformWindowEventData event_data;
+  event_data.key.pressed = (state == WL_KEYBOARD_KEY_STATE_PRESSED);
+  event_data.key.key = platform_key;
+  // Reported as the X11 keycode, so that positional bindings carry over.
+  event_data.key.scancode = keycode;
+  window->Append(kWaylandNativeEventKey, kPlatformWindowEventTypeKey,
+                 event_data,
+                 window->GetTimestampNs(time, connection->received_ns_));
+}
+
+void WaylandConnection::OnKeyboardModifiers(
+    void* data, wl_keyboard* keyboard, uint32_t serial,
+    uint32_t mods_depressed, uint32_t mods_latched, uint32_t mods_locked,
+    uint32_t group) {
+  WaylandConnection* connection = static_cast<WaylandConnection*>(data);
+  if (connection->xkb_state_) {
+    xkb_state_update_mask(connection->xkb_state_, mods_depressed,
+                          mods_latched, mods_locked, 0, 0, group);
+  }
+}
+
+void WaylandConnection::AddWindow(PlatformWindowWayland* window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  windows_.insert(window);
+}
+
+void WaylandConnection::UnregisterWindow(PlatformWindowWayland* window) {
+  windows_.erase(window);
+  if (pointer_focus_ == window) {
+    pointer_focus_ = nullptr;
+  }
+  if (keyboard_focus_ == window) {
+    keyboard_focus_ = nullptr;
+  }
+}
+
+void WaylandConnection::RemoveWindow(PlatformWindowWayland* window) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  UnregisterWindow(window);
+  // Windows destroyed from the event thread are only removed once it is done
+  // dispatching (see DestroyWindow()), and it must not wait on itself.
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    dispatch_done_.wait(lock,
+                        [this, window] { return dispatching_ != window; });
+  }
+  // Listeners run with |mutex_| held, so none of them can be looking at the
+  // objects while they are destroyed.
+  window->DestroySurface();
+  wl_display_flush(display_);
+}
+
+void WaylandConnection::DestroyWindow(PlatformWindowWayland* window) {
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    delete window;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    UnregisterWindow(window);
+  }
+  windows_to_destroy_.push_back(window);
+}
+
+void WaylandConnection::WaitUntilConfigured(PlatformWindowWayland* window) {
+  if (std::this_thread::get_id() == thread_.get_id()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  configure_done_.wait(
+      lock, [this, window] { return window->configured() || closed_; });
+}
+
+void WaylandConnection::ResetConfigured(PlatformWindowWayland* window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  window->set_configured(false);
+}
+
+void WaylandConnection::Run() {
+  RunLoop();
+  std::lock_guard<std::mutex> lock(mutex_);
+  closed_ = true;
+  configure_done_.notify_all();
+}
+
+void WaylandConnection::RunLoop() {
+  pollfd display_fd = {wl_display_get_fd(display_), POLLIN, 0};
+  while (true) {
+    // Events may already have been queued, e.g. by another thread's round
+    // trip, in which case they must be dispatched before we may read.
+    while (wl_display_prepare_read(display_) != 0) {
+      DispatchPending();
+    }
+    wl_display_flush(display_);
+
+    if (poll(&display_fd, 1, -1) < 0) {
+      wl_display_cancel_read(display_);
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (wl_display_read_events(display_) < 0) {
+      // The connection is gone.
+      return;
+    }
+    DispatchPending();
+  }
+}
+
+void WaylandConnection::DispatchPending() {
+  // Translate everything that has been read, so that each window gets it in a
+  // single batch.
+  windows_with_events_.clear();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    received_ns_ = platform_window::MonotonicNowNs();
+    wl_display_dispatch_pending(display_);
+  }
+
+  for (PlatformWindowWayland* window : windows_with_events_) {
+    {
+      // Skip windows that an earlier handler destroyed.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!IsRegistered(window)) {
+        continue;
+      }
+      dispatching_ = window;
+    }
+    window->DispatchPendingEvents();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      dispatching_ = nullptr;
+    }
+    dispatch_done_.notify_all();
+  }
+
+  std::vector<PlatformWindowWayland*> windows;
+  windows.swap(windows_to_destroy_);
+  for (PlatformWindowWayland* window : windows) {
+    delete window;
+  }
+}
+
+PlatformWindowWayland::PlatformWindowWayland(
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+    uint32_t flags, const char* title)
+    : dispatcher_(std::move(dispatcher)),
+      display_(WaylandConnection::Get()->display()),
+      size_(WaylandConnection::Get()->initial_window_size()),
+      configured_size_(WaylandConnection::Get()->initial_window_size()),
+      coalescer_(flags & kPlatformWindowFlagCoalesceMotion) {
+  static const xdg_surface_listener kSurfaceListener = {
+      &PlatformWindowWayland::OnSurfaceConfigure,
+  };
+  static const xdg_toplevel_listener kToplevelListener = {
+      &PlatformWindowWayland::OnToplevelConfigure,
+      &PlatformWindowWayland::OnToplevelClose,
+  };
+
+  WaylandConnection* connection = WaylandConnection::Get();
+  surface_ = wl_compositor_create_surface(connection->compositor());
+  wl_surface_set_user_data(surface_, this);
+  xdg_surface_ = xdg_wm_base_get_xdg_surface(connection->wm_base(), surface_);
+  xdg_surface_add_listener(xdg_surface_, &kSurfaceListener, this);
+  xdg_toplevel_ = xdg_surface_get_toplevel(xdg_surface_);
+  xdg_toplevel_add_listener(xdg_toplevel_, &kToplevelListener, this);
+  xdg_toplevel_set_title(xdg_toplevel_, title);
+
+  connection->AddWindow(this);
+  wl_display_flush(display_);
+}
+
+PlatformWindowWayland::~PlatformWindowWayland() {
+  WaylandConnection::Get()->RemoveWindow(this);
+}
+
+void PlatformWindowWayland::DestroySurface() {
+  xdg_toplevel_destroy(xdg_toplevel_);
+  xdg_surface_destroy(xdg_surface_);
+  wl_surface_destroy(surface_);
+}
+
+void PlatformWindowWayland::Show() {
+  shown_.store(true, std::memory_order_relaxed);
+  // Committing without a buffer asks the compositor for the initial
+  // configure. The window appears once the client (e.g. its Vulkan swapchain)
+  // presents to the surface, which it may only do once configured.
+  wl_surface_commit(surface_);
+  wl_display_flush(display_);
+  WaylandConnection::Get()->WaitUntilConfigured(this);
+}
+
+void PlatformWindowWayland::Hide() {
+  shown_.store(false, std::memory_order_relaxed);
+  WaylandConnection::Get()->ResetConfigured(this);
+  // Removing the buffer unmaps the surface. Show() then starts over with a
+  // new initial commit.
+  wl_surface_attach(surface_, nullptr, 0, 0);
+  wl_surface_commit(surface_);
+  wl_display_flush(display_);
+}
+
+void PlatformWindowWayland::SetTitle(const char* title) {
+  xdg_toplevel_set_title(xdg_toplevel_, title);
+  wl_display_flush(display_);
+}
+
+void PlatformWindowWayland::Append(WaylandNativeEvent native_type,
+                                   PlatformWindowEventType type,
+                                   const PlatformWindowEventData& data,
+                                   int64_t timestamp_ns) {
+  WaylandConnection* connection = WaylandConnection::Get();
+  if (pending_native_events_++ == 0) {
+    connection->AddWindowWithEvents(this);
+  }
+  dispatcher_->stats()->RecordNativeEvent(native_type);
+  coalescer_.Append({{type, data}, timestamp_ns, connection->received_ns()},
+                    &pending_events_);
+}
+
+void PlatformWindowWayland::DispatchPendingEvents() {
+  dispatcher_->stats()->RecordQueueDepth(pending_native_events_);
+  pending_native_events_ = 0;
+  if (!pending_events_.empty()) {
+    dispatcher_->Dispatch(pending_events_.data(), pending_events_.size());
+    pending_events_.clear();
+  }
+}
+
+void PlatformWindowWayland::OnToplevelConfigure(void* data,
+                                                xdg_toplevel* toplevel,
+                                                int32_t width, int32_t height,
+                                                wl_array* states) {
+  // Zero means that the compositor leaves the size up to us.
+  if (width > 0 && height > 0) {
+    static_cast<PlatformWindowWayland*>(data)->configured_size_ = {width,
+                                                                   height};
+  }
+}
+
+void PlatformWindowWayland::OnSurfaceConfigure(void* data,
+                                               xdg_surface* xdg_surface,
+                                               uint32_t serial) {
+  PlatformWindowWayland* window = static_cast<PlatformWindowWayland*>(data);
+  xdg_surface_ack_configure(xdg_surface, serial);
+  window->set_configured(true);
+  WaylandConnection::Get()->NotifyConfigured();
+
+  // Configures also come with state changes, such as focus, that leave the
+  // size alone.
+  const PlatformWindowSize size = window->configured_size_;
+  const PlatformWindowSize old_size =
+      window->size_.load(std::memory_order_relaxed);
+  if (size.width == old_size.width && size.height == old_size.height) {
+    return;
+  }
+  window->size_.store(size, std::memory_order_release);
+  PlatformWindowEventData event_data;
+  event_data.resized = {};
+  event_data.resized.size = size;
+  const int64_t received_ns = WaylandConnection::Get()->received_ns();
+  window->Append(kWaylandNativeEventConfigure, kPlatformWindowEventTypeResized,
+                 event_data, received_ns);
+}
+
+void PlatformWindowWayland::OnToplevelClose(void* data,
+                                            xdg_toplevel* toplevel) {
+  PlatformWindowWayland* window = static_cast<PlatformWindowWayland*>(data);
+  window->Append(kWaylandNativeEventClose, kPlatformWindowEventTypeQuitRequest,
+                 {}, WaylandConnection::Get()->received_ns());
+}
+
+PlatformWindow MakeWindow(
+    const char* title, uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher) {
+  return new PlatformWindowWayland(std::move(dispatcher), flags, title);
+}
+}  // namespace
+
+PlatformWindow PlatformWindowMakeDefaultWindow(
+    const char* title, PlatformWindowEventCallback event_callback,
+    void* context) {
+  return PlatformWindowMakeWindow(title, kPlatformWindowFlagsNone,
+                                  event_callback, context);
+}
+
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, event_callback, context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, batch_event_callback,
+                                           context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_callback,
+    void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, timed_batch_event_callback,
+                                           context));
+}
+
+void PlatformWindowDestroyWindow(PlatformWindow platform_window) {
+  WaylandConnection::Get()->DestroyWindow(
+      static_cast<PlatformWindowWayland*>(platform_window));
+}
+
+NativeWindow PlatformWindowGetNativeWindow(PlatformWindow platform_window) {
+  return static_cast<PlatformWindowWayland*>(platform_window)->surface();
+}
+
+void PlatformWindowShow(PlatformWindow window) {
+  static_cast<PlatformWindowWayland*>(window)->Show();
+}
+
+void PlatformWindowHide(PlatformWindow window) {
+  static_cast<PlatformWindowWayland*>(window)->Hide();
+}
+
+void PlatformWindowSetTitle(PlatformWindow window, const char* title) {
+  static_cast<PlatformWindowWayland*>(window)->SetTitle(title);
+}
+
+PlatformWindowSize PlatformWindowGetSize(PlatformWindow window) {
+  return static_cast<PlatformWindowWayland*>(window)->GetSize();
+}
+
+PlatformWindowVisibility PlatformWindowGetVisibility(PlatformWindow window) {
+  return static_cast<PlatformWindowWayland*>(window)->GetVisibility();
+}
+
+bool PlatformWindowSetPointerLock(PlatformWindow window,
+                                  PlatformWindowPointerLock lock) {
+  // Unsupported, as documented in the header. Would need
+  // zwp_pointer_constraints_v1 and zwp_relative_pointer_v1.
+  return lock == kPlatformWindowPointerLockNone;
+}
+
+void PlatformWindowAckFrame(PlatformWindow window) {
+  // The compositor synchronizes resizes with surface commits.
+}
+
+bool PlatformWindowWaitForNextFrame(PlatformWindow window) {
+  // Unsupported, as documented in frame_timing.h. Vulkan's FIFO present mode
+  // paces through the compositor's frame callbacks already.
+  return false;
+}
+
+bool PlatformWindowGetFrameTiming(PlatformWindow window,
+                                  PlatformWindowFrameTiming* timing) {
+  return false;
+}
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow window) {
+  return static_cast<PlatformWindowWayland*>(window)->GetCoalescingStats();
+}
+
+void PlatformWindowGetStats(PlatformWindow window, PlatformWindowStats* stats) {
+  static_cast<PlatformWindowWayland*>(window)->GetStats(stats);
+}
+
+size_t PlatformWindowPollEvents(PlatformWindow window,
+                                PlatformWindowEvent* events, size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowWayland*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+size_t PlatformWindowPollTimedEvents(PlatformWindow window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowWayland*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+bool PlatformWindowWaitEvents(PlatformWindow window,
+                              int32_t timeout_in_milliseconds) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowWayland*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Wait(std::chrono::milliseconds(timeout_in_milliseconds));
+}
+
+int PlatformWindowGetEventFd(PlatformWindow window) {
+  // Events are read by the connection's own thread, which
+  // kPlatformWindowFlagNoEventThread does not change.
+  return -1;
+}
+
+size_t PlatformWindowDispatchPending(PlatformWindow window) { return 0; }
+
+bool PlatformWindowStartRecording(PlatformWindow window, const char* path) {
+  std::unique_ptr<platform_window::EventRecorder> recorder =
+      platform_window::EventRecorder::Create(path);
+  if (!recorder) {
+    return false;
+  }
+  static_cast<PlatformWindowWayland*>(window)->dispatcher()->SetRecorder(
+      std::move(recorder));
+  return true;
+}
+
+void PlatformWindowStopRecording(PlatformWindow window) {
+  static_cast<PlatformWindowWayland*>(window)->dispatcher()->SetRecorder(
+      nullptr);
+}
+
+wl_display* PlatformWindowWaylandGetDisplay() {
+  return WaylandConnection::Get()->display();
+}
@@ -3,14 +3,21 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
 
+#include "event_dispatcher.h"
+#include "event_time.h"
+#include "platform_window/event_loop.h"
+#include "platform_window/frame_timing.h"
 #include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
 
 namespace {
 const int kInitialWindowWidth = 1920;
@@ -18,8 +25,10 @@ const int kInitialWindowHeight = 1080;
 
 class Window {
  public:
-  Window(const char* title, PlatformWindowEventCallback event_callback,
-         void* event_callback_context);
+  // Creates the window on a new event thread, or on the calling thread if
+  // |flags| has kPlatformWindowFlagNoEventThread.
+  Window(const char* title, uint32_t flags,
+         std::unique_ptr<platform_window::EventDispatcher> dispatcher);
   ~Window();
 
   bool error() { return hwnd() == NULL; }
@@ -36,6 +45,14 @@ class Window {
 
   PlatformWindowSize GetSize();
 
+  platform_window::EventDispatcher* dispatcher() const {
+    return dispatcher_.get();
+  }
+
+  // For kPlatformWindowFlagNoEventThread. Must be called from the thread that
+  // created the window.
+  size_t DispatchPending();
+
  private:
   void WaitForInitialization() {
     std::unique_lock lock(mutex_);
@@ -47,14 +64,24 @@ class Window {
 
   long OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp);
 
+  // Timestamps |event| using the time of the message currently being
+  // processed, and dispatches it.
+  void DispatchEvent(const PlatformWindowEvent& event);
+
   bool any_buttons_pressed() const {
     return std::any_of(is_pressed_.begin(), is_pressed_.end(),
                        [](bool x) { return x; });
   }
   bool initialized_ = false;
-  PlatformWindowEventCallback event_callback_;
-  void* context_;
-  PlatformWindowSize size_;
+  // Win32 hands us one message at a time, so events are dispatched as
+  // batches of one.
+  std::unique_ptr<platform_window::EventDispatcher> dispatcher_;
+  // Only accessed from the window thread.
+  platform_window::EventTimeMapper time_mapper_;
+  // Updated from WM_SIZE on the window thread and read lock-free from any
+  // thread by GetSize().
+  std::atomic<PlatformWindowSize> size_;
+  static_assert(std::atomic<PlatformWindowSize>::is_always_lock_free);
 
   std::mutex mutex_;
   std::condition_variable initialized_condition_;
@@ -67,10 +94,22 @@ class Window {
   friend LRESULT CALLBACK HandleWindowEvent(HWND, UINT, WPARAM, LPARAM);
 };
 
-thread_local Window* s_window = nullptr;
-
+// Several windows may share a thread when they have no event thread of their
+// own, so each HWND carries a pointer to its Window, passed to CreateWindowEx()
+// and stored on WM_NCCREATE. The few messages sent before that get the default
+// handling.
 LRESULT CALLBACK HandleWindowEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
-  return s_window->OnEvent(hwnd, msg, wp, lp);
+  if (msg == WM_NCCREATE) {
+    const CREATESTRUCT* create_struct = reinterpret_cast<CREATESTRUCT*>(lp);
+    SetWindowLongPtr(hwnd, GWLP_USERDATA,
+                     reinterpret_cast<LONG_PTR>(create_struct->lpCreateParams));
+  }
+  Window* window =
+      reinterpret_cast<Window*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+  if (!window) {
+    return DefWindowProc(hwnd, msg, wp, lp);
+  }
+  return window->OnEvent(hwnd, msg, wp, lp);
 }
 
 bool PumpNextWindowEvent() {
@@ -83,16 +122,26 @@ bool PumpNextWindowEvent() {
   }
 }
 
-Window::Window(const char* title, PlatformWindowEventCallback event_callback,
-               void* event_callback_context)
-    : event_callback_(event_callback),
-      context_(event_callback_context),
-      size_{kInitialWindowWidth, kInitialWindowHeight},
-      thread_(&Window::Run, this, title) {
+Window::Window(const char* title, uint32_t flags,
+               std::unique_ptr<platform_window::EventDispatcher> dispatcher)
+    : dispatcher_(std::move(dispatcher)),
+      size_(PlatformWindowSize{kInitialWindowWidth, kInitialWindowHeight}) {
   is_pressed_.fill(false);
+  if (flags & kPlatformWindowFlagNoEventThread) {
+    Start(title);
+  } else {
+    thread_ = std::thread(&Window::Run, this, title);
+  }
 }
 
 Window::~Window() {
+  if (!thread_.joinable()) {
+    if (!error()) {
+      Shutdown();
+    }
+    return;
+  }
+
   if (!error()) {
     PostMessageA(hwnd(), WM_QUIT, 0, 0);
   }
@@ -106,8 +155,7 @@ void Window::Hide() { ShowWindow(hwnd_, SW_HIDE); }
 void Window::SetTitle(const char* title) { SetWindowTextA(hwnd_, title); }
 
 PlatformWindowSize Window::GetSize() {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return size_;
+  return size_.load(std::memory_order_acquire);
 }
 
 void Window::Run(const char* title) {
@@ -146,15 +194,13 @@ const LPCSTR CreateWindowClass() {
 void Window::Start(const char* title) {
   static auto window_class = CreateWindowClass();
 
-  s_window = this;
-
   DWORD style =
       WS_CAPTION | WS_SYSMENU | WS_MINIMIZEBOX | WS_MAXIMIZEBOX | WS_THICKFRAME;
 
   PlatformWindowSize size = GetSize();
   hwnd_ = CreateWindowEx(0, window_class, title, style, CW_USEDEFAULT,
                          CW_USEDEFAULT, size.width, size.height, 0, 0,
-                         GetModuleHandle(0), NULL);
+                         GetModuleHandle(0), this);
 
   std::lock_guard<std::mutex> lock(mutex_);
   initialized_ = true;
@@ -163,21 +209,45 @@ void Window::Start(const char* title) {
 
 void Window::Shutdown() { DestroyWindow(hwnd_); }
 
+size_t Window::DispatchPending() {
+  // Messages sent from other threads are delivered from within PeekMessage()
+  // itself, and only posted ones are returned.
+  size_t count = 0;
+  MSG msg;
+  while (PeekMessage(&msg, hwnd_, 0, 0, PM_REMOVE)) {
+    DispatchMessage(&msg);
+    ++count;
+  }
+  return count;
+}
+
+void Window::DispatchEvent(const PlatformWindowEvent& event) {
+  const int64_t received_ns = platform_window::MonotonicNowNs();
+  dispatcher_->Dispatch(
+      {event,
+       time_mapper_.ToMonotonicNs(static_cast<uint32_t>(GetMessageTime()),
+                                  received_ns),
+       received_ns});
+}
+
 long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
   switch (msg) {
     case WM_CLOSE: {
-      event_callback_(context_, {kPlatformWindowEventTypeQuitRequest, {}});
+      DispatchEvent({kPlatformWindowEventTypeQuitRequest, {}});
       return 0;
     } break;
     case WM_SIZE: {
-      PlatformWindowEventData data;
-      data.resized = PlatformWindowEventDataResized{{LOWORD(lp), HIWORD(lp)}};
-
-      {
-        std::lock_guard<std::mutex> lock(mutex_);
-        size_ = data.resized.size;
+      const PlatformWindowSize size = {LOWORD(lp), HIWORD(lp)};
+      const PlatformWindowSize old_size =
+          size_.load(std::memory_order_relaxed);
+      if (size.width == old_size.width && size.height == old_size.height) {
+        return 0;
       }
-      event_callback_(context_, {kPlatformWindowEventTypeResized, data});
+      size_.store(size, std::memory_order_release);
+      PlatformWindowEventData data;
+      data.resized = {};
+      data.resized.size = size;
+      DispatchEvent({kPlatformWindowEventTypeResized, data});
       return 0;
     } break;
     case WM_LBUTTONDBLCLK:
@@ -217,7 +287,7 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       }();
       data.mouse_button.x = GET_X_LPARAM(lp);
       data.mouse_button.y = GET_Y_LPARAM(lp);
-      event_callback_(context_, {kPlatformWindowEventTypeMouseButton, data});
+      DispatchEvent({kPlatformWindowEventTypeMouseButton, data});
 
       bool were_buttons_previously_pressed = any_buttons_pressed();
       is_pressed_[data.mouse_button.button] = data.mouse_button.pressed;
@@ -236,7 +306,9 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       PlatformWindowEventData data{};
       data.mouse_move.x = GET_X_LPARAM(lp);
       data.mouse_move.y = GET_Y_LPARAM(lp);
-      event_callback_(context_, {kPlatformWindowEventTypeMouseMove, data});
+      data.mouse_move.precise_x = static_cast<float>(data.mouse_move.x);
+      data.mouse_move.precise_y = static_cast<float>(data.mouse_move.y);
+      DispatchEvent({kPlatformWindowEventTypeMouseMove, data});
       return 0;
     } break;
     case WM_MOUSEWHEEL: {
@@ -255,7 +327,7 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       ScreenToClient(hwnd, &position);
       data.mouse_wheel.x = position.x;
       data.mouse_wheel.y = position.y;
-      event_callback_(context_, {kPlatformWindowEventTypeMouseWheel, data});
+      DispatchEvent({kPlatformWindowEventTypeMouseWheel, data});
       return 0;
     } break;
     case WM_CAPTURECHANGED: {
@@ -264,8 +336,7 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
           PlatformWindowEventData data{};
           data.mouse_button = {static_cast<PlatformWindowMouseButton>(i), false,
                                GET_X_LPARAM(lp), GET_Y_LPARAM(lp)};
-          event_callback_(context_,
-                          {kPlatformWindowEventTypeMouseButton, data});
+          DispatchEvent({kPlatformWindowEventTypeMouseButton, data});
           is_pressed_[i] = false;
         }
       }
@@ -279,7 +350,8 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
       PlatformWindowEventData data{};
       data.key.key = static_cast<PlatformWindowKey>(wp);
       data.key.pressed = (msg == WM_KEYDOWN);
-      event_callback_(context_, {kPlatformWindowEventTypeKey, data});
+      data.key.scancode = (lp >> 16) & 0x1ff;
+      DispatchEvent({kPlatformWindowEventTypeKey, data});
       return 0;
     } break;
     default: {
@@ -288,12 +360,12 @@ long Window::OnEvent(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
   }
 }
 
-}  // namespace
-
-PlatformWindow PlatformWindowMakeDefaultWindow(
-    const char* title, PlatformWindowEventCallback event_handler_func,
-    void* context) {
-  auto window = std::make_unique<Window>(title, event_handler_func, context);
+PlatformWindow MakeWindow(
+    const char* title, uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher) {
+  // Win32 already coalesces WM_MOUSEMOVE messages in the message queue, so
+  // kPlatformWindowFlagCoalesceMotion requires no extra work here.
+  auto window = std::make_unique<Window>(title, flags, std::move(dispatcher));
   if (window->error()) {
     return INVALID_PLATFORM_WINDOW;
   } else {
@@ -301,6 +373,40 @@ PlatformWindow PlatformWindowMakeDefaultWindow(
   }
 }
 
+}  // namespace
+
+PlatformWindow PlatformWindowMakeDefaultWindow(
+    const char* title, PlatformWindowEventCallback event_handler_func,
+    void* context) {
+  return PlatformWindowMakeWindow(title, kPlatformWindowFlagsNone,
+                                  event_handler_func, context);
+}
+
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_handler_func, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, event_handler_func, context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_handler_func, void* context) {
+  return MakeWindow(title, flags,
+                    platform_window::MakeEventDispatcher(
+                        flags, batch_event_handler_func, context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_handler_func,
+    void* context) {
+  return MakeWindow(title, flags,
+                    platform_window::MakeEventDispatcher(
+                        flags, timed_batch_event_handler_func, context));
+}
+
 void PlatformWindowDestroyWindow(PlatformWindow platform_window) {
   assert(platform_window != NULL);
   delete static_cast<Window*>(platform_window);
@@ -325,4 +431,95 @@ void PlatformWindowSetTitle(PlatformWindow platform_window, const char* title) {
 
 PlatformWindowSize PlatformWindowGetSize(PlatformWindow platform_window) {
   return static_cast<Window*>(platform_window)->GetSize();
-}
\ No newline at end of file
+}
+
+PlatformWindowVisibility PlatformWindowGetVisibility(
+    PlatformWindow platform_window) {
+  HWND hwnd = static_cast<Window*>(platform_window)->hwnd();
+  if (IsIconic(hwnd)) {
+    return kPlatformWindowVisibilityMinimized;
+  }
+  return IsWindowVisible(hwnd) ? kPlatformWindowVisibilityVisible
+                               : kPlatformWindowVisibilityUnmapped;
+}
+
+bool PlatformWindowSetPointerLock(PlatformWindow platform_window,
+                                  PlatformWindowPointerLock lock) {
+  // Unsupported, as documented in the header.
+  return lock == kPlatformWindowPointerLockNone;
+}
+
+void PlatformWindowAckFrame(PlatformWindow platform_window) {
+  // Windows does not wait for the application to draw while resizing.
+}
+
+bool PlatformWindowWaitForNextFrame(PlatformWindow platform_window) {
+  // Unsupported, as documented in frame_timing.h.
+  return false;
+}
+
+bool PlatformWindowGetFrameTiming(PlatformWindow platform_window,
+                                  PlatformWindowFrameTiming* timing) {
+  return false;
+}
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow platform_window) {
+  return {0, 0};
+}
+
+void PlatformWindowGetStats(PlatformWindow platform_window,
+                            PlatformWindowStats* stats) {
+  static_cast<Window*>(platform_window)->dispatcher()->GetStats(0, stats);
+}
+
+size_t PlatformWindowPollEvents(PlatformWindow platform_window,
+                                PlatformWindowEvent* events, size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<Window*>(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+size_t PlatformWindowPollTimedEvents(PlatformWindow platform_window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<Window*>(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+bool PlatformWindowWaitEvents(PlatformWindow platform_window,
+                              int32_t timeout_in_milliseconds) {
+  platform_window::EventQueue* queue =
+      static_cast<Window*>(platform_window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Wait(std::chrono::milliseconds(timeout_in_milliseconds));
+}
+
+bool PlatformWindowStartRecording(PlatformWindow platform_window,
+                                  const char* path) {
+  std::unique_ptr<platform_window::EventRecorder> recorder =
+      platform_window::EventRecorder::Create(path);
+  if (!recorder) {
+    return false;
+  }
+  static_cast<Window*>(platform_window)->dispatcher()->SetRecorder(
+      std::move(recorder));
+  return true;
+}
+
+void PlatformWindowStopRecording(PlatformWindow platform_window) {
+  static_cast<Window*>(platform_window)->dispatcher()->SetRecorder(nullptr);
+}
+
+int PlatformWindowGetEventFd(PlatformWindow platform_window) {
+  // Messages arrive in the creating thread's message queue, which has no file
+  // descriptor.
+  return -1;
+}
+
+size_t PlatformWindowDispatchPending(PlatformWindow platform_window) {
+  return static_cast<Window*>(platform_window)->DispatchPending();
+}
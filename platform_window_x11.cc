@@ -1,27 +1,262 @@
 #include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xpresent.h>
+#include <X11/extensions/sync.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
+#include "event_coalescer.h"
+#include "event_dispatcher.h"
+#include "event_time.h"
+#include "flat_window_map.h"
+#include "platform_window/event_loop.h"
+#include "platform_window/frame_timing.h"
 #include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
+#include "platform_window/x11.h"
+#include "resize_tracker.h"
+#include "x11_key_translation.h"
 
 namespace {
-PlatformWindowKey XKeyEventToPlatformWindowKey(XKeyEvent* event);
+PlatformWindow MakeWindow(
+    const char* title, uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher);
 }  // namespace
 
 namespace {
+// Opens a display connection with Xlib's own locking turned on. Every window
+// reads its events on one thread, but PlatformWindowX11GetXcbConnection()
+// hands the XCB connection underneath to e.g. a Vulkan driver, which uses it
+// from the rendering thread, and Xlib only coordinates with other users of
+// that connection safely once XInitThreads() has been called. That has to
+// happen before any other Xlib call, hence before our first connection.
+Display* OpenDisplay() {
+  static std::once_flag init_threads;
+  std::call_once(init_threads, [] { XInitThreads(); });
+  return XOpenDisplay(NULL);
+}
+
+// The event thread owns the display connection that it reads events from,
+// and holds Xlib's lock on it while it blocks. Requests issued from other
+// threads (showing, hiding, retitling...) go through this single process-wide
+// connection instead, so that we don't pay for a full connection handshake on
+// every call.
+class CommandConnection {
+ public:
+  static CommandConnection* Get() {
+    // Intentionally leaked, it lives for the lifetime of the process.
+    static CommandConnection* connection = new CommandConnection();
+    return connection;
+  }
+
+  // Calls |function| with exclusive access to the command display, and then
+  // flushes the request buffer.
+  template <typename F>
+  void Run(F&& function) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function(display_);
+    XFlush(display_);
+  }
+
+ private:
+  CommandConnection() : display_(OpenDisplay()) { assert(display_); }
+
+  std::mutex mutex_;
+  Display* display_;
+};
+
+class PlatformWindowX11;
+
+// Returns the bounding box of |a| and |b|, either of which may be empty.
+PlatformWindowEventDataExpose UniteRects(
+    const PlatformWindowEventDataExpose& a,
+    const PlatformWindowEventDataExpose& b) {
+  if (a.width <= 0 || a.height <= 0) {
+    return b;
+  }
+  if (b.width <= 0 || b.height <= 0) {
+    return a;
+  }
+  const int32_t left = std::min(a.x, b.x);
+  const int32_t top = std::min(a.y, b.y);
+  const int32_t right = std::max(a.x + a.width, b.x + b.width);
+  const int32_t bottom = std::max(a.y + a.height, b.y + b.height);
+  return {left, top, right - left, bottom - top};
+}
+
+// Implements kPlatformWindowFlagRenderOnDemand: replaces the exposures in
+// |events| by a single one at the end, which covers the whole window if it
+// was resized.
+void MergeExposes(std::vector<PlatformWindowTimedEvent>* events) {
+  PlatformWindowEventDataExpose area = {0, 0, 0, 0};
+  int64_t timestamp_ns = 0;
+  int64_t received_ns = 0;
+  auto kept = events->begin();
+  for (const PlatformWindowTimedEvent& event : *events) {
+    if (event.event.type == kPlatformWindowEventTypeExpose ||
+        event.event.type == kPlatformWindowEventTypeResized) {
+      const PlatformWindowEventData& data = event.event.data;
+      area = UniteRects(
+          area, event.event.type == kPlatformWindowEventTypeExpose
+                    ? data.expose
+                    : PlatformWindowEventDataExpose{0, 0,
+                                                    data.resized.size.width,
+                                                    data.resized.size.height});
+      timestamp_ns = event.timestamp_ns;
+      received_ns = event.received_ns;
+      if (event.event.type == kPlatformWindowEventTypeExpose) {
+        continue;
+      }
+    }
+    *kept++ = event;
+  }
+  events->erase(kept, events->end());
+  if (area.width > 0 && area.height > 0) {
+    PlatformWindowEventData data;
+    data.expose = area;
+    events->push_back(
+        {{kPlatformWindowEventTypeExpose, data}, timestamp_ns, received_ns});
+  }
+}
+
+// Everything that CreateNativeWindow() sets up for a PlatformWindowX11.
+struct X11WindowInfo {
+  Window window;
+  PlatformWindowSize initial_size;
+  Atom delete_atom;
+  Atom shutdown_atom;
+  Atom pointer_lock_atom;
+  Atom sync_request_atom;
+  Atom net_wm_state_atom;
+  Atom net_wm_state_hidden_atom;
+  // The counter that tells the window manager which resize was last drawn
+  // (_NET_WM_SYNC_REQUEST_COUNTER), or None without the Sync extension.
+  XSyncCounter sync_counter;
+  // The XInput extension's major opcode if the window receives its mouse input
+  // through XInput2, or -1.
+  int xi_opcode;
+  // The Present extension's major opcode if the window receives its
+  // completion events, or -1.
+  int present_opcode;
+};
+
+// Serves every window created with kPlatformWindowFlagSharedEventLoop from
+// one display connection and one event thread, instead of one of each per
+// window. Since Xlib is not thread-safe, everything that touches the
+// connection, including creating and destroying windows, runs on the event
+// thread; other threads hand it tasks through RunTask().
+class SharedEventLoop {
+ public:
+  static SharedEventLoop* Get() {
+    // Intentionally leaked, it lives for the lifetime of the process.
+    static SharedEventLoop* loop = new SharedEventLoop();
+    return loop;
+  }
+
+  Display* display() const { return display_; }
+
+  bool OnEventThread() const {
+    return std::this_thread::get_id() == thread_.get_id();
+  }
+
+  // Runs |task| on the event thread and waits for it to finish. Runs it
+  // immediately if called from the event thread, e.g. from an event handler.
+  template <typename F>
+  void RunTask(F&& task) {
+    if (OnEventThread()) {
+      task();
+      return;
+    }
+    std::packaged_task<void()> packaged_task(std::forward<F>(task));
+    std::future<void> done = packaged_task.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(packaged_task));
+    }
+    const char wake_up = 0;
+    while (write(wake_up_write_fd_, &wake_up, 1) < 0 && errno == EINTR) {
+    }
+    done.wait();
+  }
+
+  // Only called from the event thread.
+  void AddWindow(Window window_id, PlatformWindowX11* window) {
+    windows_.Insert(window_id, window);
+  }
+  void RemoveWindow(Window window_id) { windows_.Erase(window_id); }
+  // For destroying |window| from an event handler, which may be one of its
+  // own and so still be running: stops routing events to it right away, and
+  // destroys it once the loop is back out of the handlers.
+  void DestroyLater(PlatformWindowX11* window);
+
+ private:
+  SharedEventLoop();
+
+  void Run();
+  void RunTasks();
+  // Translates and dispatches everything the connection has to offer,
+  // without blocking.
+  void ProcessEvents();
+  // Ends the resizes that have settled, and returns how long poll() may then
+  // block until the next one does, in milliseconds, or -1 if none is in
+  // progress.
+  int SettleResizes();
+  void DestroyWindows();
+
+  Display* display_;
+  // A self-pipe that interrupts the event thread's poll() when a task is
+  // posted.
+  int wake_up_read_fd_;
+  int wake_up_write_fd_;
+
+  std::mutex mutex_;
+  std::vector<std::packaged_task<void()>> tasks_;
+
+  // Only accessed from the event thread.
+  platform_window::FlatWindowMap<PlatformWindowX11> windows_;
+  std::vector<Window> windows_with_events_;
+  std::vector<Window> resizing_windows_;
+  std::vector<PlatformWindowX11*> windows_to_destroy_;
+
+  std::thread thread_;
+};
+
 class PlatformWindowX11 {
  public:
-  PlatformWindowX11(PlatformWindowEventCallback event_callback,
-                    void* callback_context, Display* display, Window window,
-                    Atom delete_atom, Atom shutdown_atom);
+  // Starts an event thread for the window unless |shared_loop| is given or
+  // |flags| has kPlatformWindowFlagNoEventThread.
+  PlatformWindowX11(
+      std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+      uint32_t flags, Display* display, const X11WindowInfo& info,
+      SharedEventLoop* shared_loop);
   ~PlatformWindowX11();
 
+  Display* display() const { return display_; }
   Window window() const { return window_; }
+  SharedEventLoop* shared_loop() const { return shared_loop_; }
+  platform_window::EventDispatcher* dispatcher() const {
+    return dispatcher_.get();
+  }
 
   void Show();
   void Hide();
@@ -29,154 +264,1108 @@ class PlatformWindowX11 {
   void SetTitle(const char* title);
 
   PlatformWindowSize GetSize() const;
+  PlatformWindowVisibility GetVisibility() const;
+
+  bool SetPointerLock(PlatformWindowPointerLock lock);
+
+  void AckFrame();
+
+  PlatformWindowCoalescingStats GetCoalescingStats() const;
+
+  void GetStats(PlatformWindowStats* stats) const;
+
+  bool WaitForNextFrame();
+  bool GetFrameTiming(PlatformWindowFrameTiming* timing) const;
+
+  // Used by the shared event loop and by DispatchPending() to batch up this
+  // window's events. Returns true if |event| is the first pending one.
+  bool AddPendingEvent(const XEvent& event, int64_t received_ns);
+  void DispatchPendingEvents();
+
+  // Whether the window is being resized, in which case SettleResize() must be
+  // called at resize_deadline_ns(), or earlier, from the thread that reads
+  // |display_|.
+  bool resizing() const { return resize_tracker_.resizing(); }
+  int64_t resize_deadline_ns() const { return resize_tracker_.deadline_ns(); }
+  void SettleResize(int64_t now_ns);
+
+  // For kPlatformWindowFlagNoEventThread, where the application pumps the
+  // window's own display connection.
+  int GetEventFd() const { return event_fd_; }
+  size_t DispatchPending();
 
  private:
   void Run();
+  // Hands |events|, if any, to the dispatcher, after merging their exposures
+  // for kPlatformWindowFlagRenderOnDemand.
+  void DispatchBatch(std::vector<PlatformWindowTimedEvent>* events);
+  // Returns once an event can be read from |display_| without blocking, or
+  // false if a resize in progress settles first.
+  bool WaitForEvent();
+
+  // For kPlatformWindowFlagNoEventThread, makes the event fd readable when the
+  // resize in progress, if any, is due to settle.
+  void ArmResizeTimer();
 
-  PlatformWindowEventCallback event_callback_;
-  void* callback_context_;
+  // Translates |event|, received at |received_ns|, and appends the result, if
+  // any, to |events|. Returns false if |event| is the request to shut down the
+  // event thread.
+  bool TranslateEvent(const XEvent& event, int64_t received_ns,
+                      std::vector<PlatformWindowTimedEvent>* events);
+
+  // Translates an XInput2 event, whose data has already been retrieved.
+  void TranslateXInputEvent(const XGenericEventCookie& cookie,
+                            int64_t received_ns,
+                            std::vector<PlatformWindowTimedEvent>* events);
+
+  // Records the outcome of a PresentNotifyMSC request or of a present.
+  void HandlePresentEvent(const XPresentCompleteNotifyEvent& event);
+
+  // Sets the sync counter through the command connection. Must be called with
+  // |sync_mutex_| held, so that requests from the event thread and from
+  // AckFrame() reach the server in order.
+  void SetSyncCounter(uint64_t value);
+
+  // Returns whether the window manager has marked the window as minimized,
+  // with _NET_WM_STATE_HIDDEN. Makes a round trip.
+  bool ReadHiddenState();
+
+  // Appends a visibility event to |events| if the visibility derived from
+  // the window's state has changed.
+  void UpdateVisibility(int64_t received_ns,
+                        std::vector<PlatformWindowTimedEvent>* events);
+
+  // Translates a ConfigureNotify.
+  void TranslateConfigure(const XConfigureEvent& event, int64_t received_ns,
+                          std::vector<PlatformWindowTimedEvent>* events);
+
+  // Returns when |event| was generated, according to its server timestamp.
+  int64_t GetTimestampNs(const XEvent& event, int64_t received_ns);
+
+  // Grabs or releases the pointer through |display_|, since the grabbing
+  // connection is the one that receives pointer events for as long as the
+  // grab lasts. Only called from the thread that reads |display_|.
+  bool ApplyPointerLock(PlatformWindowPointerLock lock);
+  // Applies the lock that SetPointerLock() asked the event thread for, if
+  // any, and hands it the result.
+  void ApplyRequestedPointerLock();
+
+  std::unique_ptr<platform_window::EventDispatcher> dispatcher_;
+  const uint32_t flags_;
 
   Display* display_;
   Window window_;
   Atom delete_atom_;
   Atom shutdown_atom_;
+  // Wakes the event thread up to apply a SetPointerLock() request. The
+  // message carries nothing, so one sent by any other client is harmless.
+  Atom pointer_lock_atom_;
+  Atom sync_request_atom_;
+  Atom net_wm_state_atom_;
+  Atom net_wm_state_hidden_atom_;
+  XSyncCounter sync_counter_;
+  int xi_opcode_;
+  int present_opcode_;
+  // Created the first time the pointer is locked.
+  Cursor blank_cursor_ = None;
+
+  // Written by the event thread whenever ConfigureNotify reports a new size,
+  // so that GetSize() can be answered without a server round trip.
+  std::atomic<PlatformWindowSize> size_;
+  static_assert(std::atomic<PlatformWindowSize>::is_always_lock_free);
+
+  // Only accessed from the event thread.
+  platform_window::EventTimeMapper time_mapper_;
+  platform_window::ResizeTracker resize_tracker_;
+  // Where the window was last reported to be, and whether its parent is the
+  // root window, i.e. whether it has not been reparented into a frame by the
+  // window manager.
+  PlatformWindowEventDataMoved position_ = {0, 0};
+  bool parent_is_root_ = true;
+  // The counter value asked for by the last _NET_WM_SYNC_REQUEST, until the
+  // ConfigureNotify that it precedes.
+  uint64_t pending_sync_serial_ = 0;
+  // The area exposed so far by the current chain of Expose events.
+  PlatformWindowEventDataExpose exposed_ = {0, 0, 0, 0};
+  // What the window's visibility is derived from: map state, minimization,
+  // and the state of the last VisibilityNotify.
+  bool mapped_ = false;
+  bool minimized_ = false;
+  int obscurity_ = VisibilityUnobscured;
+  bool focused_ = false;
+
+  // Written by the event thread whenever the visibility changes, so that
+  // GetVisibility() can be answered without a server round trip.
+  std::atomic<PlatformWindowVisibility> visibility_ =
+      kPlatformWindowVisibilityUnmapped;
+
+  std::mutex sync_mutex_;
+  // The counter value to set on the next AckFrame(), or 0.
+  uint64_t unacked_sync_serial_ = 0;
+
+  // The SetPointerLock() request being handed to the event thread, one at a
+  // time.
+  enum class PointerLockRequestState { kNone, kRequested, kApplied };
+  std::mutex pointer_lock_mutex_;
+  // Signaled when a request is applied, when the slot is free again, and
+  // when the event thread exits.
+  std::condition_variable pointer_lock_changed_;
+  PointerLockRequestState pointer_lock_state_ = PointerLockRequestState::kNone;
+  PlatformWindowPointerLock requested_pointer_lock_ =
+      kPlatformWindowPointerLockNone;
+  bool pointer_lock_result_ = false;
+  bool event_thread_exited_ = false;
+
+  // How long WaitForNextFrame() waits for a vblank: several refresh
+  // intervals even at low refresh rates, and much less than the fake vblanks
+  // of unmapped windows.
+  static constexpr int kFrameWaitTimeoutMs = 100;
+
+  // Frame pacing state, written by the thread that reads |display_| and
+  // waited on by WaitForNextFrame().
+  mutable std::mutex frame_mutex_;
+  // Signaled when a wait completes, is superseded by a newer one, or must
+  // end because the window is being destroyed, and when the last waiter
+  // leaves.
+  std::condition_variable frame_completed_;
+  uint32_t frame_requested_serial_ = 0;
+  uint32_t frame_completed_serial_ = 0;
+  // Threads blocked in WaitForNextFrame(), which the destructor waits out.
+  int frame_waiters_ = 0;
+  bool frame_shutdown_ = false;
+  uint64_t frame_target_msc_ = 0;
+  bool has_frame_timing_ = false;
+  PlatformWindowFrameTiming frame_timing_ = {};
+
+  // Only appended to from the event thread.
+  platform_window::EventCoalescer coalescer_;
+
+  // Null if the window has its own event thread.
+  SharedEventLoop* shared_loop_;
+  // Events translated by the shared loop, waiting for DispatchPendingEvents().
+  std::vector<PlatformWindowTimedEvent> pending_events_;
+  size_t pending_native_events_ = 0;
+
+  // For kPlatformWindowFlagNoEventThread, an epoll set of |display_|'s
+  // connection and of |resize_timer_fd_|, which expires when a resize
+  // settles. Otherwise the connection itself.
+  int event_fd_;
+  int resize_timer_fd_ = -1;
 
   std::thread thread_;
 };
 
-PlatformWindowX11::PlatformWindowX11(PlatformWindowEventCallback event_callback,
-                                     void* callback_context, Display* display,
-                                     Window window, Atom delete_atom,
-                                     Atom shutdown_atom)
-    : event_callback_(event_callback),
-      callback_context_(callback_context),
+SharedEventLoop::SharedEventLoop() : display_(OpenDisplay()) {
+  assert(display_);
+  int fds[2];
+  int result = pipe(fds);
+  assert(result == 0);
+  (void)result;
+  wake_up_read_fd_ = fds[0];
+  wake_up_write_fd_ = fds[1];
+  fcntl(wake_up_read_fd_, F_SETFL, O_NONBLOCK);
+
+  thread_ = std::thread([this] { Run(); });
+}
+
+void SharedEventLoop::Run() {
+  pollfd fds[2] = {
+      {ConnectionNumber(display_), POLLIN, 0},
+      {wake_up_read_fd_, POLLIN, 0},
+  };
+  while (true) {
+    // Tasks may make requests that read events into Xlib's queue, so they run
+    // first and the queue is then emptied before blocking.
+    RunTasks();
+    ProcessEvents();
+    const int timeout_ms = SettleResizes();
+    DestroyWindows();
+
+    if (poll(fds, 2, timeout_ms) < 0 && errno != EINTR) {
+      return;
+    }
+    if (fds[1].revents & POLLIN) {
+      char buffer[64];
+      while (read(wake_up_read_fd_, buffer, sizeof(buffer)) > 0) {
+      }
+    }
+  }
+}
+
+void SharedEventLoop::RunTasks() {
+  std::vector<std::packaged_task<void()>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks.swap(tasks_);
+  }
+  for (std::packaged_task<void()>& task : tasks) {
+    task();
+  }
+}
+
+void SharedEventLoop::ProcessEvents() {
+  XEvent event;
+  // XPending() flushes, and reads whatever the socket has without blocking.
+  while (int count = XPending(display_)) {
+    // Route everything that has been read, so that each window gets it in a
+    // single batch.
+    windows_with_events_.clear();
+    for (int i = 0; i < count; ++i) {
+      XNextEvent(display_, &event);
+      if (event.type == MappingNotify) {
+        XMappingEvent mapping_event = event.xmapping;
+        platform_window::OnKeyboardMappingChanged(display_, &mapping_event);
+        continue;
+      }
+      PlatformWindowX11* window = windows_.Find(event.xany.window);
+      if (window &&
+          window->AddPendingEvent(event, platform_window::MonotonicNowNs())) {
+        windows_with_events_.push_back(event.xany.window);
+      }
+    }
+
+    for (size_t i = 0; i < windows_with_events_.size(); ++i) {
+      // Look the window up again, as an earlier handler may have destroyed
+      // it.
+      const Window window_id = windows_with_events_[i];
+      if (PlatformWindowX11* window = windows_.Find(window_id)) {
+        window->DispatchPendingEvents();
+        if (window->resizing() &&
+            std::find(resizing_windows_.begin(), resizing_windows_.end(),
+                      window_id) == resizing_windows_.end()) {
+          resizing_windows_.push_back(window_id);
+        }
+      }
+    }
+  }
+}
+
+int SharedEventLoop::SettleResizes() {
+  const int64_t now_ns = platform_window::MonotonicNowNs();
+  int64_t next_deadline_ns = -1;
+  for (size_t i = 0; i < resizing_windows_.size();) {
+    // Windows may be destroyed by the handlers of others.
+    PlatformWindowX11* window = windows_.Find(resizing_windows_[i]);
+    if (window) {
+      window->SettleResize(now_ns);
+    }
+    if (!window || !window->resizing()) {
+      resizing_windows_[i] = resizing_windows_.back();
+      resizing_windows_.pop_back();
+      continue;
+    }
+    if (next_deadline_ns == -1 ||
+        window->resize_deadline_ns() < next_deadline_ns) {
+      next_deadline_ns = window->resize_deadline_ns();
+    }
+    ++i;
+  }
+  if (next_deadline_ns == -1) {
+    return -1;
+  }
+  // Rounded up, so as not to wake up just before the deadline.
+  return static_cast<int>((next_deadline_ns - now_ns + 999999) / 1000000);
+}
+
+void SharedEventLoop::DestroyLater(PlatformWindowX11* window) {
+  windows_.Erase(window->window());
+  windows_to_destroy_.push_back(window);
+}
+
+void SharedEventLoop::DestroyWindows() {
+  std::vector<PlatformWindowX11*> windows;
+  windows.swap(windows_to_destroy_);
+  for (PlatformWindowX11* window : windows) {
+    delete window;
+  }
+}
+
+PlatformWindowX11::PlatformWindowX11(
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+    uint32_t flags, Display* display, const X11WindowInfo& info,
+    SharedEventLoop* shared_loop)
+    : dispatcher_(std::move(dispatcher)),
+      flags_(flags),
       display_(display),
-      window_(window),
-      delete_atom_(delete_atom),
-      shutdown_atom_(shutdown_atom),
-      thread_([this] { Run(); }) {}
+      window_(info.window),
+      delete_atom_(info.delete_atom),
+      shutdown_atom_(info.shutdown_atom),
+      pointer_lock_atom_(info.pointer_lock_atom),
+      sync_request_atom_(info.sync_request_atom),
+      net_wm_state_atom_(info.net_wm_state_atom),
+      net_wm_state_hidden_atom_(info.net_wm_state_hidden_atom),
+      sync_counter_(info.sync_counter),
+      xi_opcode_(info.xi_opcode),
+      present_opcode_(info.present_opcode),
+      size_(info.initial_size),
+      resize_tracker_(info.initial_size,
+                      flags & kPlatformWindowFlagThrottleResize),
+      coalescer_(flags & kPlatformWindowFlagCoalesceMotion),
+      shared_loop_(shared_loop),
+      event_fd_(ConnectionNumber(display)) {
+  if (shared_loop_) {
+    return;
+  }
+  if (!(flags & kPlatformWindowFlagNoEventThread)) {
+    thread_ = std::thread([this] { Run(); });
+    return;
+  }
+
+  // The application only polls one descriptor, which must also wake it up
+  // when a resize settles. timerfd uses CLOCK_MONOTONIC, like MonotonicNowNs().
+  event_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  resize_timer_fd_ =
+      timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  assert(event_fd_ != -1 && resize_timer_fd_ != -1);
+  epoll_event connection_event = {};
+  connection_event.events = EPOLLIN;
+  connection_event.data.fd = ConnectionNumber(display_);
+  epoll_ctl(event_fd_, EPOLL_CTL_ADD, connection_event.data.fd,
+            &connection_event);
+  epoll_event timer_event = {};
+  timer_event.events = EPOLLIN;
+  timer_event.data.fd = resize_timer_fd_;
+  epoll_ctl(event_fd_, EPOLL_CTL_ADD, resize_timer_fd_, &timer_event);
+}
 
 PlatformWindowX11::~PlatformWindowX11() {
-  // XLib is not thread-safe. Since we're on another thread, we have to open
-  // another connection to the display to inject the wake-up event.
-  Display* display = XOpenDisplay(NULL);
-  XClientMessageEvent event = {0};
-  event.type = ClientMessage;
-  event.message_type = shutdown_atom_;
-  event.window = window_;
-  event.format = 32;
-  XSendEvent(display, event.window, 0, 0, reinterpret_cast<XEvent*>(&event));
-  XFlush(display);
-  XCloseDisplay(display);
+  {
+    // Release any thread still in WaitForNextFrame(), and let it return
+    // before the state it waits on goes away.
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    frame_shutdown_ = true;
+    frame_completed_.notify_all();
+    frame_completed_.wait(lock, [this] { return frame_waiters_ == 0; });
+  }
+
+  if (shared_loop_) {
+    shared_loop_->RunTask([this] {
+      shared_loop_->RemoveWindow(window_);
+      if (blank_cursor_ != None) {
+        XFreeCursor(display_, blank_cursor_);
+      }
+      // Unlike the window's own connection, the shared one lives on, and so
+      // would the counter.
+      if (sync_counter_ != None) {
+        XSyncDestroyCounter(display_, sync_counter_);
+      }
+      XDestroyWindow(display_, window_);
+      XFlush(display_);
+    });
+    return;
+  }
+
+  if (thread_.joinable()) {
+    // XLib is not thread-safe. Since we're on another thread, we inject the
+    // wake-up event through the command connection.
+    CommandConnection::Get()->Run([this](Display* display) {
+      XClientMessageEvent event = {0};
+      event.type = ClientMessage;
+      event.message_type = shutdown_atom_;
+      event.window = window_;
+      event.format = 32;
+      XSendEvent(display, event.window, 0, 0,
+                 reinterpret_cast<XEvent*>(&event));
+    });
 
-  thread_.join();
+    thread_.join();
+  }
+  if (resize_timer_fd_ != -1) {
+    close(resize_timer_fd_);
+    close(event_fd_);
+  }
+  // The event thread is gone, so the display is ours again.
+  XDestroyWindow(display_, window_);
+  XCloseDisplay(display_);
 }
 
 void PlatformWindowX11::Show() {
-  Display* display = XOpenDisplay(NULL);
-  XMapWindow(display, window_);
-  XFlush(display);
-  XCloseDisplay(display);
+  CommandConnection::Get()->Run(
+      [this](Display* display) { XMapWindow(display, window_); });
 }
 void PlatformWindowX11::Hide() {
-  Display* display = XOpenDisplay(NULL);
-  XUnmapWindow(display, window_);
-  XFlush(display);
-  XCloseDisplay(display);
+  CommandConnection::Get()->Run(
+      [this](Display* display) { XUnmapWindow(display, window_); });
 }
 
 void PlatformWindowX11::SetTitle(const char* title) {
-  Display* display = XOpenDisplay(NULL);
-  XStoreName(display, window_, title);
-  XFlush(display);
-  XCloseDisplay(display);
+  CommandConnection::Get()->Run(
+      [this, title](Display* display) { XStoreName(display, window_, title); });
+}
+
+bool PlatformWindowX11::SetPointerLock(PlatformWindowPointerLock lock) {
+  if (shared_loop_) {
+    bool result;
+    shared_loop_->RunTask([&] { result = ApplyPointerLock(lock); });
+    return result;
+  }
+  if (!thread_.joinable() || std::this_thread::get_id() == thread_.get_id()) {
+    // Without an event thread, the caller is the one pumping |display_|.
+    return ApplyPointerLock(lock);
+  }
+
+  // Leave the request for the event thread, wake it up like the shutdown
+  // request does, and wait for it to report back.
+  std::unique_lock<std::mutex> guard(pointer_lock_mutex_);
+  pointer_lock_changed_.wait(guard, [this] {
+    return pointer_lock_state_ == PointerLockRequestState::kNone ||
+           event_thread_exited_;
+  });
+  if (event_thread_exited_) {
+    return false;
+  }
+  pointer_lock_state_ = PointerLockRequestState::kRequested;
+  requested_pointer_lock_ = lock;
+  guard.unlock();
+
+  CommandConnection::Get()->Run([this](Display* display) {
+    XClientMessageEvent event = {0};
+    event.type = ClientMessage;
+    event.message_type = pointer_lock_atom_;
+    event.window = window_;
+    event.format = 32;
+    XSendEvent(display, event.window, 0, 0, reinterpret_cast<XEvent*>(&event));
+  });
+
+  guard.lock();
+  pointer_lock_changed_.wait(guard, [this] {
+    return pointer_lock_state_ == PointerLockRequestState::kApplied ||
+           event_thread_exited_;
+  });
+  const bool result =
+      pointer_lock_state_ == PointerLockRequestState::kApplied &&
+      pointer_lock_result_;
+  pointer_lock_state_ = PointerLockRequestState::kNone;
+  pointer_lock_changed_.notify_all();
+  return result;
+}
+
+void PlatformWindowX11::ApplyRequestedPointerLock() {
+  PlatformWindowPointerLock lock;
+  {
+    std::lock_guard<std::mutex> guard(pointer_lock_mutex_);
+    if (pointer_lock_state_ != PointerLockRequestState::kRequested) {
+      return;
+    }
+    lock = requested_pointer_lock_;
+  }
+  const bool result = ApplyPointerLock(lock);
+  {
+    std::lock_guard<std::mutex> guard(pointer_lock_mutex_);
+    pointer_lock_result_ = result;
+    pointer_lock_state_ = PointerLockRequestState::kApplied;
+  }
+  pointer_lock_changed_.notify_all();
+}
+
+void PlatformWindowX11::AckFrame() {
+  std::lock_guard<std::mutex> lock(sync_mutex_);
+  if (unacked_sync_serial_ != 0) {
+    SetSyncCounter(unacked_sync_serial_);
+    unacked_sync_serial_ = 0;
+  }
+}
+
+void PlatformWindowX11::SetSyncCounter(uint64_t value) {
+  CommandConnection::Get()->Run([this, value](Display* display) {
+    XSyncValue sync_value;
+    XSyncIntsToValue(&sync_value, static_cast<unsigned int>(value),
+                     static_cast<int>(value >> 32));
+    XSyncSetCounter(display, sync_counter_, sync_value);
+  });
+}
+
+bool PlatformWindowX11::ApplyPointerLock(PlatformWindowPointerLock lock) {
+  if (lock == kPlatformWindowPointerLockNone) {
+    XUngrabPointer(display_, CurrentTime);
+    XFlush(display_);
+    return true;
+  }
+
+  Cursor cursor = None;
+  if (lock == kPlatformWindowPointerLockLocked) {
+    if (blank_cursor_ == None) {
+      const char empty_bitmap[1] = {0};
+      Pixmap pixmap =
+          XCreateBitmapFromData(display_, window_, empty_bitmap, 1, 1);
+      XColor black = {};
+      blank_cursor_ =
+          XCreatePixmapCursor(display_, pixmap, pixmap, &black, &black, 0, 0);
+      XFreePixmap(display_, pixmap);
+    }
+    cursor = blank_cursor_;
+  }
+  // Regrabbing while already grabbed just updates the confinement and cursor.
+  return XGrabPointer(display_, window_, True,
+                      ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
+                      GrabModeAsync, GrabModeAsync, window_, cursor,
+                      CurrentTime) == GrabSuccess;
 }
 
 void PlatformWindowX11::Run() {
+  std::vector<PlatformWindowTimedEvent> events;
   XEvent event;
-  while (true) {
+  bool running = true;
+  while (running) {
+    // Block until there is at least one event, and then translate everything
+    // else that Xlib has already queued so that it can all be delivered in a
+    // single batch.
+    events.clear();
+    if (!WaitForEvent()) {
+      resize_tracker_.Settle(platform_window::MonotonicNowNs(), &events);
+      DispatchBatch(&events);
+      continue;
+    }
+    dispatcher_->stats()->RecordQueueDepth(XQLength(display_) + 1);
     XNextEvent(display_, &event);
-    switch (event.type) {
-      case KeyPress:
-      case KeyRelease: {
-        XKeyEvent* x_key_event = reinterpret_cast<XKeyEvent*>(&event);
-        PlatformWindowEventData data;
-        data.key.pressed = (event.type == KeyPress);
-        data.key.key = XKeyEventToPlatformWindowKey(x_key_event);
-        event_callback_(callback_context_, {kPlatformWindowEventTypeKey, data});
-      } break;
-      case ButtonPress:
-      case ButtonRelease: {
-        XButtonEvent* x_button_event = reinterpret_cast<XButtonEvent*>(&event);
-
-        // Handle mouse wheel events.
-        if (x_button_event->button == 4 || x_button_event->button == 5) {
-          PlatformWindowEventData data;
-          data.mouse_wheel.angle_in_degrees =
-              15 * (x_button_event->button == 4 ? 1 : -1);
-          data.mouse_wheel.x = x_button_event->x;
-          data.mouse_wheel.y = x_button_event->y;
-          event_callback_(callback_context_,
-                          {kPlatformWindowEventTypeMouseWheel, data});
-          continue;
-        }
+    running = TranslateEvent(event, platform_window::MonotonicNowNs(), &events);
+    while (running && XEventsQueued(display_, QueuedAlready) > 0) {
+      XNextEvent(display_, &event);
+      running =
+          TranslateEvent(event, platform_window::MonotonicNowNs(), &events);
+    }
+
+    DispatchBatch(&events);
+  }
 
-        // Okay, normal button click then.
+  // Fail any SetPointerLock() that is, or would be, waiting on us.
+  {
+    std::lock_guard<std::mutex> guard(pointer_lock_mutex_);
+    event_thread_exited_ = true;
+  }
+  pointer_lock_changed_.notify_all();
+}
+
+void PlatformWindowX11::DispatchBatch(
+    std::vector<PlatformWindowTimedEvent>* events) {
+  if (flags_ & kPlatformWindowFlagRenderOnDemand) {
+    MergeExposes(events);
+  }
+  if (!events->empty()) {
+    dispatcher_->Dispatch(events->data(), events->size());
+  }
+}
+
+bool PlatformWindowX11::WaitForEvent() {
+  while (resize_tracker_.resizing()) {
+    if (XEventsQueued(display_, QueuedAfterFlush) > 0) {
+      return true;
+    }
+    const int64_t timeout_ns =
+        resize_tracker_.deadline_ns() - platform_window::MonotonicNowNs();
+    if (timeout_ns <= 0) {
+      return false;
+    }
+    pollfd fd = {ConnectionNumber(display_), POLLIN, 0};
+    // Rounded up, so as not to wake up just before the deadline.
+    poll(&fd, 1, static_cast<int>((timeout_ns + 999999) / 1000000));
+  }
+  // Nothing to wait for but events, which XNextEvent() blocks on.
+  return true;
+}
+
+bool PlatformWindowX11::TranslateEvent(
+    const XEvent& event, int64_t received_ns,
+    std::vector<PlatformWindowTimedEvent>* events) {
+  dispatcher_->stats()->RecordNativeEvent(event.type);
+  // A resize that has settled ends before whatever comes after it.
+  resize_tracker_.Settle(received_ns, events);
+  const int64_t timestamp_ns = GetTimestampNs(event, received_ns);
+  auto append = [&](PlatformWindowEventType type,
+                    const PlatformWindowEventData& data) {
+    coalescer_.Append({{type, data}, timestamp_ns, received_ns}, events);
+  };
+  switch (event.type) {
+    case KeyPress:
+    case KeyRelease: {
+      XKeyEvent x_key_event = event.xkey;
+      PlatformWindowEventData data;
+      data.key.pressed = (event.type == KeyPress);
+      data.key.key = platform_window::TranslateKeyEvent(
+          *platform_window::GetSharedKeycodeTable(display_), &x_key_event);
+      data.key.scancode = x_key_event.keycode;
+      append(kPlatformWindowEventTypeKey, data);
+    } break;
+    case ButtonPress:
+    case ButtonRelease: {
+      const XButtonEvent* x_button_event = &event.xbutton;
+
+      // Handle mouse wheel events.
+      if (x_button_event->button == 4 || x_button_event->button == 5) {
         PlatformWindowEventData data;
-        data.mouse_button.pressed = (ButtonPress == event.type);
-        data.mouse_button.button = [x_button_event] {
-          switch (x_button_event->button) {
-            case Button1:
-              return kPlatformWindowMouseLeft;
-            case Button3:
-              return kPlatformWindowMouseRight;
-            default:
-              return kPlatformWindowMouseUnknown;
-          }
-        }();
-        data.mouse_button.x = x_button_event->x;
-        data.mouse_button.y = x_button_event->y;
-        event_callback_(callback_context_,
-                        {kPlatformWindowEventTypeMouseButton, data});
-
-      } break;
-      case MotionNotify: {
-        XMotionEvent* x_motion_event = reinterpret_cast<XMotionEvent*>(&event);
+        data.mouse_wheel.angle_in_degrees =
+            15 * (x_button_event->button == 4 ? 1 : -1);
+        data.mouse_wheel.x = x_button_event->x;
+        data.mouse_wheel.y = x_button_event->y;
+        append(kPlatformWindowEventTypeMouseWheel, data);
+        break;
+      }
+
+      // Okay, normal button click then.
+      PlatformWindowEventData data;
+      data.mouse_button.pressed = (ButtonPress == event.type);
+      data.mouse_button.button = [x_button_event] {
+        switch (x_button_event->button) {
+          case Button1:
+            return kPlatformWindowMouseLeft;
+          case Button3:
+            return kPlatformWindowMouseRight;
+          default:
+            return kPlatformWindowMouseUnknown;
+        }
+      }();
+      data.mouse_button.x = x_button_event->x;
+      data.mouse_button.y = x_button_event->y;
+      append(kPlatformWindowEventTypeMouseButton, data);
+    } break;
+    case MotionNotify: {
+      const XMotionEvent* x_motion_event = &event.xmotion;
+      PlatformWindowEventData data;
+      data.mouse_move.x = x_motion_event->x;
+      data.mouse_move.y = x_motion_event->y;
+      data.mouse_move.precise_x = x_motion_event->x;
+      data.mouse_move.precise_y = x_motion_event->y;
+      append(kPlatformWindowEventTypeMouseMove, data);
+    } break;
+    case ConfigureNotify: {
+      TranslateConfigure(event.xconfigure, received_ns, events);
+    } break;
+    case Expose: {
+      const XExposeEvent& expose = event.xexpose;
+      exposed_ = UniteRects(
+          exposed_, {expose.x, expose.y, expose.width, expose.height});
+      // |count| is the number of Expose events that follow for the same
+      // exposure.
+      if (expose.count == 0) {
         PlatformWindowEventData data;
-        data.mouse_move.x = x_motion_event->x;
-        data.mouse_move.y = x_motion_event->y;
-        event_callback_(callback_context_,
-                        {kPlatformWindowEventTypeMouseMove, data});
-      } break;
-      case ConfigureNotify: {
-        // Handle window resize
-        XConfigureEvent xce = event.xconfigure;
+        data.expose = exposed_;
+        append(kPlatformWindowEventTypeExpose, data);
+        exposed_ = {0, 0, 0, 0};
+      }
+    } break;
+    case FocusIn:
+    case FocusOut: {
+      const XFocusChangeEvent& focus = event.xfocus;
+      // Focus moving to or from a child of the window, and the temporary
+      // changes of keyboard grabs (e.g. by the window manager's shortcuts),
+      // do not change whether the window has the focus.
+      if (focus.detail == NotifyInferior || focus.mode == NotifyGrab ||
+          focus.mode == NotifyUngrab) {
+        break;
+      }
+      const bool focused = event.type == FocusIn;
+      if (focused != focused_) {
+        focused_ = focused;
         PlatformWindowEventData data;
-        data.resized = PlatformWindowEventDataResized{{xce.width, xce.height}};
-        event_callback_(callback_context_,
-                        {kPlatformWindowEventTypeResized, data});
-      } break;
-      case ClientMessage: {
-        const XClientMessageEvent* client_message =
-            reinterpret_cast<const XClientMessageEvent*>(&event);
-        if (client_message->message_type == shutdown_atom_) {
-          return;
-        } else if (event.xclient.data.l[0] == delete_atom_) {
-          event_callback_(callback_context_,
-                          {kPlatformWindowEventTypeQuitRequest, {}});
+        data.focus_changed.focused = focused;
+        append(kPlatformWindowEventTypeFocusChanged, data);
+      }
+    } break;
+    case VisibilityNotify: {
+      obscurity_ = event.xvisibility.state;
+      UpdateVisibility(received_ns, events);
+    } break;
+    case MapNotify:
+    case UnmapNotify: {
+      mapped_ = event.type == MapNotify;
+      UpdateVisibility(received_ns, events);
+    } break;
+    case PropertyNotify: {
+      if (event.xproperty.atom == net_wm_state_atom_) {
+        minimized_ =
+            event.xproperty.state == PropertyNewValue && ReadHiddenState();
+        UpdateVisibility(received_ns, events);
+      }
+    } break;
+    case ReparentNotify: {
+      parent_is_root_ = event.xreparent.parent == DefaultRootWindow(display_);
+    } break;
+    case MappingNotify: {
+      XMappingEvent mapping_event = event.xmapping;
+      platform_window::OnKeyboardMappingChanged(display_, &mapping_event);
+    } break;
+    case GenericEvent: {
+      XGenericEventCookie cookie = event.xcookie;
+      if (cookie.extension == xi_opcode_ && XGetEventData(display_, &cookie)) {
+        TranslateXInputEvent(cookie, received_ns, events);
+        XFreeEventData(display_, &cookie);
+      } else if (cookie.extension == present_opcode_ &&
+                 XGetEventData(display_, &cookie)) {
+        if (cookie.evtype == PresentCompleteNotify) {
+          HandlePresentEvent(
+              *static_cast<const XPresentCompleteNotifyEvent*>(cookie.data));
         }
-      } break;
+        XFreeEventData(display_, &cookie);
+      }
+    } break;
+    case ClientMessage: {
+      const XClientMessageEvent* client_message = &event.xclient;
+      if (client_message->message_type == shutdown_atom_) {
+        return false;
+      } else if (client_message->message_type == pointer_lock_atom_) {
+        ApplyRequestedPointerLock();
+      } else if (static_cast<Atom>(client_message->data.l[0]) ==
+                 delete_atom_) {
+        append(kPlatformWindowEventTypeQuitRequest, {});
+      } else if (static_cast<Atom>(client_message->data.l[0]) ==
+                 sync_request_atom_) {
+        // The counter value is split into its low and high 32 bits.
+        pending_sync_serial_ =
+            static_cast<uint32_t>(client_message->data.l[2]) |
+            static_cast<uint64_t>(client_message->data.l[3]) << 32;
+      }
+    } break;
+  }
+  return true;
+}
+
+bool PlatformWindowX11::ReadHiddenState() {
+  Atom type;
+  int format;
+  unsigned long count;
+  unsigned long bytes_after;
+  unsigned char* data = nullptr;
+  if (XGetWindowProperty(display_, window_, net_wm_state_atom_, 0, 64, False,
+                         XA_ATOM, &type, &format, &count, &bytes_after,
+                         &data) != Success ||
+      !data) {
+    return false;
+  }
+  bool hidden = false;
+  if (format == 32) {
+    // Xlib returns 32-bit items as longs.
+    const Atom* states = reinterpret_cast<const Atom*>(data);
+    hidden = std::find(states, states + count, net_wm_state_hidden_atom_) !=
+             states + count;
+  }
+  XFree(data);
+  return hidden;
+}
+
+void PlatformWindowX11::UpdateVisibility(
+    int64_t received_ns, std::vector<PlatformWindowTimedEvent>* events) {
+  PlatformWindowVisibility visibility;
+  if (minimized_) {
+    visibility = kPlatformWindowVisibilityMinimized;
+  } else if (!mapped_) {
+    visibility = kPlatformWindowVisibilityUnmapped;
+  } else if (obscurity_ == VisibilityFullyObscured) {
+    visibility = kPlatformWindowVisibilityFullyObscured;
+  } else if (obscurity_ == VisibilityPartiallyObscured) {
+    visibility = kPlatformWindowVisibilityPartiallyVisible;
+  } else {
+    visibility = kPlatformWindowVisibilityVisible;
+  }
+  if (visibility == visibility_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  visibility_.store(visibility, std::memory_order_release);
+  PlatformWindowEventData data;
+  data.visibility_changed.visibility = visibility;
+  coalescer_.Append({{kPlatformWindowEventTypeVisibilityChanged, data},
+                     received_ns, received_ns},
+                    events);
+}
+
+void PlatformWindowX11::TranslateConfigure(
+    const XConfigureEvent& event, int64_t received_ns,
+    std::vector<PlatformWindowTimedEvent>* events) {
+  // The position is in root coordinates without a reparenting window manager,
+  // and in the synthetic events that one sends when it moves the frame (ICCCM
+  // 4.1.5). Otherwise it is relative to the frame.
+  if ((event.send_event || parent_is_root_) &&
+      (event.x != position_.x || event.y != position_.y)) {
+    position_ = {event.x, event.y};
+    PlatformWindowEventData data;
+    data.moved = position_;
+    coalescer_.Append({{kPlatformWindowEventTypeMoved, data}, received_ns,
+                       received_ns},
+                      events);
+  }
+
+  // Sent for moves and restacks too, so only some carry a new size. A
+  // preceding sync request is answered by the application once it has drawn
+  // the new size, except that the steps of a throttled resize are never
+  // drawn, and that neither is a configuration that leaves the size as it
+  // was. Synthetic events come from the window manager itself, and only ever
+  // move the window.
+  const uint64_t sync_serial = pending_sync_serial_;
+  const bool throttle = flags_ & kPlatformWindowFlagThrottleResize;
+  const bool resized = resize_tracker_.OnConfigure(
+      {event.width, event.height}, throttle ? 0 : sync_serial, received_ns,
+      events);
+  if (resized) {
+    size_.store({event.width, event.height}, std::memory_order_release);
+  }
+  if (sync_serial == 0 || (!resized && event.send_event)) {
+    return;
+  }
+  pending_sync_serial_ = 0;
+  std::lock_guard<std::mutex> lock(sync_mutex_);
+  if (resized && !throttle) {
+    unacked_sync_serial_ = sync_serial;
+  } else {
+    // This also answers any earlier request that is still unanswered.
+    unacked_sync_serial_ = 0;
+    SetSyncCounter(sync_serial);
+  }
+}
+
+void PlatformWindowX11::TranslateXInputEvent(
+    const XGenericEventCookie& cookie, int64_t received_ns,
+    std::vector<PlatformWindowTimedEvent>* events) {
+  switch (cookie.evtype) {
+    case XI_Motion: {
+      const XIDeviceEvent* device_event =
+          static_cast<const XIDeviceEvent*>(cookie.data);
+      PlatformWindowEventData data;
+      data.mouse_move.x = static_cast<int32_t>(device_event->event_x);
+      data.mouse_move.y = static_cast<int32_t>(device_event->event_y);
+      data.mouse_move.precise_x = static_cast<float>(device_event->event_x);
+      data.mouse_move.precise_y = static_cast<float>(device_event->event_y);
+      coalescer_.Append(
+          {{kPlatformWindowEventTypeMouseMove, data},
+           time_mapper_.ToMonotonicNs(device_event->time, received_ns),
+           received_ns},
+          events);
+    } break;
+    case XI_RawMotion: {
+      const XIRawEvent* raw_event = static_cast<const XIRawEvent*>(cookie.data);
+      // |raw_values| only holds the valuators set in the mask. Valuators 0 and
+      // 1 are the X and Y axes.
+      double delta[2] = {0, 0};
+      const double* raw_value = raw_event->raw_values;
+      for (int i = 0; i < 2 && i < raw_event->valuators.mask_len * 8; ++i) {
+        if (XIMaskIsSet(raw_event->valuators.mask, i)) {
+          delta[i] = *raw_value++;
+        }
+      }
+      if (delta[0] == 0 && delta[1] == 0) {
+        break;
+      }
+      PlatformWindowEventData data;
+      data.raw_mouse_motion = {static_cast<float>(delta[0]),
+                               static_cast<float>(delta[1]), 1};
+      coalescer_.Append(
+          {{kPlatformWindowEventTypeRawMouseMotion, data},
+           time_mapper_.ToMonotonicNs(raw_event->time, received_ns),
+           received_ns},
+          events);
+    } break;
+  }
+}
+
+bool PlatformWindowX11::WaitForNextFrame() {
+  if (present_opcode_ == -1) {
+    return false;
+  }
+
+  uint32_t serial;
+  uint64_t target_msc;
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    // Any wait still in progress on another thread is superseded, as only
+    // the latest request's completion is kept.
+    serial = ++frame_requested_serial_;
+    frame_completed_.notify_all();
+    // The vblank after the last one we know of. Before the first wait that is
+    // unknown, and 0 asks for whichever vblank comes next.
+    target_msc =
+        has_frame_timing_ || frame_timing_.last_present_msc != 0
+            ? std::max(frame_timing_.msc, frame_timing_.last_present_msc) + 1
+            : 0;
+    frame_target_msc_ = target_msc;
+  }
+  // With a divisor of 1, a target that has already passed is moved to the
+  // next vblank rather than completing immediately, so that waits always end
+  // on a vblank.
+  auto notify_msc = [this, serial, target_msc](Display* display) {
+    XPresentNotifyMSC(display, window_, serial, target_msc, 1, 0);
+  };
+  auto is_completed = [this, serial] {
+    return frame_completed_serial_ == serial;
+  };
+
+  if (thread_.joinable()) {
+    // Completion events go to every client that selected them on the window,
+    // so the request can be made on any connection, and the event thread
+    // reports back.
+    CommandConnection::Get()->Run(notify_msc);
+    std::unique_lock<std::mutex> lock(frame_mutex_);
+    ++frame_waiters_;
+    frame_completed_.wait_for(
+        lock, std::chrono::milliseconds(kFrameWaitTimeoutMs), [&] {
+          return is_completed() || frame_requested_serial_ != serial ||
+                 frame_shutdown_;
+        });
+    const bool completed = is_completed();
+    if (--frame_waiters_ == 0 && frame_shutdown_) {
+      frame_completed_.notify_all();
+    }
+    return completed;
+  }
+
+  // Without an event thread, the caller is the one pumping |display_|. Events
+  // that arrive in the meantime are batched up, and dispatched along with
+  // whatever is left in Xlib's queue.
+  notify_msc(display_);
+  const int64_t deadline_ns =
+      platform_window::MonotonicNowNs() + kFrameWaitTimeoutMs * 1000000LL;
+  bool completed = false;
+  XEvent event;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex_);
+      if (is_completed()) {
+        completed = true;
+        break;
+      }
+    }
+    if (XPending(display_) == 0) {
+      const int64_t remaining_ns =
+          deadline_ns - platform_window::MonotonicNowNs();
+      if (remaining_ns <= 0) {
+        break;
+      }
+      pollfd fd = {ConnectionNumber(display_), POLLIN, 0};
+      poll(&fd, 1, static_cast<int>((remaining_ns + 999999) / 1000000));
+      continue;
+    }
+    XNextEvent(display_, &event);
+    AddPendingEvent(event, platform_window::MonotonicNowNs());
+  }
+  DispatchPendingEvents();
+  DispatchPending();
+  return completed;
+}
+
+bool PlatformWindowX11::GetFrameTiming(
+    PlatformWindowFrameTiming* timing) const {
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  *timing = frame_timing_;
+  return has_frame_timing_;
+}
+
+void PlatformWindowX11::HandlePresentEvent(
+    const XPresentCompleteNotifyEvent& event) {
+  // UST is in microseconds of CLOCK_MONOTONIC, which is also what
+  // steady_clock, and so MonotonicNowNs(), reads.
+  const int64_t ust_ns = static_cast<int64_t>(event.ust) * 1000;
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  if (event.kind == PresentCompleteKindPixmap) {
+    frame_timing_.last_present_msc = event.msc;
+    frame_timing_.last_present_time_ns = ust_ns;
+    return;
+  }
+  // Ignore requests made by other clients, which are reported to us too.
+  if (event.kind != PresentCompleteKindNotifyMSC ||
+      event.serial_number != frame_requested_serial_) {
+    return;
+  }
+
+  if (has_frame_timing_ && event.msc > frame_timing_.msc) {
+    frame_timing_.refresh_interval_ns =
+        (ust_ns - frame_timing_.vblank_time_ns) /
+        static_cast<int64_t>(event.msc - frame_timing_.msc);
+  }
+  frame_timing_.target_msc =
+      frame_target_msc_ != 0 ? frame_target_msc_ : event.msc;
+  if (event.msc > frame_timing_.target_msc) {
+    frame_timing_.missed_frames += event.msc - frame_timing_.target_msc;
+  }
+  frame_timing_.msc = event.msc;
+  frame_timing_.vblank_time_ns = ust_ns;
+  has_frame_timing_ = true;
+  frame_completed_serial_ = event.serial_number;
+  frame_completed_.notify_all();
+}
+
+bool PlatformWindowX11::AddPendingEvent(const XEvent& event,
+                                        int64_t received_ns) {
+  TranslateEvent(event, received_ns, &pending_events_);
+  return pending_native_events_++ == 0;
+}
+
+void PlatformWindowX11::DispatchPendingEvents() {
+  dispatcher_->stats()->RecordQueueDepth(pending_native_events_);
+  pending_native_events_ = 0;
+  DispatchBatch(&pending_events_);
+  pending_events_.clear();
+}
+
+void PlatformWindowX11::SettleResize(int64_t now_ns) {
+  // Everything else has been dispatched by now.
+  resize_tracker_.Settle(now_ns, &pending_events_);
+  DispatchBatch(&pending_events_);
+  pending_events_.clear();
+}
+
+void PlatformWindowX11::ArmResizeTimer() {
+  itimerspec deadline = {};
+  if (resize_tracker_.resizing()) {
+    const int64_t deadline_ns = resize_tracker_.deadline_ns();
+    deadline.it_value.tv_sec = deadline_ns / 1000000000;
+    deadline.it_value.tv_nsec = deadline_ns % 1000000000;
+  }
+  // A zero deadline disarms the timer.
+  timerfd_settime(resize_timer_fd_, TFD_TIMER_ABSTIME, &deadline, nullptr);
+}
+
+size_t PlatformWindowX11::DispatchPending() {
+  // Consume the timer's expiration, if any, so that the event fd stops
+  // being readable. Whether the resize has settled is checked below anyway.
+  uint64_t expirations;
+  while (read(resize_timer_fd_, &expirations, sizeof(expirations)) > 0) {
+  }
+
+  size_t total = 0;
+  XEvent event;
+  // XPending() flushes, and reads whatever the socket has without blocking.
+  // Keep going until Xlib's queue is empty, since events it has buffered
+  // would not wake up the application's poll() again.
+  while (int count = XPending(display_)) {
+    for (int i = 0; i < count; ++i) {
+      XNextEvent(display_, &event);
+      AddPendingEvent(event, platform_window::MonotonicNowNs());
     }
+    DispatchPendingEvents();
+    total += count;
+  }
+  SettleResize(platform_window::MonotonicNowNs());
+  ArmResizeTimer();
+  return total;
+}
+
+int64_t PlatformWindowX11::GetTimestampNs(const XEvent& event,
+                                          int64_t received_ns) {
+  switch (event.type) {
+    case KeyPress:
+    case KeyRelease:
+      return time_mapper_.ToMonotonicNs(event.xkey.time, received_ns);
+    case ButtonPress:
+    case ButtonRelease:
+      return time_mapper_.ToMonotonicNs(event.xbutton.time, received_ns);
+    case MotionNotify:
+      return time_mapper_.ToMonotonicNs(event.xmotion.time, received_ns);
+    default:
+      return received_ns;
   }
 }
 
 PlatformWindowSize PlatformWindowX11::GetSize() const {
-  Display* display = XOpenDisplay(NULL);
-  XWindowAttributes attributes;
-  XGetWindowAttributes(display, window_, &attributes);
-  XCloseDisplay(display);
+  return size_.load(std::memory_order_acquire);
+}
+
+PlatformWindowVisibility PlatformWindowX11::GetVisibility() const {
+  return visibility_.load(std::memory_order_acquire);
+}
 
-  return {attributes.width, attributes.height};
+PlatformWindowCoalescingStats PlatformWindowX11::GetCoalescingStats() const {
+  return coalescer_.stats();
+}
+
+void PlatformWindowX11::GetStats(PlatformWindowStats* stats) const {
+  dispatcher_->GetStats(coalescer_.total_merged(), stats);
 }
 
 }  // namespace
@@ -184,9 +1373,122 @@ PlatformWindowSize PlatformWindowX11::GetSize() const {
 PlatformWindow PlatformWindowMakeDefaultWindow(
     const char* title, PlatformWindowEventCallback event_callback,
     void* context) {
-  Display* display = XOpenDisplay(NULL);
-  assert(display);
+  return PlatformWindowMakeWindow(title, kPlatformWindowFlagsNone,
+                                  event_callback, context);
+}
+
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, event_callback, context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, batch_event_callback,
+                                           context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_callback,
+    void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, timed_batch_event_callback,
+                                           context));
+}
+
+namespace {
+// Returns the XInput extension's major opcode if the server supports XInput2,
+// or -1.
+int QueryXInput2(Display* display) {
+  int opcode;
+  int first_event;
+  int first_error;
+  if (!XQueryExtension(display, "XInputExtension", &opcode, &first_event,
+                       &first_error)) {
+    return -1;
+  }
+  // Announcing 2.1 gets raw events delivered even while another client holds
+  // a grab. Any 2.x server will do.
+  int major = 2;
+  int minor = 1;
+  if (XIQueryVersion(display, &major, &minor) != Success || major < 2) {
+    return -1;
+  }
+  return opcode;
+}
+
+// Returns the Present extension's major opcode if the server supports it, or
+// -1.
+int QueryPresent(Display* display) {
+  int opcode;
+  int first_event;
+  int first_error;
+  if (!XPresentQueryExtension(display, &opcode, &first_event, &first_error)) {
+    return -1;
+  }
+  int major = 1;
+  int minor = 0;
+  if (!XPresentQueryVersion(display, &major, &minor)) {
+    return -1;
+  }
+  return opcode;
+}
+
+// Creates the counter that |window| reports drawn resizes with, or returns
+// None if the server lacks the Sync extension.
+XSyncCounter CreateSyncCounter(Display* display, Window window,
+                               Atom counter_atom) {
+  int first_event;
+  int first_error;
+  int major;
+  int minor;
+  if (!XSyncQueryExtension(display, &first_event, &first_error) ||
+      !XSyncInitialize(display, &major, &minor)) {
+    return None;
+  }
+  XSyncValue zero;
+  XSyncIntToValue(&zero, 0);
+  XSyncCounter counter = XSyncCreateCounter(display, zero);
+  const long counter_property = static_cast<long>(counter);
+  XChangeProperty(display, window, counter_atom, XA_CARDINAL, 32,
+                  PropModeReplace,
+                  reinterpret_cast<const unsigned char*>(&counter_property), 1);
+  return counter;
+}
+
+// Selects XI_Motion on |window|, which replaces core MotionNotify events, and
+// XI_RawMotion, which is only ever delivered to the root window.
+void SelectXInput2Events(Display* display, Window window) {
+  unsigned char mask_bits[XIMaskLen(XI_LASTEVENT)] = {};
+  XIEventMask mask;
+  mask.deviceid = XIAllMasterDevices;
+  mask.mask_len = sizeof(mask_bits);
+  mask.mask = mask_bits;
 
+  XISetMask(mask_bits, XI_Motion);
+  XISelectEvents(display, window, &mask, 1);
+
+  std::fill(std::begin(mask_bits), std::end(mask_bits), 0);
+  XISetMask(mask_bits, XI_RawMotion);
+  XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+}
+
+// Creates a top-level window on |display|, with XInput2 mouse input if
+// |use_xinput2| is set, Present completion events if |use_present| is set and
+// synchronized resizes if |use_sync_request| is set, as far as the server
+// supports them.
+X11WindowInfo CreateNativeWindow(Display* display, const char* title,
+                                 bool use_xinput2, bool use_present,
+                                 bool use_sync_request) {
+  X11WindowInfo info;
   Window root_window = DefaultRootWindow(display);
 
   const bool kFullscreen = false;
@@ -200,17 +1502,23 @@ PlatformWindow PlatformWindowMakeDefaultWindow(
       ExposureMask | PointerMotionMask | KeyPressMask | KeyReleaseMask;
   window_attributes.override_redirect = (kFullscreen ? True : False);
 
+  info.initial_size = {root_window_attributes.width / 2,
+                       root_window_attributes.height / 2};
   Window window = XCreateWindow(
-      display, root_window, 0, 0, root_window_attributes.width / 2,
-      root_window_attributes.height / 2, 0, CopyFromParent, InputOutput,
+      display, root_window, 0, 0, info.initial_size.width,
+      info.initial_size.height, 0,
+      CopyFromParent, InputOutput,
       CopyFromParent,
       CWBorderPixel | CWEventMask | (kFullscreen ? CWOverrideRedirect : 0),
       &window_attributes);
 
+  // PropertyChangeMask is for _NET_WM_STATE, which says whether the window
+  // is minimized.
   XSelectInput(display, window,
                VisibilityChangeMask | ExposureMask | FocusChangeMask |
-                   StructureNotifyMask | KeyPressMask | KeyReleaseMask |
-                   ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
+                   StructureNotifyMask | PropertyChangeMask | KeyPressMask |
+                   KeyReleaseMask | ButtonPressMask | ButtonReleaseMask |
+                   PointerMotionMask);
 
   // Hide the mouse cursor in fullscreen mode.
   if (kFullscreen) {
@@ -219,10 +1527,42 @@ PlatformWindow PlatformWindowMakeDefaultWindow(
     // cursor change takes effect, otherwise you have to actually click.
   }
 
-  Atom delete_atom = XInternAtom(display, "WM_DELETE_WINDOW", False);
-  XSetWMProtocols(display, window, &delete_atom, 1);
+  // One round trip for all of the atoms.
+  char* atom_names[] = {const_cast<char*>("WM_DELETE_WINDOW"),
+                        const_cast<char*>("WakeUpAtom"),
+                        const_cast<char*>("PlatformWindowPointerLock"),
+                        const_cast<char*>("_NET_WM_SYNC_REQUEST"),
+                        const_cast<char*>("_NET_WM_SYNC_REQUEST_COUNTER"),
+                        const_cast<char*>("_NET_WM_STATE"),
+                        const_cast<char*>("_NET_WM_STATE_HIDDEN")};
+  Atom atoms[7];
+  XInternAtoms(display, atom_names, 7, False, atoms);
+  info.delete_atom = atoms[0];
+  info.shutdown_atom = atoms[1];
+  info.pointer_lock_atom = atoms[2];
+  info.sync_request_atom = atoms[3];
+  info.net_wm_state_atom = atoms[5];
+  info.net_wm_state_hidden_atom = atoms[6];
 
-  Atom shutdown_atom = XInternAtom(display, "WakeUpAtom", 0);
+  // Window managers only synchronize resizes with clients that advertise
+  // _NET_WM_SYNC_REQUEST and provide a counter. Those then stall every resize
+  // on the application, so it has to ask for it.
+  info.sync_counter = use_sync_request
+                          ? CreateSyncCounter(display, window, atoms[4])
+                          : None;
+  Atom protocols[] = {info.delete_atom, info.sync_request_atom};
+  XSetWMProtocols(display, window, protocols,
+                  info.sync_counter != None ? 2 : 1);
+
+  info.xi_opcode = use_xinput2 ? QueryXInput2(display) : -1;
+  if (info.xi_opcode != -1) {
+    SelectXInput2Events(display, window);
+  }
+
+  info.present_opcode = use_present ? QueryPresent(display) : -1;
+  if (info.present_opcode != -1) {
+    XPresentSelectInput(display, window, PresentCompleteNotifyMask);
+  }
 
   XWMHints hints;
   hints.input = True;
@@ -232,12 +1572,50 @@ PlatformWindow PlatformWindowMakeDefaultWindow(
   // make the window visible on the screen
   XStoreName(display, window, title);
 
-  return new PlatformWindowX11(event_callback, context, display, window,
-                               delete_atom, shutdown_atom);
+  info.window = window;
+  return info;
+}
+
+PlatformWindow MakeWindow(
+    const char* title, uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher) {
+  assert(!(flags & kPlatformWindowFlagSharedEventLoop) ||
+         !(flags & kPlatformWindowFlagNoEventThread));
+  if (flags & kPlatformWindowFlagSharedEventLoop) {
+    SharedEventLoop* loop = SharedEventLoop::Get();
+    PlatformWindowX11* platform_window = nullptr;
+    loop->RunTask([&] {
+      // XInput2 and Present events are not routed by window, so they are not
+      // supported on the shared connection.
+      X11WindowInfo info =
+          CreateNativeWindow(loop->display(), title, false, false,
+                             flags & kPlatformWindowFlagSyncResize);
+      platform_window = new PlatformWindowX11(
+          std::move(dispatcher), flags, loop->display(), info, loop);
+      loop->AddWindow(info.window, platform_window);
+      XFlush(loop->display());
+    });
+    return platform_window;
+  }
+
+  Display* display = OpenDisplay();
+  assert(display);
+  X11WindowInfo info = CreateNativeWindow(
+      display, title, flags & kPlatformWindowFlagRawMouseMotion, true,
+      flags & kPlatformWindowFlagSyncResize);
+  return new PlatformWindowX11(std::move(dispatcher), flags, display, info,
+                               nullptr);
 }
+}  // namespace
 
 void PlatformWindowDestroyWindow(PlatformWindow platform_window) {
-  delete static_cast<PlatformWindowX11*>(platform_window);
+  PlatformWindowX11* window = static_cast<PlatformWindowX11*>(platform_window);
+  SharedEventLoop* loop = window->shared_loop();
+  if (loop && loop->OnEventThread()) {
+    loop->DestroyLater(window);
+    return;
+  }
+  delete window;
 }
 
 NativeWindow PlatformWindowGetNativeWindow(PlatformWindow platform_window) {
@@ -261,419 +1639,91 @@ PlatformWindowSize PlatformWindowGetSize(PlatformWindow window) {
   return static_cast<PlatformWindowX11*>(window)->GetSize();
 }
 
-namespace {
-// Key translation code adopted from
-// https://github.com/youtube/cobalt/blob/master/src/starboard/shared/x11/application_x11.cc.
-
-uint32_t HardwareKeycodeToDefaultXKeysym(uint32_t hardware_code) {
-  static const uint32_t kHardwareKeycodeMap[] = {
-      0,                // 0x00:
-      0,                // 0x01:
-      0,                // 0x02:
-      0,                // 0x03:
-      0,                // 0x04:
-      0,                // 0x05:
-      0,                // 0x06:
-      0,                // 0x07:
-      0,                // 0x08:
-      XK_Escape,        // 0x09: XK_Escape
-      XK_1,             // 0x0A: XK_1
-      XK_2,             // 0x0B: XK_2
-      XK_3,             // 0x0C: XK_3
-      XK_4,             // 0x0D: XK_4
-      XK_5,             // 0x0E: XK_5
-      XK_6,             // 0x0F: XK_6
-      XK_7,             // 0x10: XK_7
-      XK_8,             // 0x11: XK_8
-      XK_9,             // 0x12: XK_9
-      XK_0,             // 0x13: XK_0
-      XK_minus,         // 0x14: XK_minus
-      XK_equal,         // 0x15: XK_equal
-      XK_BackSpace,     // 0x16: XK_BackSpace
-      XK_Tab,           // 0x17: XK_Tab
-      XK_q,             // 0x18: XK_q
-      XK_w,             // 0x19: XK_w
-      XK_e,             // 0x1A: XK_e
-      XK_r,             // 0x1B: XK_r
-      XK_t,             // 0x1C: XK_t
-      XK_y,             // 0x1D: XK_y
-      XK_u,             // 0x1E: XK_u
-      XK_i,             // 0x1F: XK_i
-      XK_o,             // 0x20: XK_o
-      XK_p,             // 0x21: XK_p
-      XK_bracketleft,   // 0x22: XK_bracketleft
-      XK_bracketright,  // 0x23: XK_bracketright
-      XK_Return,        // 0x24: XK_Return
-      XK_Control_L,     // 0x25: XK_Control_L
-      XK_a,             // 0x26: XK_a
-      XK_s,             // 0x27: XK_s
-      XK_d,             // 0x28: XK_d
-      XK_f,             // 0x29: XK_f
-      XK_g,             // 0x2A: XK_g
-      XK_h,             // 0x2B: XK_h
-      XK_j,             // 0x2C: XK_j
-      XK_k,             // 0x2D: XK_k
-      XK_l,             // 0x2E: XK_l
-      XK_semicolon,     // 0x2F: XK_semicolon
-      XK_apostrophe,    // 0x30: XK_apostrophe
-      XK_grave,         // 0x31: XK_grave
-      XK_Shift_L,       // 0x32: XK_Shift_L
-      XK_backslash,     // 0x33: XK_backslash
-      XK_z,             // 0x34: XK_z
-      XK_x,             // 0x35: XK_x
-      XK_c,             // 0x36: XK_c
-      XK_v,             // 0x37: XK_v
-      XK_b,             // 0x38: XK_b
-      XK_n,             // 0x39: XK_n
-      XK_m,             // 0x3A: XK_m
-      XK_comma,         // 0x3B: XK_comma
-      XK_period,        // 0x3C: XK_period
-      XK_slash,         // 0x3D: XK_slash
-      XK_Shift_R,       // 0x3E: XK_Shift_R
-      0,                // 0x3F: XK_KP_Multiply
-      XK_Alt_L,         // 0x40: XK_Alt_L
-      XK_space,         // 0x41: XK_space
-      XK_Caps_Lock,     // 0x42: XK_Caps_Lock
-      XK_F1,            // 0x43: XK_F1
-      XK_F2,            // 0x44: XK_F2
-      XK_F3,            // 0x45: XK_F3
-      XK_F4,            // 0x46: XK_F4
-      XK_F5,            // 0x47: XK_F5
-      XK_F6,            // 0x48: XK_F6
-      XK_F7,            // 0x49: XK_F7
-      XK_F8,            // 0x4A: XK_F8
-      XK_F9,            // 0x4B: XK_F9
-      XK_F10,           // 0x4C: XK_F10
-      XK_Num_Lock,      // 0x4D: XK_Num_Lock
-      XK_Scroll_Lock,   // 0x4E: XK_Scroll_Lock
-  };
+PlatformWindowVisibility PlatformWindowGetVisibility(PlatformWindow window) {
+  return static_cast<PlatformWindowX11*>(window)->GetVisibility();
+}
 
-  return hardware_code <
-                 sizeof(kHardwareKeycodeMap) / sizeof(kHardwareKeycodeMap[0])
-             ? kHardwareKeycodeMap[hardware_code]
-             : 0;
-}
-
-PlatformWindowKey KeysymToPlatformWindowKey(KeySym keysym) {
-  switch (keysym) {
-    case XK_BackSpace:
-      return kPlatformWindowKeyBackspace;
-    case XK_Delete:
-    case XK_KP_Delete:
-      return kPlatformWindowKeyDelete;
-    case XK_Tab:
-    case XK_KP_Tab:
-    case XK_ISO_Left_Tab:
-      return kPlatformWindowKeyTab;
-    case XK_Linefeed:
-    case XK_Return:
-    case XK_KP_Enter:
-    case XK_ISO_Enter:
-      return kPlatformWindowKeyReturn;
-    case XK_Clear:
-    case XK_KP_Begin:
-      return kPlatformWindowKeyClear;
-    case XK_KP_Space:
-    case XK_space:
-      return kPlatformWindowKeySpace;
-    case XK_Home:
-    case XK_KP_Home:
-      return kPlatformWindowKeyHome;
-    case XK_End:
-    case XK_KP_End:
-      return kPlatformWindowKeyEnd;
-    case XK_Page_Up:
-    case XK_KP_Page_Up:  // aka XK_KP_Prior
-      return kPlatformWindowKeyPrior;
-    case XK_Page_Down:
-    case XK_KP_Page_Down:  // aka XK_KP_Next
-      return kPlatformWindowKeyNext;
-    case XK_Left:
-    case XK_KP_Left:
-      return kPlatformWindowKeyLeft;
-    case XK_Right:
-    case XK_KP_Right:
-      return kPlatformWindowKeyRight;
-    case XK_Down:
-    case XK_KP_Down:
-      return kPlatformWindowKeyDown;
-    case XK_Up:
-    case XK_KP_Up:
-      return kPlatformWindowKeyUp;
-    case XK_Escape:
-      return kPlatformWindowKeyEscape;
-    case XK_Kana_Lock:
-    case XK_Kana_Shift:
-      return kPlatformWindowKeyKana;
-    case XK_Hangul:
-      return kPlatformWindowKeyHangul;
-    case XK_Hangul_Hanja:
-      return kPlatformWindowKeyHanja;
-    case XK_Kanji:
-      return kPlatformWindowKeyKanji;
-    case XK_Henkan:
-      return kPlatformWindowKeyConvert;
-    case XK_Muhenkan:
-      return kPlatformWindowKeyNonconvert;
-    case XK_Zenkaku_Hankaku:
-      return kPlatformWindowKeyDbeDbcschar;
-    case XK_A:
-    case XK_a:
-      return kPlatformWindowKeyA;
-    case XK_B:
-    case XK_b:
-      return kPlatformWindowKeyB;
-    case XK_C:
-    case XK_c:
-      return kPlatformWindowKeyC;
-    case XK_D:
-    case XK_d:
-      return kPlatformWindowKeyD;
-    case XK_E:
-    case XK_e:
-      return kPlatformWindowKeyE;
-    case XK_F:
-    case XK_f:
-      return kPlatformWindowKeyF;
-    case XK_G:
-    case XK_g:
-      return kPlatformWindowKeyG;
-    case XK_H:
-    case XK_h:
-      return kPlatformWindowKeyH;
-    case XK_I:
-    case XK_i:
-      return kPlatformWindowKeyI;
-    case XK_J:
-    case XK_j:
-      return kPlatformWindowKeyJ;
-    case XK_K:
-    case XK_k:
-      return kPlatformWindowKeyK;
-    case XK_L:
-    case XK_l:
-      return kPlatformWindowKeyL;
-    case XK_M:
-    case XK_m:
-      return kPlatformWindowKeyM;
-    case XK_N:
-    case XK_n:
-      return kPlatformWindowKeyN;
-    case XK_O:
-    case XK_o:
-      return kPlatformWindowKeyO;
-    case XK_P:
-    case XK_p:
-      return kPlatformWindowKeyP;
-    case XK_Q:
-    case XK_q:
-      return kPlatformWindowKeyQ;
-    case XK_R:
-    case XK_r:
-      return kPlatformWindowKeyR;
-    case XK_S:
-    case XK_s:
-      return kPlatformWindowKeyS;
-    case XK_T:
-    case XK_t:
-      return kPlatformWindowKeyT;
-    case XK_U:
-    case XK_u:
-      return kPlatformWindowKeyU;
-    case XK_V:
-    case XK_v:
-      return kPlatformWindowKeyV;
-    case XK_W:
-    case XK_w:
-      return kPlatformWindowKeyW;
-    case XK_X:
-    case XK_x:
-      return kPlatformWindowKeyX;
-    case XK_Y:
-    case XK_y:
-      return kPlatformWindowKeyY;
-    case XK_Z:
-    case XK_z:
-      return kPlatformWindowKeyZ;
-
-    case XK_0:
-    case XK_1:
-    case XK_2:
-    case XK_3:
-    case XK_4:
-    case XK_5:
-    case XK_6:
-    case XK_7:
-    case XK_8:
-    case XK_9:
-      return static_cast<PlatformWindowKey>(kPlatformWindowKey0 +
-                                            (keysym - XK_0));
-
-    case XK_parenright:
-      return kPlatformWindowKey0;
-    case XK_exclam:
-      return kPlatformWindowKey1;
-    case XK_at:
-      return kPlatformWindowKey2;
-    case XK_numbersign:
-      return kPlatformWindowKey3;
-    case XK_dollar:
-      return kPlatformWindowKey4;
-    case XK_percent:
-      return kPlatformWindowKey5;
-    case XK_asciicircum:
-      return kPlatformWindowKey6;
-    case XK_ampersand:
-      return kPlatformWindowKey7;
-    case XK_asterisk:
-      return kPlatformWindowKey8;
-    case XK_parenleft:
-      return kPlatformWindowKey9;
-
-    case XK_KP_0:
-    case XK_KP_1:
-    case XK_KP_2:
-    case XK_KP_3:
-    case XK_KP_4:
-    case XK_KP_5:
-    case XK_KP_6:
-    case XK_KP_7:
-    case XK_KP_8:
-    case XK_KP_9:
-      return static_cast<PlatformWindowKey>(kPlatformWindowKeyNumpad0 +
-                                            (keysym - XK_KP_0));
-
-    case XK_multiply:
-    case XK_KP_Multiply:
-      return kPlatformWindowKeyMultiply;
-    case XK_KP_Add:
-      return kPlatformWindowKeyAdd;
-    case XK_KP_Separator:
-      return kPlatformWindowKeySeparator;
-    case XK_KP_Subtract:
-      return kPlatformWindowKeySubtract;
-    case XK_KP_Decimal:
-      return kPlatformWindowKeyDecimal;
-    case XK_KP_Divide:
-      return kPlatformWindowKeyDivide;
-    case XK_KP_Equal:
-    case XK_equal:
-    case XK_plus:
-      return kPlatformWindowKeyOemPlus;
-    case XK_comma:
-    case XK_less:
-      return kPlatformWindowKeyOemComma;
-    case XK_minus:
-    case XK_underscore:
-      return kPlatformWindowKeyOemMinus;
-    case XK_greater:
-    case XK_period:
-      return kPlatformWindowKeyOemPeriod;
-    case XK_colon:
-    case XK_semicolon:
-      return kPlatformWindowKeyOem1;
-    case XK_question:
-    case XK_slash:
-      return kPlatformWindowKeyOem2;
-    case XK_asciitilde:
-    case XK_quoteleft:
-      return kPlatformWindowKeyOem3;
-    case XK_bracketleft:
-    case XK_braceleft:
-      return kPlatformWindowKeyOem4;
-    case XK_backslash:
-    case XK_bar:
-      return kPlatformWindowKeyOem5;
-    case XK_bracketright:
-    case XK_braceright:
-      return kPlatformWindowKeyOem6;
-    case XK_quoteright:
-    case XK_quotedbl:
-      return kPlatformWindowKeyOem7;
-    case XK_Shift_L:
-    case XK_Shift_R:
-      return kPlatformWindowKeyShift;
-    case XK_Control_L:
-    case XK_Control_R:
-      return kPlatformWindowKeyControl;
-    case XK_Meta_L:
-    case XK_Meta_R:
-    case XK_Alt_L:
-    case XK_Alt_R:
-      return kPlatformWindowKeyMenu;
-    case XK_Pause:
-      return kPlatformWindowKeyPause;
-    case XK_Caps_Lock:
-      return kPlatformWindowKeyCapital;
-    case XK_Num_Lock:
-      return kPlatformWindowKeyNumlock;
-    case XK_Scroll_Lock:
-      return kPlatformWindowKeyScroll;
-    case XK_Select:
-      return kPlatformWindowKeySelect;
-    case XK_Print:
-      return kPlatformWindowKeyPrint;
-    case XK_Execute:
-      return kPlatformWindowKeyExecute;
-    case XK_Insert:
-    case XK_KP_Insert:
-      return kPlatformWindowKeyInsert;
-    case XK_Help:
-      return kPlatformWindowKeyHelp;
-    case XK_Super_L:
-      return kPlatformWindowKeyLwin;
-    case XK_Super_R:
-      return kPlatformWindowKeyRwin;
-    case XK_Menu:
-      return kPlatformWindowKeyApps;
-    case XK_F1:
-    case XK_F2:
-    case XK_F3:
-    case XK_F4:
-    case XK_F5:
-    case XK_F6:
-    case XK_F7:
-    case XK_F8:
-    case XK_F9:
-    case XK_F10:
-    case XK_F11:
-    case XK_F12:
-    case XK_F13:
-    case XK_F14:
-    case XK_F15:
-    case XK_F16:
-    case XK_F17:
-    case XK_F18:
-    case XK_F19:
-    case XK_F20:
-    case XK_F21:
-    case XK_F22:
-    case XK_F23:
-    case XK_F24:
-      return static_cast<PlatformWindowKey>(kPlatformWindowKeyF1 +
-                                            (keysym - XK_F1));
-    case XK_KP_F1:
-    case XK_KP_F2:
-    case XK_KP_F3:
-    case XK_KP_F4:
-      return static_cast<PlatformWindowKey>(kPlatformWindowKeyF1 +
-                                            (keysym - XK_KP_F1));
-  }
-  return kPlatformWindowKeyUnknown;
-}
-
-// Get a PlatformWindowKey from an XKeyEvent.
-PlatformWindowKey XKeyEventToPlatformWindowKey(XKeyEvent* event) {
-  // XLookupKeysym does not take into consideration the state of the
-  // lock/shift etc. keys. So it is necessary to use XLookupString instead.
-  KeySym keysym = XK_VoidSymbol;
-  XLookupString(event, NULL, 0, &keysym, NULL);
-  PlatformWindowKey key = KeysymToPlatformWindowKey(keysym);
-  if (key == kPlatformWindowKeyUnknown) {
-    keysym = HardwareKeycodeToDefaultXKeysym(event->keycode);
-    key = KeysymToPlatformWindowKey(keysym);
-  }
-
-  return key;
+bool PlatformWindowSetPointerLock(PlatformWindow window,
+                                  PlatformWindowPointerLock lock) {
+  return static_cast<PlatformWindowX11*>(window)->SetPointerLock(lock);
+}
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow window) {
+  return static_cast<PlatformWindowX11*>(window)->GetCoalescingStats();
+}
+
+void PlatformWindowGetStats(PlatformWindow window, PlatformWindowStats* stats) {
+  static_cast<PlatformWindowX11*>(window)->GetStats(stats);
+}
+
+size_t PlatformWindowPollEvents(PlatformWindow window,
+                                PlatformWindowEvent* events, size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowX11*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+size_t PlatformWindowPollTimedEvents(PlatformWindow window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowX11*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+bool PlatformWindowWaitEvents(PlatformWindow window,
+                              int32_t timeout_in_milliseconds) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowX11*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Wait(std::chrono::milliseconds(timeout_in_milliseconds));
+}
+
+bool PlatformWindowStartRecording(PlatformWindow window, const char* path) {
+  std::unique_ptr<platform_window::EventRecorder> recorder =
+      platform_window::EventRecorder::Create(path);
+  if (!recorder) {
+    return false;
+  }
+  static_cast<PlatformWindowX11*>(window)->dispatcher()->SetRecorder(
+      std::move(recorder));
+  return true;
+}
+
+void PlatformWindowStopRecording(PlatformWindow window) {
+  static_cast<PlatformWindowX11*>(window)->dispatcher()->SetRecorder(nullptr);
+}
+
+int PlatformWindowGetEventFd(PlatformWindow window) {
+  return static_cast<PlatformWindowX11*>(window)->GetEventFd();
+}
+
+size_t PlatformWindowDispatchPending(PlatformWindow window) {
+  return static_cast<PlatformWindowX11*>(window)->DispatchPending();
+}
+
+void PlatformWindowAckFrame(PlatformWindow window) {
+  static_cast<PlatformWindowX11*>(window)->AckFrame();
+}
+
+bool PlatformWindowWaitForNextFrame(PlatformWindow window) {
+  return static_cast<PlatformWindowX11*>(window)->WaitForNextFrame();
+}
+
+bool PlatformWindowGetFrameTiming(PlatformWindow window,
+                                  PlatformWindowFrameTiming* timing) {
+  return static_cast<PlatformWindowX11*>(window)->GetFrameTiming(timing);
+}
+
+xcb_connection_t* PlatformWindowX11GetXcbConnection(PlatformWindow window) {
+  return XGetXCBConnection(static_cast<PlatformWindowX11*>(window)->display());
+}
+
+uint32_t PlatformWindowX11GetVisualId(PlatformWindow window) {
+  // Windows are created with their parent's, the root window's, visual.
+  Display* display = static_cast<PlatformWindowX11*>(window)->display();
+  return XVisualIDFromVisual(DefaultVisual(display, DefaultScreen(display)));
 }
-}  // namespace
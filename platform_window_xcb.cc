@@ -0,0 +1,705 @@
+#include <xcb/xcb.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "event_coalescer.h"
+#include "event_dispatcher.h"
+#include "event_time.h"
+#include "platform_window/event_loop.h"
+#include "platform_window/frame_timing.h"
+#include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
+#include "platform_window/x11.h"
+#include "x11_keycode_table.h"
+
+// An X11 backend built on XCB instead of Xlib. XCB connections are
+// thread-safe and every request returns a cookie instead of blocking, so all
+// windows share one connection: requests are sent from whichever thread makes
+// them, and a single event thread reads the events of every window and routes
+// them by window id. Creating a window needs no round trips once the
+// connection is up.
+
+namespace {
+class PlatformWindowXcb;
+
+// WM_HINTS is nine CARD32s, the first two being the flags and the input hint.
+const uint32_t kWmHintsInputHint = 1;
+const uint32_t kWmHintsLength = 9;
+
+std::unique_ptr<platform_window::KeycodeTable> MakeKeycodeTable(
+    const xcb_setup_t* setup, xcb_get_keyboard_mapping_reply_t* reply) {
+  if (!reply) {
+    return std::make_unique<platform_window::KeycodeTable>(0, -1, 0, nullptr);
+  }
+  std::unique_ptr<platform_window::KeycodeTable> table =
+      std::make_unique<platform_window::KeycodeTable>(
+          setup->min_keycode, setup->max_keycode, reply->keysyms_per_keycode,
+          xcb_get_keyboard_mapping_keysyms(reply));
+  free(reply);
+  return table;
+}
+
+xcb_get_keyboard_mapping_cookie_t RequestKeyboardMapping(
+    xcb_connection_t* connection) {
+  const xcb_setup_t* setup = xcb_get_setup(connection);
+  return xcb_get_keyboard_mapping(
+      connection, setup->min_keycode,
+      setup->max_keycode - setup->min_keycode + 1);
+}
+
+xcb_atom_t AtomFromReply(xcb_intern_atom_reply_t* reply) {
+  if (!reply) {
+    return XCB_ATOM_NONE;
+  }
+  xcb_atom_t atom = reply->atom;
+  free(reply);
+  return atom;
+}
+
+// The process-wide connection, and the event thread that serves it.
+class XcbConnection {
+ public:
+  static XcbConnection* Get() {
+    // Intentionally leaked, it lives for the lifetime of the process.
+    static XcbConnection* connection = new XcbConnection();
+    return connection;
+  }
+
+  xcb_connection_t* connection() const { return connection_; }
+  const xcb_screen_t* screen() const { return screen_; }
+  xcb_atom_t wm_protocols_atom() const { return wm_protocols_atom_; }
+  xcb_atom_t delete_atom() const { return delete_atom_; }
+
+  void AddWindow(PlatformWindowXcb* window);
+  // Once this returns, the event thread is done with |window|.
+  void RemoveWindow(PlatformWindowXcb* window);
+  // Destroys |window|, or if called from an event handler, which may be one
+  // of |window|'s own and so still be running, stops routing events to it
+  // right away and destroys it once the event thread is back out of the
+  // handlers.
+  void DestroyWindow(PlatformWindowXcb* window);
+
+ private:
+  XcbConnection();
+
+  void Run();
+
+  // Routes |event| to its window, adding the window to |windows_with_events|
+  // the first time it receives something in this batch. Called with |mutex_|
+  // held.
+  void RouteEvent(const xcb_generic_event_t* event, int64_t received_ns,
+                  std::vector<PlatformWindowXcb*>* windows_with_events);
+
+  bool IsRegistered(PlatformWindowXcb* window) const;
+
+  xcb_connection_t* connection_;
+  const xcb_screen_t* screen_;
+  xcb_atom_t wm_protocols_atom_;
+  xcb_atom_t delete_atom_;
+
+  std::mutex mutex_;
+  std::condition_variable dispatch_done_;
+  std::unordered_map<xcb_window_t, PlatformWindowXcb*> windows_;
+  // The window whose events the event thread is currently dispatching, if
+  // any.
+  PlatformWindowXcb* dispatching_ = nullptr;
+
+  // Only accessed from the event thread.
+  std::vector<PlatformWindowXcb*> windows_to_destroy_;
+  // Whether the batch being routed contained a keyboard MappingNotify.
+  bool keyboard_mapping_changed_ = false;
+
+  std::thread thread_;
+};
+
+class PlatformWindowXcb {
+ public:
+  PlatformWindowXcb(
+      std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+      uint32_t flags, xcb_window_t window, PlatformWindowSize initial_size);
+  ~PlatformWindowXcb();
+
+  xcb_window_t window() const { return window_; }
+  platform_window::EventDispatcher* dispatcher() const {
+    return dispatcher_.get();
+  }
+
+  void Show();
+  void Hide();
+
+  void SetTitle(const char* title);
+
+  PlatformWindowSize GetSize() const {
+    return size_.load(std::memory_order_acquire);
+  }
+  // Only whether the window was last shown or hidden, as the backend has no
+  // finer visibility to report.
+  PlatformWindowVisibility GetVisibility() const {
+    return shown_.load(std::memory_order_relaxed)
+               ? kPlatformWindowVisibilityVisible
+               : kPlatformWindowVisibilityUnmapped;
+  }
+
+  PlatformWindowCoalescingStats GetCoalescingStats() const {
+    return coalescer_.stats();
+  }
+  void GetStats(PlatformWindowStats* stats) const {
+    dispatcher_->GetStats(coalescer_.total_merged(), stats);
+  }
+
+  // Translates |event|, received at |received_ns|, and queues the result, if
+  // any, for the next DispatchPendingEvents(). Returns false if nothing was
+  // pending before. Only called from the event thread.
+  bool TranslateEvent(const xcb_generic_event_t* event, int64_t received_ns);
+  // Only called from the event thread.
+  void DispatchPendingEvents();
+
+ private:
+  int64_t GetTimestampNs(xcb_timestamp_t time, int64_t received_ns) {
+    return time_mapper_.ToMonotonicNs(time, received_ns);
+  }
+
+  std::unique_ptr<platform_window::EventDispatcher> dispatcher_;
+
+  xcb_connection_t* connection_;
+  xcb_window_t window_;
+  xcb_atom_t delete_atom_;
+
+  std::atomic<bool> shown_ = false;
+
+  // Written by the event thread on every ConfigureNotify, so that GetSize()
+  // can be answered without a server round trip.
+  std::atomic<PlatformWindowSize> size_;
+  static_assert(std::atomic<PlatformWindowSize>::is_always_lock_free);
+
+  // The rest is only accessed from the event thread.
+  platform_window::EventTimeMapper time_mapper_;
+  platform_window::EventCoalescer coalescer_;
+  std::vector<PlatformWindowTimedEvent> pending_events_;
+  size_t pending_native_events_ = 0;
+};
+
+XcbConnection::XcbConnection() {
+  int screen_number = 0;
+  connection_ = xcb_connect(NULL, &screen_number);
+  assert(!xcb_connection_has_error(connection_));
+
+  xcb_screen_iterator_t screens =
+      xcb_setup_roots_iterator(xcb_get_setup(connection_));
+  for (int i = 0; i < screen_number; ++i) {
+    xcb_screen_next(&screens);
+  }
+  screen_ = screens.data;
+
+  // Send every request before waiting on any reply, so that startup costs a
+  // single round trip.
+  static const char kWmProtocols[] = "WM_PROTOCOLS";
+  static const char kWmDeleteWindow[] = "WM_DELETE_WINDOW";
+  xcb_intern_atom_cookie_t wm_protocols_cookie = xcb_intern_atom(
+      connection_, 0, sizeof(kWmProtocols) - 1, kWmProtocols);
+  xcb_intern_atom_cookie_t delete_cookie = xcb_intern_atom(
+      connection_, 0, sizeof(kWmDeleteWindow) - 1, kWmDeleteWindow);
+  xcb_get_keyboard_mapping_cookie_t keyboard_mapping_cookie =
+      RequestKeyboardMapping(connection_);
+
+  wm_protocols_atom_ = AtomFromReply(
+      xcb_intern_atom_reply(connection_, wm_protocols_cookie, nullptr));
+  delete_atom_ =
+      AtomFromReply(xcb_intern_atom_reply(connection_, delete_cookie, nullptr));
+  platform_window::InstallSharedKeycodeTable(
+      MakeKeycodeTable(xcb_get_setup(connection_),
+                       xcb_get_keyboard_mapping_reply(
+                           connection_, keyboard_mapping_cookie, nullptr)),
+      /*replace=*/true);
+
+  thread_ = std::thread([this] { Run(); });
+}
+
+void XcbConnection::AddWindow(PlatformWindowXcb* window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  windows_[window->window()] = window;
+}
+
+void XcbConnection::RemoveWindow(PlatformWindowXcb* window) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  windows_.erase(window->window());
+  // Windows destroyed from the event thread are only removed once it is done
+  // dispatching (see DestroyWindow()), and it must not wait on itself.
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    dispatch_done_.wait(lock,
+                        [this, window] { return dispatching_ != window; });
+  }
+}
+
+void XcbConnection::DestroyWindow(PlatformWindowXcb* window) {
+  if (std::this_thread::get_id() != thread_.get_id()) {
+    delete window;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    windows_.erase(window->window());
+  }
+  windows_to_destroy_.push_back(window);
+}
+
+bool XcbConnection::IsRegistered(PlatformWindowXcb* window) const {
+  auto found = windows_.find(window->window());
+  return found != windows_.end() && found->second == window;
+}
+
+void XcbConnection::Run() {
+  std::vector<PlatformWindowXcb*> windows_with_events;
+  // Returns null once the connection is closed or broken.
+  while (xcb_generic_event_t* event = xcb_wait_for_event(connection_)) {
+    // Route everything that has already been read, so that each window gets
+    // it in a single batch.
+    windows_with_events.clear();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      do {
+        RouteEvent(event, platform_window::MonotonicNowNs(),
+                   &windows_with_events);
+        free(event);
+      } while ((event = xcb_poll_for_queued_event(connection_)));
+    }
+
+    // A burst of mapping changes costs a single round trip, which is not
+    // made while holding |mutex_| so that other threads are not held up.
+    if (keyboard_mapping_changed_) {
+      keyboard_mapping_changed_ = false;
+      platform_window::InstallSharedKeycodeTable(
+          MakeKeycodeTable(xcb_get_setup(connection_),
+                           xcb_get_keyboard_mapping_reply(
+                               connection_,
+                               RequestKeyboardMapping(connection_), nullptr)),
+          /*replace=*/true);
+    }
+
+    for (PlatformWindowXcb* window : windows_with_events) {
+      {
+        // Skip windows that an earlier handler destroyed.
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!IsRegistered(window)) {
+          continue;
+        }
+        dispatching_ = window;
+      }
+      window->DispatchPendingEvents();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dispatching_ = nullptr;
+      }
+      dispatch_done_.notify_all();
+    }
+
+    std::vector<PlatformWindowXcb*> windows;
+    windows.swap(windows_to_destroy_);
+    for (PlatformWindowXcb* window : windows) {
+      delete window;
+    }
+  }
+}
+
+void XcbConnection::RouteEvent(
+    const xcb_generic_event_t* event, int64_t received_ns,
+    std::vector<PlatformWindowXcb*>* windows_with_events) {
+  xcb_window_t window_id;
+  switch (event->response_type & ~0x80) {
+    case XCB_KEY_PRESS:
+    case XCB_KEY_RELEASE:
+      window_id =
+          reinterpret_cast<const xcb_key_press_event_t*>(event)->event;
+      break;
+    case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE:
+      window_id =
+          reinterpret_cast<const xcb_button_press_event_t*>(event)->event;
+      break;
+    case XCB_MOTION_NOTIFY:
+      window_id =
+          reinterpret_cast<const xcb_motion_notify_event_t*>(event)->event;
+      break;
+    case XCB_CONFIGURE_NOTIFY:
+      window_id =
+          reinterpret_cast<const xcb_configure_notify_event_t*>(event)->window;
+      break;
+    case XCB_CLIENT_MESSAGE:
+      window_id =
+          reinterpret_cast<const xcb_client_message_event_t*>(event)->window;
+      break;
+    case XCB_MAPPING_NOTIFY:
+      // Fetched once the batch is routed, see Run().
+      if (reinterpret_cast<const xcb_mapping_notify_event_t*>(event)
+              ->request == XCB_MAPPING_KEYBOARD) {
+        keyboard_mapping_changed_ = true;
+      }
+      return;
+    default:
+      // Errors and events we did not select.
+      return;
+  }
+
+  auto found = windows_.find(window_id);
+  if (found == windows_.end()) {
+    return;
+  }
+  if (found->second->TranslateEvent(event, received_ns)) {
+    windows_with_events->push_back(found->second);
+  }
+}
+
+PlatformWindowXcb::PlatformWindowXcb(
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher,
+    uint32_t flags, xcb_window_t window, PlatformWindowSize initial_size)
+    : dispatcher_(std::move(dispatcher)),
+      connection_(XcbConnection::Get()->connection()),
+      window_(window),
+      delete_atom_(XcbConnection::Get()->delete_atom()),
+      size_(initial_size),
+      coalescer_(flags & kPlatformWindowFlagCoalesceMotion) {
+  XcbConnection::Get()->AddWindow(this);
+}
+
+PlatformWindowXcb::~PlatformWindowXcb() {
+  XcbConnection::Get()->RemoveWindow(this);
+  xcb_destroy_window(connection_, window_);
+  xcb_flush(connection_);
+}
+
+void PlatformWindowXcb::Show() {
+  shown_.store(true, std::memory_order_relaxed);
+  xcb_map_window(connection_, window_);
+  xcb_flush(connection_);
+}
+
+void PlatformWindowXcb::Hide() {
+  shown_.store(false, std::memory_order_relaxed);
+  xcb_unmap_window(connection_, window_);
+  xcb_flush(connection_);
+}
+
+void PlatformWindowXcb::SetTitle(const char* title) {
+  xcb_change_property(connection_, XCB_PROP_MODE_REPLACE, window_,
+                      XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(title),
+                      title);
+  xcb_flush(connection_);
+}
+
+bool PlatformWindowXcb::TranslateEvent(const xcb_generic_event_t* event,
+                                       int64_t received_ns) {
+  const bool was_empty = pending_native_events_ == 0;
+  ++pending_native_events_;
+  const uint8_t type = event->response_type & ~0x80;
+  dispatcher_->stats()->RecordNativeEvent(type);
+  auto append = [&](PlatformWindowEventType event_type,
+                    const PlatformWindowEventData& data,
+                    int64_t timestamp_ns) {
+    coalescer_.Append({{event_type, data}, timestamp_ns, received_ns},
+                      &pending_events_);
+  };
+  switch (type) {
+    case XCB_KEY_PRESS:
+    case XCB_KEY_RELEASE: {
+      const xcb_key_press_event_t* key_event =
+          reinterpret_cast<const xcb_key_press_event_t*>(event);
+      PlatformWindowEventData data;
+      data.key.pressed = (type == XCB_KEY_PRESS);
+      data.key.key = platform_window::GetSharedKeycodeTable()
+                         ->TranslateWithState(key_event->detail,
+                                              key_event->state);
+      data.key.scancode = key_event->detail;
+      append(kPlatformWindowEventTypeKey, data,
+             GetTimestampNs(key_event->time, received_ns));
+    } break;
+    case XCB_BUTTON_PRESS:
+    case XCB_BUTTON_RELEASE: {
+      const xcb_button_press_event_t* button_event =
+          reinterpret_cast<const xcb_button_press_event_t*>(event);
+      const int64_t timestamp_ns =
+          GetTimestampNs(button_event->time, received_ns);
+
+      // Handle mouse wheel events.
+      if (button_event->detail == 4 || button_event->detail == 5) {
+        PlatformWindowEventData data;
+        data.mouse_wheel.angle_in_degrees =
+            15 * (button_event->detail == 4 ? 1 : -1);
+        data.mouse_wheel.x = button_event->event_x;
+        data.mouse_wheel.y = button_event->event_y;
+        append(kPlatformWindowEventTypeMouseWheel, data, timestamp_ns);
+        break;
+      }
+
+      PlatformWindowEventData data;
+      data.mouse_button.pressed = (type == XCB_BUTTON_PRESS);
+      data.mouse_button.button = [button_event] {
+        switch (button_event->detail) {
+          case XCB_BUTTON_INDEX_1:
+            return kPlatformWindowMouseLeft;
+          case XCB_BUTTON_INDEX_3:
+            return kPlatformWindowMouseRight;
+          default:
+            return kPlatformWindowMouseUnknown;
+        }
+      }();
+      data.mouse_button.x = button_event->event_x;
+      data.mouse_button.y = button_event->event_y;
+      append(kPlatformWindowEventTypeMouseButton, data, timestamp_ns);
+    } break;
+    case XCB_MOTION_NOTIFY: {
+      const xcb_motion_notify_event_t* motion_event =
+          reinterpret_cast<const xcb_motion_notify_event_t*>(event);
+      PlatformWindowEventData data;
+      data.mouse_move.x = motion_event->event_x;
+      data.mouse_move.y = motion_event->event_y;
+      data.mouse_move.precise_x = motion_event->event_x;
+      data.mouse_move.precise_y = motion_event->event_y;
+      append(kPlatformWindowEventTypeMouseMove, data,
+             GetTimestampNs(motion_event->time, received_ns));
+    } break;
+    case XCB_CONFIGURE_NOTIFY: {
+      const xcb_configure_notify_event_t* configure_event =
+          reinterpret_cast<const xcb_configure_notify_event_t*>(event);
+      const PlatformWindowSize size = {configure_event->width,
+                                       configure_event->height};
+      // Moves and restacking are reported with the same event.
+      const PlatformWindowSize old_size =
+          size_.load(std::memory_order_relaxed);
+      if (size.width == old_size.width && size.height == old_size.height) {
+        break;
+      }
+      size_.store(size, std::memory_order_release);
+      PlatformWindowEventData data;
+      data.resized = {};
+      data.resized.size = size;
+      append(kPlatformWindowEventTypeResized, data, received_ns);
+    } break;
+    case XCB_CLIENT_MESSAGE: {
+      const xcb_client_message_event_t* client_message =
+          reinterpret_cast<const xcb_client_message_event_t*>(event);
+      if (client_message->data.data32[0] == delete_atom_) {
+        append(kPlatformWindowEventTypeQuitRequest, {}, received_ns);
+      }
+    } break;
+  }
+  return was_empty;
+}
+
+void PlatformWindowXcb::DispatchPendingEvents() {
+  dispatcher_->stats()->RecordQueueDepth(pending_native_events_);
+  pending_native_events_ = 0;
+  if (!pending_events_.empty()) {
+    dispatcher_->Dispatch(pending_events_.data(), pending_events_.size());
+    pending_events_.clear();
+  }
+}
+
+PlatformWindow MakeWindow(
+    const char* title, uint32_t flags,
+    std::unique_ptr<platform_window::EventDispatcher> dispatcher) {
+  XcbConnection* xcb = XcbConnection::Get();
+  xcb_connection_t* connection = xcb->connection();
+  const xcb_screen_t* screen = xcb->screen();
+
+  // The root window's size comes with the connection setup, so unlike
+  // XGetWindowAttributes this costs no round trip.
+  const PlatformWindowSize initial_size = {screen->width_in_pixels / 2,
+                                           screen->height_in_pixels / 2};
+
+  const xcb_window_t window = xcb_generate_id(connection);
+  const uint32_t value_mask = XCB_CW_BORDER_PIXEL | XCB_CW_EVENT_MASK;
+  const uint32_t values[] = {
+      0,
+      XCB_EVENT_MASK_VISIBILITY_CHANGE | XCB_EVENT_MASK_EXPOSURE |
+          XCB_EVENT_MASK_FOCUS_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY |
+          XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE |
+          XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE |
+          XCB_EVENT_MASK_POINTER_MOTION,
+  };
+  xcb_create_window(connection, XCB_COPY_FROM_PARENT, window, screen->root, 0,
+                    0, initial_size.width, initial_size.height, 0,
+                    XCB_WINDOW_CLASS_INPUT_OUTPUT, screen->root_visual,
+                    value_mask, values);
+
+  const xcb_atom_t delete_atom = xcb->delete_atom();
+  xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window,
+                      xcb->wm_protocols_atom(), XCB_ATOM_ATOM, 32, 1,
+                      &delete_atom);
+
+  const uint32_t hints[kWmHintsLength] = {kWmHintsInputHint, 1};
+  xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window,
+                      XCB_ATOM_WM_HINTS, XCB_ATOM_WM_HINTS, 32, kWmHintsLength,
+                      hints);
+
+  xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window,
+                      XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8, strlen(title),
+                      title);
+
+  // Register the window before flushing, so that none of its events can
+  // arrive before it can be routed to.
+  PlatformWindowXcb* platform_window = new PlatformWindowXcb(
+      std::move(dispatcher), flags, window, initial_size);
+  xcb_flush(connection);
+  return platform_window;
+}
+}  // namespace
+
+PlatformWindow PlatformWindowMakeDefaultWindow(
+    const char* title, PlatformWindowEventCallback event_callback,
+    void* context) {
+  return PlatformWindowMakeWindow(title, kPlatformWindowFlagsNone,
+                                  event_callback, context);
+}
+
+PlatformWindow PlatformWindowMakeWindow(
+    const char* title, uint32_t flags,
+    PlatformWindowEventCallback event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, event_callback, context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowBatchEventCallback batch_event_callback, void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, batch_event_callback,
+                                           context));
+}
+
+PlatformWindow PlatformWindowMakeWindowWithTimedBatchCallback(
+    const char* title, uint32_t flags,
+    PlatformWindowTimedBatchEventCallback timed_batch_event_callback,
+    void* context) {
+  return MakeWindow(
+      title, flags,
+      platform_window::MakeEventDispatcher(flags, timed_batch_event_callback,
+                                           context));
+}
+
+void PlatformWindowDestroyWindow(PlatformWindow platform_window) {
+  XcbConnection::Get()->DestroyWindow(
+      static_cast<PlatformWindowXcb*>(platform_window));
+}
+
+NativeWindow PlatformWindowGetNativeWindow(PlatformWindow platform_window) {
+  return reinterpret_cast<NativeWindow>(static_cast<uintptr_t>(
+      static_cast<PlatformWindowXcb*>(platform_window)->window()));
+}
+
+void PlatformWindowShow(PlatformWindow window) {
+  static_cast<PlatformWindowXcb*>(window)->Show();
+}
+
+void PlatformWindowHide(PlatformWindow window) {
+  static_cast<PlatformWindowXcb*>(window)->Hide();
+}
+
+void PlatformWindowSetTitle(PlatformWindow window, const char* title) {
+  static_cast<PlatformWindowXcb*>(window)->SetTitle(title);
+}
+
+PlatformWindowSize PlatformWindowGetSize(PlatformWindow window) {
+  return static_cast<PlatformWindowXcb*>(window)->GetSize();
+}
+
+PlatformWindowVisibility PlatformWindowGetVisibility(PlatformWindow window) {
+  return static_cast<PlatformWindowXcb*>(window)->GetVisibility();
+}
+
+bool PlatformWindowSetPointerLock(PlatformWindow window,
+                                  PlatformWindowPointerLock lock) {
+  // Unsupported, as documented in the header.
+  return lock == kPlatformWindowPointerLockNone;
+}
+
+void PlatformWindowAckFrame(PlatformWindow window) {
+  // Windows do not advertise _NET_WM_SYNC_REQUEST, so the window manager never
+  // waits for an acknowledgement.
+}
+
+bool PlatformWindowWaitForNextFrame(PlatformWindow window) {
+  // Unsupported, as documented in frame_timing.h.
+  return false;
+}
+
+bool PlatformWindowGetFrameTiming(PlatformWindow window,
+                                  PlatformWindowFrameTiming* timing) {
+  return false;
+}
+
+PlatformWindowCoalescingStats PlatformWindowGetCoalescingStats(
+    PlatformWindow window) {
+  return static_cast<PlatformWindowXcb*>(window)->GetCoalescingStats();
+}
+
+void PlatformWindowGetStats(PlatformWindow window, PlatformWindowStats* stats) {
+  static_cast<PlatformWindowXcb*>(window)->GetStats(stats);
+}
+
+size_t PlatformWindowPollEvents(PlatformWindow window,
+                                PlatformWindowEvent* events, size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowXcb*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+size_t PlatformWindowPollTimedEvents(PlatformWindow window,
+                                     PlatformWindowTimedEvent* events,
+                                     size_t max_count) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowXcb*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Pop(events, max_count);
+}
+
+bool PlatformWindowWaitEvents(PlatformWindow window,
+                              int32_t timeout_in_milliseconds) {
+  platform_window::EventQueue* queue =
+      static_cast<PlatformWindowXcb*>(window)->dispatcher()->queue();
+  assert(queue);
+  return queue->Wait(std::chrono::milliseconds(timeout_in_milliseconds));
+}
+
+int PlatformWindowGetEventFd(PlatformWindow window) {
+  // Events are read by the connection's own thread, which
+  // kPlatformWindowFlagNoEventThread does not change.
+  return -1;
+}
+
+size_t PlatformWindowDispatchPending(PlatformWindow window) { return 0; }
+
+xcb_connection_t* PlatformWindowX11GetXcbConnection(PlatformWindow window) {
+  return XcbConnection::Get()->connection();
+}
+
+uint32_t PlatformWindowX11GetVisualId(PlatformWindow window) {
+  return XcbConnection::Get()->screen()->root_visual;
+}
+
+bool PlatformWindowStartRecording(PlatformWindow window, const char* path) {
+  std::unique_ptr<platform_window::EventRecorder> recorder =
+      platform_window::EventRecorder::Create(path);
+  if (!recorder) {
+    return false;
+  }
+  static_cast<PlatformWindowXcb*>(window)->dispatcher()->SetRecorder(
+      std::move(recorder));
+  return true;
+}
+
+void PlatformWindowStopRecording(PlatformWindow window) {
+  static_cast<PlatformWindowXcb*>(window)->dispatcher()->SetRecorder(nullptr);
+}
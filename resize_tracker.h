@@ -0,0 +1,90 @@
+#ifndef _PLATFORM_WINDOW_RESIZE_TRACKER_H_
+#define _PLATFORM_WINDOW_RESIZE_TRACKER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "platform_window/platform_window.h"
+
+namespace platform_window {
+
+// Turns a window's configure notifications into resize events, for platforms
+// that do not say when a resize starts or ends. On X11 an interactive resize
+// is just a stream of ConfigureNotify events from the window manager, so a
+// burst of size changes is considered over once the size has not changed for
+// kSettleTimeNs. The backend must call Settle() when that deadline passes,
+// whether or not another event has arrived by then.
+//
+// Also implements kPlatformWindowFlagThrottleResize, by holding back the
+// kPlatformWindowEventTypeResized events of a burst and reporting only the
+// final size once it settles.
+class ResizeTracker {
+ public:
+  // Comfortably longer than the steps of an interactive resize, which follow
+  // the pointer's motion.
+  static constexpr int64_t kSettleTimeNs = 100 * 1000 * 1000;
+
+  ResizeTracker(PlatformWindowSize size, bool throttle)
+      : size_(size), throttle_(throttle) {}
+
+  // Must only be called from one thread at a time. Records that the window's
+  // size is now |size|, appending the resulting events to |events|, with
+  // |sync_serial| going to the kPlatformWindowEventTypeResized event. Returns
+  // false if the size is unchanged, e.g. if the window was only moved or
+  // restacked.
+  bool OnConfigure(PlatformWindowSize size, uint64_t sync_serial,
+                   int64_t received_ns,
+                   std::vector<PlatformWindowTimedEvent>* events) {
+    Settle(received_ns, events);
+    if (size.width == size_.width && size.height == size_.height) {
+      return false;
+    }
+    if (!resizing_) {
+      Append(kPlatformWindowEventTypeResizeStarted, 0, received_ns, events);
+      resizing_ = true;
+    }
+    size_ = size;
+    if (!throttle_) {
+      Append(kPlatformWindowEventTypeResized, sync_serial, received_ns,
+             events);
+    }
+    deadline_ns_ = received_ns + kSettleTimeNs;
+    return true;
+  }
+
+  // Ends the resize in progress if it has settled by |now_ns|.
+  void Settle(int64_t now_ns, std::vector<PlatformWindowTimedEvent>* events) {
+    if (!resizing_ || now_ns < deadline_ns_) {
+      return;
+    }
+    resizing_ = false;
+    if (throttle_) {
+      Append(kPlatformWindowEventTypeResized, 0, now_ns, events);
+    }
+    Append(kPlatformWindowEventTypeResizeEnded, 0, now_ns, events);
+  }
+
+  // Whether a resize is in progress, in which case Settle() must be called at
+  // deadline_ns().
+  bool resizing() const { return resizing_; }
+  int64_t deadline_ns() const { return deadline_ns_; }
+
+ private:
+  void Append(PlatformWindowEventType type, uint64_t sync_serial,
+              int64_t received_ns,
+              std::vector<PlatformWindowTimedEvent>* events) const {
+    PlatformWindowEventData data;
+    data.resized = {size_, static_cast<uint32_t>(sync_serial),
+                    static_cast<uint32_t>(sync_serial >> 32)};
+    events->push_back({{type, data}, received_ns, received_ns});
+  }
+
+  PlatformWindowSize size_;
+  const bool throttle_;
+  bool resizing_ = false;
+  int64_t deadline_ns_ = 0;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_RESIZE_TRACKER_H_
@@ -0,0 +1,599 @@
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "pixel_conversion.h"
+#include "platform_window/software.h"
+#include "worker_pool.h"
+
+namespace {
+// Damage is tracked in tiles of this many pixels square.
+constexpr int32_t kTileSize = 64;
+// Below this many pixels, converting on one thread beats waking the pool.
+constexpr int64_t kParallelConversionPixels = 128 * 1024;
+
+// Attaching a segment fails asynchronously, with an X error, when the server
+// cannot reach our memory (e.g. it is remote, or in another IPC namespace).
+// Error handlers are process-wide, so errors on other displays are passed on
+// to whichever handler was installed before.
+class ScopedErrorTrap {
+ public:
+  explicit ScopedErrorTrap(Display* display) : lock_(mutex_) {
+    display_ = display;
+    error_ = false;
+    previous_handler_ = XSetErrorHandler(&ScopedErrorTrap::HandleError);
+  }
+  ~ScopedErrorTrap() {
+    XSetErrorHandler(previous_handler_);
+    display_ = nullptr;
+  }
+
+  // Waits for the server to process every request so far, and returns whether
+  // any of them failed.
+  bool Sync() {
+    XSync(display_, False);
+    return error_;
+  }
+
+ private:
+  static int HandleError(Display* display, XErrorEvent* error) {
+    if (display == display_) {
+      error_ = true;
+      return 0;
+    }
+    return previous_handler_ ? previous_handler_(display, error) : 0;
+  }
+
+  static std::mutex mutex_;
+  static Display* display_;
+  static bool error_;
+  static XErrorHandler previous_handler_;
+
+  std::lock_guard<std::mutex> lock_;
+};
+
+std::mutex ScopedErrorTrap::mutex_;
+Display* ScopedErrorTrap::display_ = nullptr;
+bool ScopedErrorTrap::error_ = false;
+XErrorHandler ScopedErrorTrap::previous_handler_ = nullptr;
+
+class SoftwareFramebuffer {
+ public:
+  // Returns null if the display could not be opened, or does not use
+  // 0x00RRGGBB pixels.
+  static std::unique_ptr<SoftwareFramebuffer> Create(PlatformWindow window,
+                                                     uint32_t flags);
+  ~SoftwareFramebuffer();
+
+  bool use_shared_memory() const { return use_shared_memory_; }
+
+  bool Acquire(PlatformWindowSoftwareBuffer* buffer);
+  void Present();
+  bool PresentImage(const PlatformWindowSoftwareImage& image,
+                    const PlatformWindowSoftwareRect* damage,
+                    size_t damage_count,
+                    PlatformWindowSoftwarePresentStats* stats);
+
+ private:
+  struct Buffer {
+    XImage* image = nullptr;
+    XShmSegmentInfo shm_info = {};
+    // Set from XShmPutImage() until the matching ShmCompletion event.
+    bool in_flight = false;
+    // One entry per tile, row by row, set for the tiles that do not hold the
+    // last image passed to PresentImage().
+    std::vector<uint8_t> stale_tiles;
+  };
+
+  // (Re)allocates the buffers if the window's size has changed.
+  bool EnsureBuffers();
+
+  SoftwareFramebuffer(PlatformWindow window, Display* display, Window window_id,
+                      Visual* visual, int depth, bool use_shared_memory);
+
+  bool AllocateBuffers(PlatformWindowSize size);
+  bool AllocateSharedBuffer(PlatformWindowSize size, Buffer* buffer);
+  bool AllocateUnsharedBuffer(PlatformWindowSize size, Buffer* buffer);
+  void FreeBuffers();
+
+  // Sets the tiles of |mask| that |rect| overlaps, after clipping it to the
+  // buffers.
+  void MarkTiles(const PlatformWindowSoftwareRect& rect,
+                 std::vector<uint8_t>* mask) const;
+  // Merges the set tiles of |mask| into rectangles in pixels, clipped to the
+  // buffers.
+  std::vector<PlatformWindowSoftwareRect> MergeTiles(
+      const std::vector<uint8_t>& mask) const;
+
+  // Reads events until the server is done reading |buffer|. This connection
+  // selects no events, so only ShmCompletion events arrive.
+  void WaitUntilIdle(Buffer* buffer);
+
+  PlatformWindow window_;
+  // A connection of our own, so that presenting does not contend with the
+  // backend's connections and completion events do not end up in its queue.
+  Display* display_;
+  Window window_id_;
+  Visual* visual_;
+  int depth_;
+  GC gc_;
+  bool use_shared_memory_;
+  int completion_event_type_ = 0;
+
+  PlatformWindowSize size_ = {0, 0};
+  int32_t tiles_x_ = 0;
+  int32_t tiles_y_ = 0;
+  Buffer buffers_[2];
+  int back_buffer_ = 0;
+  // Set when the window may not show the last image passed to PresentImage(),
+  // so the next one has to be uploaded in full.
+  bool window_stale_ = true;
+};
+
+// Converts |rect| of |image| into |destination|, and clears whatever part of
+// |rect| lies outside of |image|.
+void ConvertRect(const PlatformWindowSoftwareImage& image,
+                 platform_window::ConvertRowFunction convert,
+                 const PlatformWindowSoftwareRect& rect, XImage* destination) {
+  const size_t bytes_per_pixel = platform_window::BytesPerPixel(image.format);
+  const int32_t converted_width =
+      std::max(0, std::min(rect.width, image.width - rect.x));
+  for (int32_t y = rect.y; y < rect.y + rect.height; ++y) {
+    const ptrdiff_t row_offset =
+        static_cast<ptrdiff_t>(y) * destination->bytes_per_line;
+    uint32_t* row =
+        reinterpret_cast<uint32_t*>(destination->data + row_offset) + rect.x;
+    int32_t width = 0;
+    if (y < image.height && converted_width > 0) {
+      width = converted_width;
+      convert(static_cast<const uint8_t*>(image.pixels) +
+                  static_cast<ptrdiff_t>(y) * image.stride_in_bytes +
+                  rect.x * bytes_per_pixel,
+              row, width);
+    }
+    std::fill(row + width, row + rect.width, 0);
+  }
+}
+
+std::unique_ptr<SoftwareFramebuffer> SoftwareFramebuffer::Create(
+    PlatformWindow window, uint32_t flags) {
+  Display* display = XOpenDisplay(NULL);
+  if (!display) {
+    return nullptr;
+  }
+  Window window_id =
+      reinterpret_cast<Window>(PlatformWindowGetNativeWindow(window));
+  XWindowAttributes attributes;
+  if (!XGetWindowAttributes(display, window_id, &attributes) ||
+      (attributes.depth != 24 && attributes.depth != 32) ||
+      attributes.visual->red_mask != 0xff0000 ||
+      attributes.visual->green_mask != 0xff00 ||
+      attributes.visual->blue_mask != 0xff) {
+    XCloseDisplay(display);
+    return nullptr;
+  }
+
+  const bool use_shared_memory =
+      !(flags & kPlatformWindowSoftwareFramebufferFlagNoSharedMemory) &&
+      XShmQueryExtension(display);
+  return std::unique_ptr<SoftwareFramebuffer>(
+      new SoftwareFramebuffer(window, display, window_id, attributes.visual,
+                              attributes.depth, use_shared_memory));
+}
+
+SoftwareFramebuffer::SoftwareFramebuffer(PlatformWindow window,
+                                         Display* display, Window window_id,
+                                         Visual* visual, int depth,
+                                         bool use_shared_memory)
+    : window_(window),
+      display_(display),
+      window_id_(window_id),
+      visual_(visual),
+      depth_(depth),
+      use_shared_memory_(use_shared_memory) {
+  XGCValues gc_values;
+  gc_values.graphics_exposures = False;
+  gc_ = XCreateGC(display_, window_id_, GCGraphicsExposures, &gc_values);
+  if (use_shared_memory_) {
+    completion_event_type_ = XShmGetEventBase(display_) + ShmCompletion;
+  }
+}
+
+SoftwareFramebuffer::~SoftwareFramebuffer() {
+  FreeBuffers();
+  XFreeGC(display_, gc_);
+  XCloseDisplay(display_);
+}
+
+bool SoftwareFramebuffer::EnsureBuffers() {
+  // A minimized window may report a size of zero, which XCreateImage rejects.
+  PlatformWindowSize size = PlatformWindowGetSize(window_);
+  size.width = size.width > 0 ? size.width : 1;
+  size.height = size.height > 0 ? size.height : 1;
+  if (size.width != size_.width || size.height != size_.height ||
+      !buffers_[0].image) {
+    FreeBuffers();
+    if (!AllocateBuffers(size)) {
+      FreeBuffers();
+      return false;
+    }
+    size_ = size;
+  }
+  return true;
+}
+
+bool SoftwareFramebuffer::Acquire(PlatformWindowSoftwareBuffer* buffer) {
+  if (!EnsureBuffers()) {
+    return false;
+  }
+
+  Buffer* back_buffer = &buffers_[back_buffer_];
+  WaitUntilIdle(back_buffer);
+  XImage* image = back_buffer->image;
+  buffer->pixels = reinterpret_cast<uint32_t*>(image->data);
+  buffer->width = image->width;
+  buffer->height = image->height;
+  buffer->stride = image->bytes_per_line / sizeof(uint32_t);
+  return true;
+}
+
+void SoftwareFramebuffer::Present() {
+  Buffer* back_buffer = &buffers_[back_buffer_];
+  if (!back_buffer->image) {
+    return;
+  }
+  XImage* image = back_buffer->image;
+  if (use_shared_memory_) {
+    // The server reads the pixels straight out of the segment, and tells us
+    // when it is done with them.
+    XShmPutImage(display_, window_id_, gc_, image, 0, 0, 0, 0, image->width,
+                 image->height, True);
+    back_buffer->in_flight = true;
+  } else {
+    XPutImage(display_, window_id_, gc_, image, 0, 0, 0, 0, image->width,
+              image->height);
+  }
+  XFlush(display_);
+  back_buffer_ ^= 1;
+
+  // Whatever was drawn has nothing to do with the images.
+  window_stale_ = true;
+  for (Buffer& buffer : buffers_) {
+    std::fill(buffer.stale_tiles.begin(), buffer.stale_tiles.end(), 1);
+  }
+}
+
+bool SoftwareFramebuffer::PresentImage(
+    const PlatformWindowSoftwareImage& image,
+    const PlatformWindowSoftwareRect* damage, size_t damage_count,
+    PlatformWindowSoftwarePresentStats* stats) {
+  if (stats) {
+    *stats = {};
+  }
+  if (!EnsureBuffers()) {
+    return false;
+  }
+
+  std::vector<uint8_t> frame_tiles(tiles_x_ * tiles_y_, damage ? 0 : 1);
+  for (size_t i = 0; damage && i < damage_count; ++i) {
+    MarkTiles(damage[i], &frame_tiles);
+  }
+  const bool frame_damaged =
+      std::find(frame_tiles.begin(), frame_tiles.end(), 1) != frame_tiles.end();
+  if (!frame_damaged && !window_stale_) {
+    return true;
+  }
+
+  Buffer* back_buffer = &buffers_[back_buffer_];
+  WaitUntilIdle(back_buffer);
+
+  // Bring the back buffer up to date, which besides this frame's damage takes
+  // the previous frame's, that only went into the other buffer.
+  std::vector<uint8_t> convert_tiles = back_buffer->stale_tiles;
+  for (size_t i = 0; i < convert_tiles.size(); ++i) {
+    convert_tiles[i] |= frame_tiles[i];
+  }
+  // Split into bands of a tile's height, for the worker threads to take.
+  std::vector<PlatformWindowSoftwareRect> bands;
+  int64_t pixels_converted = 0;
+  for (const PlatformWindowSoftwareRect& rect : MergeTiles(convert_tiles)) {
+    for (int32_t y = rect.y; y < rect.y + rect.height; y += kTileSize) {
+      bands.push_back({rect.x, y, rect.width,
+                       std::min(kTileSize, rect.y + rect.height - y)});
+    }
+    pixels_converted += int64_t{rect.width} * rect.height;
+  }
+  const platform_window::ConvertRowFunction convert =
+      platform_window::GetConvertRowFunction(image.format);
+  auto convert_band = [&](size_t i) {
+    ConvertRect(image, convert, bands[i], back_buffer->image);
+  };
+  if (pixels_converted >= kParallelConversionPixels) {
+    platform_window::WorkerPool::GetShared()->ParallelFor(bands.size(),
+                                                          convert_band);
+  } else {
+    for (size_t i = 0; i < bands.size(); ++i) {
+      convert_band(i);
+    }
+  }
+
+  std::vector<PlatformWindowSoftwareRect> uploads;
+  if (window_stale_) {
+    uploads.push_back({0, 0, size_.width, size_.height});
+  } else {
+    uploads = MergeTiles(frame_tiles);
+  }
+  XImage* x_image = back_buffer->image;
+  int64_t pixels_uploaded = 0;
+  for (size_t i = 0; i < uploads.size(); ++i) {
+    const PlatformWindowSoftwareRect& rect = uploads[i];
+    if (use_shared_memory_) {
+      // Completions arrive in order, so one for the last request will do.
+      const bool send_event = i + 1 == uploads.size();
+      XShmPutImage(display_, window_id_, gc_, x_image, rect.x, rect.y, rect.x,
+                   rect.y, rect.width, rect.height, send_event);
+      back_buffer->in_flight = true;
+    } else {
+      XPutImage(display_, window_id_, gc_, x_image, rect.x, rect.y, rect.x,
+                rect.y, rect.width, rect.height);
+    }
+    pixels_uploaded += int64_t{rect.width} * rect.height;
+  }
+  XFlush(display_);
+
+  std::fill(back_buffer->stale_tiles.begin(), back_buffer->stale_tiles.end(),
+            0);
+  std::vector<uint8_t>& front_stale_tiles =
+      buffers_[back_buffer_ ^ 1].stale_tiles;
+  for (size_t i = 0; i < front_stale_tiles.size(); ++i) {
+    front_stale_tiles[i] |= frame_tiles[i];
+  }
+  back_buffer_ ^= 1;
+  window_stale_ = false;
+
+  if (stats) {
+    stats->bytes_uploaded = pixels_uploaded * sizeof(uint32_t);
+    stats->pixels_converted = pixels_converted;
+    stats->request_count = static_cast<uint32_t>(uploads.size());
+  }
+  return true;
+}
+
+void SoftwareFramebuffer::MarkTiles(const PlatformWindowSoftwareRect& rect,
+                                    std::vector<uint8_t>* mask) const {
+  const int32_t x0 = std::max(rect.x, 0);
+  const int32_t y0 = std::max(rect.y, 0);
+  const int32_t x1 = std::min<int64_t>(int64_t{rect.x} + rect.width,
+                                       size_.width);
+  const int32_t y1 = std::min<int64_t>(int64_t{rect.y} + rect.height,
+                                       size_.height);
+  if (x0 >= x1 || y0 >= y1) {
+    return;
+  }
+  for (int32_t tile_y = y0 / kTileSize; tile_y <= (y1 - 1) / kTileSize;
+       ++tile_y) {
+    for (int32_t tile_x = x0 / kTileSize; tile_x <= (x1 - 1) / kTileSize;
+         ++tile_x) {
+      (*mask)[tile_y * tiles_x_ + tile_x] = 1;
+    }
+  }
+}
+
+std::vector<PlatformWindowSoftwareRect> SoftwareFramebuffer::MergeTiles(
+    const std::vector<uint8_t>& mask) const {
+  // In tiles, runs of set tiles within a row, each of which grows downwards for
+  // as long as the row below has a run with the same ends.
+  std::vector<PlatformWindowSoftwareRect> rects;
+  // Indices into |rects| of the runs that reach the previous row.
+  std::vector<size_t> open;
+  std::vector<size_t> next_open;
+  for (int32_t tile_y = 0; tile_y < tiles_y_; ++tile_y) {
+    const uint8_t* row = mask.data() + tile_y * tiles_x_;
+    next_open.clear();
+    for (int32_t x = 0; x < tiles_x_;) {
+      if (!row[x]) {
+        ++x;
+        continue;
+      }
+      const int32_t begin = x;
+      while (x < tiles_x_ && row[x]) {
+        ++x;
+      }
+      auto above = std::find_if(open.begin(), open.end(), [&](size_t i) {
+        return rects[i].x == begin && rects[i].width == x - begin;
+      });
+      if (above != open.end()) {
+        ++rects[*above].height;
+        next_open.push_back(*above);
+      } else {
+        next_open.push_back(rects.size());
+        rects.push_back({begin, tile_y, x - begin, 1});
+      }
+    }
+    open.swap(next_open);
+  }
+
+  // The tiles along the right and bottom edges may be partial.
+  for (PlatformWindowSoftwareRect& rect : rects) {
+    rect.x *= kTileSize;
+    rect.y *= kTileSize;
+    rect.width = std::min(rect.width * kTileSize, size_.width - rect.x);
+    rect.height = std::min(rect.height * kTileSize, size_.height - rect.y);
+  }
+  return rects;
+}
+
+bool SoftwareFramebuffer::AllocateBuffers(PlatformWindowSize size) {
+  for (Buffer& buffer : buffers_) {
+    if (use_shared_memory_ && !AllocateSharedBuffer(size, &buffer)) {
+      // Fall back for good, and redo any buffer that did get shared memory.
+      FreeBuffers();
+      use_shared_memory_ = false;
+      return AllocateBuffers(size);
+    }
+    if (!use_shared_memory_ && !AllocateUnsharedBuffer(size, &buffer)) {
+      return false;
+    }
+  }
+  back_buffer_ = 0;
+  tiles_x_ = (size.width + kTileSize - 1) / kTileSize;
+  tiles_y_ = (size.height + kTileSize - 1) / kTileSize;
+  for (Buffer& buffer : buffers_) {
+    buffer.stale_tiles.assign(tiles_x_ * tiles_y_, 1);
+  }
+  window_stale_ = true;
+  return true;
+}
+
+bool SoftwareFramebuffer::AllocateSharedBuffer(PlatformWindowSize size,
+                                               Buffer* buffer) {
+  XImage* image = XShmCreateImage(display_, visual_, depth_, ZPixmap, nullptr,
+                                  &buffer->shm_info, size.width, size.height);
+  if (!image) {
+    return false;
+  }
+  if (image->bits_per_pixel != 32) {
+    XDestroyImage(image);
+    return false;
+  }
+  buffer->shm_info.shmid = shmget(
+      IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+  if (buffer->shm_info.shmid < 0) {
+    XDestroyImage(image);
+    return false;
+  }
+  void* address = shmat(buffer->shm_info.shmid, nullptr, 0);
+  if (address == reinterpret_cast<void*>(-1)) {
+    shmctl(buffer->shm_info.shmid, IPC_RMID, nullptr);
+    XDestroyImage(image);
+    return false;
+  }
+  buffer->shm_info.shmaddr = image->data = static_cast<char*>(address);
+  buffer->shm_info.readOnly = False;
+
+  bool attached;
+  {
+    ScopedErrorTrap error_trap(display_);
+    attached = XShmAttach(display_, &buffer->shm_info) && !error_trap.Sync();
+  }
+  // The segment now only lives for as long as someone has it attached, so it
+  // cannot leak even if we crash.
+  shmctl(buffer->shm_info.shmid, IPC_RMID, nullptr);
+  if (!attached) {
+    shmdt(buffer->shm_info.shmaddr);
+    XDestroyImage(image);
+    buffer->shm_info = {};
+    return false;
+  }
+  buffer->image = image;
+  return true;
+}
+
+bool SoftwareFramebuffer::AllocateUnsharedBuffer(PlatformWindowSize size,
+                                                 Buffer* buffer) {
+  const int bytes_per_line = size.width * sizeof(uint32_t);
+  char* data = static_cast<char*>(std::malloc(bytes_per_line * size.height));
+  if (!data) {
+    return false;
+  }
+  // XDestroyImage() frees |data|.
+  XImage* image = XCreateImage(display_, visual_, depth_, ZPixmap, 0, data,
+                               size.width, size.height, 32, bytes_per_line);
+  if (!image) {
+    std::free(data);
+    return false;
+  }
+  if (image->bits_per_pixel != 32) {
+    XDestroyImage(image);
+    return false;
+  }
+  buffer->image = image;
+  return true;
+}
+
+void SoftwareFramebuffer::FreeBuffers() {
+  for (Buffer& buffer : buffers_) {
+    if (!buffer.image) {
+      continue;
+    }
+    WaitUntilIdle(&buffer);
+    if (buffer.shm_info.shmaddr) {
+      XShmDetach(display_, &buffer.shm_info);
+      // Only frees the XImage itself, not the segment.
+      XDestroyImage(buffer.image);
+      shmdt(buffer.shm_info.shmaddr);
+    } else {
+      XDestroyImage(buffer.image);
+    }
+    buffer = Buffer();
+  }
+  XFlush(display_);
+}
+
+void SoftwareFramebuffer::WaitUntilIdle(Buffer* buffer) {
+  while (buffer->in_flight) {
+    XEvent event;
+    XNextEvent(display_, &event);
+    if (event.type != completion_event_type_) {
+      continue;
+    }
+    // Completions arrive in order, so this also covers earlier presents of
+    // the other buffer.
+    const XShmCompletionEvent* completion =
+        reinterpret_cast<const XShmCompletionEvent*>(&event);
+    for (Buffer& other : buffers_) {
+      if (other.shm_info.shmseg == completion->shmseg) {
+        other.in_flight = false;
+      }
+    }
+  }
+}
+
+SoftwareFramebuffer* FromHandle(PlatformWindowSoftwareFramebuffer handle) {
+  return reinterpret_cast<SoftwareFramebuffer*>(handle);
+}
+}  // namespace
+
+PlatformWindowSoftwareFramebuffer PlatformWindowSoftwareCreateFramebuffer(
+    PlatformWindow window, uint32_t flags) {
+  return reinterpret_cast<PlatformWindowSoftwareFramebuffer>(
+      SoftwareFramebuffer::Create(window, flags).release());
+}
+
+void PlatformWindowSoftwareDestroyFramebuffer(
+    PlatformWindowSoftwareFramebuffer framebuffer) {
+  delete FromHandle(framebuffer);
+}
+
+bool PlatformWindowSoftwareIsSharedMemory(
+    PlatformWindowSoftwareFramebuffer framebuffer) {
+  return FromHandle(framebuffer)->use_shared_memory();
+}
+
+bool PlatformWindowSoftwareAcquireBuffer(
+    PlatformWindowSoftwareFramebuffer framebuffer,
+    PlatformWindowSoftwareBuffer* buffer) {
+  return FromHandle(framebuffer)->Acquire(buffer);
+}
+
+void PlatformWindowSoftwarePresent(
+    PlatformWindowSoftwareFramebuffer framebuffer) {
+  FromHandle(framebuffer)->Present();
+}
+
+bool PlatformWindowSoftwarePresentImage(
+    PlatformWindowSoftwareFramebuffer framebuffer,
+    const PlatformWindowSoftwareImage* image,
+    const PlatformWindowSoftwareRect* damage, size_t damage_count,
+    PlatformWindowSoftwarePresentStats* stats) {
+  return FromHandle(framebuffer)->PresentImage(*image, damage, damage_count,
+                                               stats);
+}
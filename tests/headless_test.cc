@@ -0,0 +1,52 @@
+// Checks the state that the headless backend tracks for its windows. Needs no
+// display.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "platform_window/headless.h"
+#include "platform_window/platform_window.h"
+
+namespace {
+int failures = 0;
+
+#define EXPECT_EQ(expected, actual)                                   \
+  do {                                                                \
+    if ((expected) != (actual)) {                                     \
+      std::fprintf(stderr, "%s:%d: expected %s == %s\n", __FILE__,    \
+                   __LINE__, #expected, #actual);                     \
+      ++failures;                                                     \
+    }                                                                 \
+  } while (false)
+
+void IgnoreEvent(void*, PlatformWindowEvent) {}
+
+void TestVisibilityFollowsShowAndHide() {
+  PlatformWindow window = PlatformWindowMakeWindow(
+      "headless_test", kPlatformWindowFlagsNone, &IgnoreEvent, nullptr);
+  EXPECT_EQ(kPlatformWindowVisibilityUnmapped,
+            PlatformWindowGetVisibility(window));
+
+  PlatformWindowShow(window);
+  EXPECT_EQ(kPlatformWindowVisibilityVisible,
+            PlatformWindowGetVisibility(window));
+  EXPECT_EQ(true, PlatformWindowHeadlessIsVisible(window));
+
+  PlatformWindowHide(window);
+  EXPECT_EQ(kPlatformWindowVisibilityUnmapped,
+            PlatformWindowGetVisibility(window));
+  EXPECT_EQ(false, PlatformWindowHeadlessIsVisible(window));
+
+  PlatformWindowDestroyWindow(window);
+}
+}  // namespace
+
+int main() {
+  TestVisibilityFollowsShowAndHide();
+  if (failures != 0) {
+    std::fprintf(stderr, "%d expectation(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("PASS\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+// Records events delivered by a headless window, replays the recording and
+// checks that every event comes back as it was delivered, including from a
+// recording that was cut off in the middle of a batch. Needs no display.
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "platform_window/headless.h"
+#include "platform_window/platform_window.h"
+#include "platform_window/recording.h"
+
+namespace {
+int failures = 0;
+
+#define EXPECT_EQ(expected, actual)                                   \
+  do {                                                                \
+    if ((expected) != (actual)) {                                     \
+      std::fprintf(stderr, "%s:%d: expected %s == %s\n", __FILE__,    \
+                   __LINE__, #expected, #actual);                     \
+      ++failures;                                                     \
+    }                                                                 \
+  } while (false)
+
+typedef std::vector<PlatformWindowTimedEvent> Batch;
+
+// Collects the batches that a window or a replay delivers.
+struct BatchLog {
+  std::mutex mutex;
+  std::condition_variable batch_added;
+  std::vector<Batch> batches;
+};
+
+void LogBatch(void* context, const PlatformWindowTimedEvent* events,
+              size_t count) {
+  BatchLog* log = static_cast<BatchLog*>(context);
+  std::lock_guard<std::mutex> lock(log->mutex);
+  log->batches.emplace_back(events, events + count);
+  log->batch_added.notify_all();
+}
+
+void WaitForBatches(BatchLog* log, size_t count) {
+  std::unique_lock<std::mutex> lock(log->mutex);
+  log->batch_added.wait(lock,
+                        [&] { return log->batches.size() >= count; });
+}
+
+std::string TempPath(const char* name) {
+  const char* dir = std::getenv("TEST_TMPDIR");
+  if (dir == nullptr) dir = std::getenv("TMPDIR");
+  if (dir == nullptr) dir = "/tmp";
+  return std::string(dir) + "/" + name;
+}
+
+PlatformWindowEvent MouseMove(int32_t x, int32_t y) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeMouseMove, {}};
+  event.data.mouse_move.x = x;
+  event.data.mouse_move.y = y;
+  event.data.mouse_move.precise_x = x + 0.25f;
+  event.data.mouse_move.precise_y = y - 0.5f;
+  return event;
+}
+
+PlatformWindowEvent MouseButton(bool pressed) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeMouseButton, {}};
+  event.data.mouse_button.button = kPlatformWindowMouseRight;
+  event.data.mouse_button.pressed = pressed;
+  event.data.mouse_button.x = 17;
+  event.data.mouse_button.y = -3;
+  return event;
+}
+
+PlatformWindowEvent MouseWheel(float angle_in_degrees) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeMouseWheel, {}};
+  event.data.mouse_wheel.angle_in_degrees = angle_in_degrees;
+  event.data.mouse_wheel.x = 640;
+  event.data.mouse_wheel.y = 480;
+  return event;
+}
+
+PlatformWindowEvent Key(bool pressed) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeKey, {}};
+  event.data.key.pressed = pressed;
+  event.data.key.key = kPlatformWindowKeyEscape;
+  event.data.key.scancode = 9;
+  return event;
+}
+
+PlatformWindowEvent Resized(int32_t width, int32_t height) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeResized, {}};
+  event.data.resized.size = {width, height};
+  return event;
+}
+
+PlatformWindowEvent Moved(int32_t x, int32_t y) {
+  PlatformWindowEvent event = {kPlatformWindowEventTypeMoved, {}};
+  event.data.moved = {x, y};
+  return event;
+}
+
+PlatformWindowEvent QuitRequest() {
+  return {kPlatformWindowEventTypeQuitRequest, {}};
+}
+
+// Compares the fields that |expected|'s type defines, so that bytes which no
+// field covers (padding, the rest of the union) are free to differ.
+void ExpectSameEvent(const PlatformWindowTimedEvent& expected,
+                     const PlatformWindowTimedEvent& actual) {
+  const PlatformWindowEventData& a = expected.event.data;
+  const PlatformWindowEventData& b = actual.event.data;
+  EXPECT_EQ(expected.event.type, actual.event.type);
+  // Replay moves events to the time they are replayed at, but keeps how long
+  // each of them took to be received.
+  EXPECT_EQ(expected.received_ns - expected.timestamp_ns,
+            actual.received_ns - actual.timestamp_ns);
+  switch (expected.event.type) {
+    case kPlatformWindowEventTypeResized:
+      EXPECT_EQ(a.resized.size.width, b.resized.size.width);
+      EXPECT_EQ(a.resized.size.height, b.resized.size.height);
+      EXPECT_EQ(a.resized.sync_serial_low, b.resized.sync_serial_low);
+      EXPECT_EQ(a.resized.sync_serial_high, b.resized.sync_serial_high);
+      break;
+    case kPlatformWindowEventTypeMouseMove:
+      EXPECT_EQ(a.mouse_move.x, b.mouse_move.x);
+      EXPECT_EQ(a.mouse_move.y, b.mouse_move.y);
+      EXPECT_EQ(a.mouse_move.precise_x, b.mouse_move.precise_x);
+      EXPECT_EQ(a.mouse_move.precise_y, b.mouse_move.precise_y);
+      break;
+    case kPlatformWindowEventTypeMouseButton:
+      EXPECT_EQ(a.mouse_button.button, b.mouse_button.button);
+      EXPECT_EQ(a.mouse_button.pressed, b.mouse_button.pressed);
+      EXPECT_EQ(a.mouse_button.x, b.mouse_button.x);
+      EXPECT_EQ(a.mouse_button.y, b.mouse_button.y);
+      break;
+    case kPlatformWindowEventTypeMouseWheel:
+      EXPECT_EQ(a.mouse_wheel.angle_in_degrees,
+                b.mouse_wheel.angle_in_degrees);
+      EXPECT_EQ(a.mouse_wheel.x, b.mouse_wheel.x);
+      EXPECT_EQ(a.mouse_wheel.y, b.mouse_wheel.y);
+      break;
+    case kPlatformWindowEventTypeKey:
+      EXPECT_EQ(a.key.pressed, b.key.pressed);
+      EXPECT_EQ(a.key.key, b.key.key);
+      EXPECT_EQ(a.key.scancode, b.key.scancode);
+      break;
+    case kPlatformWindowEventTypeMoved:
+      EXPECT_EQ(a.moved.x, b.moved.x);
+      EXPECT_EQ(a.moved.y, b.moved.y);
+      break;
+    default:
+      break;
+  }
+}
+
+void ExpectSameBatches(const std::vector<Batch>& expected,
+                       const std::vector<Batch>& actual) {
+  EXPECT_EQ(expected.size(), actual.size());
+  for (size_t i = 0; i < expected.size() && i < actual.size(); ++i) {
+    EXPECT_EQ(expected[i].size(), actual[i].size());
+    for (size_t j = 0; j < expected[i].size() && j < actual[i].size(); ++j) {
+      ExpectSameEvent(expected[i][j], actual[i][j]);
+    }
+  }
+}
+
+// Records two batches of mixed events into |path| and returns them as the
+// window delivered them.
+std::vector<Batch> RecordMixedBatches(const std::string& path) {
+  BatchLog delivered;
+  PlatformWindow window = PlatformWindowMakeWindowWithTimedBatchCallback(
+      "recording_test", kPlatformWindowFlagsNone, &LogBatch, &delivered);
+  EXPECT_EQ(true, PlatformWindowStartRecording(window, path.c_str()));
+
+  const PlatformWindowEvent first[] = {
+      MouseMove(10, 20), MouseButton(true), MouseMove(-5, 7),
+      MouseButton(false), Key(true), MouseWheel(-15.0f),
+      Resized(800, 600), Moved(32, 48), Key(false),
+  };
+  PlatformWindowHeadlessInjectEvents(window, first, std::size(first));
+  // Wait for each batch to be delivered so that the two are not merged.
+  WaitForBatches(&delivered, 1);
+  const PlatformWindowEvent second[] = {
+      MouseWheel(30.0f), Resized(1024, 768), QuitRequest(),
+  };
+  PlatformWindowHeadlessInjectEvents(window, second, std::size(second));
+  WaitForBatches(&delivered, 2);
+
+  PlatformWindowStopRecording(window);
+  PlatformWindowDestroyWindow(window);
+
+  std::lock_guard<std::mutex> lock(delivered.mutex);
+  EXPECT_EQ(size_t{2}, delivered.batches.size());
+  EXPECT_EQ(std::size(first), delivered.batches[0].size());
+  EXPECT_EQ(std::size(second), delivered.batches[1].size());
+  return delivered.batches;
+}
+
+void TestReplayMatchesDeliveredEvents() {
+  const std::string path = TempPath("recording_test.pwrec");
+  const std::vector<Batch> delivered = RecordMixedBatches(path);
+
+  BatchLog replayed;
+  PlatformWindowReplayResult result =
+      PlatformWindowReplayRecording(path.c_str(), 0.0, &LogBatch, &replayed);
+  EXPECT_EQ(true, result.success);
+  EXPECT_EQ(uint64_t{2}, result.batches_replayed);
+  EXPECT_EQ(static_cast<uint64_t>(delivered[0].size() + delivered[1].size()),
+            result.events_replayed);
+  ExpectSameBatches(delivered, replayed.batches);
+
+  std::remove(path.c_str());
+}
+
+void TestTruncatedRecordingReplaysCompleteBatches() {
+  const std::string path = TempPath("recording_test_full.pwrec");
+  const std::vector<Batch> delivered = RecordMixedBatches(path);
+
+  // Cut the file inside the last batch, as if the process had died while
+  // writing it.
+  std::string contents;
+  {
+    std::ifstream file(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+  }
+  const std::string truncated_path = TempPath("recording_test_cut.pwrec");
+  {
+    std::ofstream file(truncated_path, std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), contents.size() - 3);
+  }
+
+  BatchLog replayed;
+  PlatformWindowReplayResult result = PlatformWindowReplayRecording(
+      truncated_path.c_str(), 0.0, &LogBatch, &replayed);
+  EXPECT_EQ(true, result.success);
+  EXPECT_EQ(uint64_t{1}, result.batches_replayed);
+  EXPECT_EQ(static_cast<uint64_t>(delivered[0].size()), result.events_replayed);
+  ExpectSameBatches({delivered[0]}, replayed.batches);
+
+  std::remove(path.c_str());
+  std::remove(truncated_path.c_str());
+}
+}  // namespace
+
+int main() {
+  TestReplayMatchesDeliveredEvents();
+  TestTruncatedRecordingReplaysCompleteBatches();
+  if (failures != 0) {
+    std::fprintf(stderr, "%d expectation(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  std::printf("PASS\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,513 @@
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "platform_window/vulkan.h"
+#include "platform_window/vulkan_swapchain.h"
+
+namespace {
+// Chooses the present mode for |flags| out of those the surface supports.
+VkPresentModeKHR ChoosePresentMode(
+    uint32_t flags, const std::vector<VkPresentModeKHR>& supported) {
+  if (flags & kPlatformWindowVulkanSwapchainFlagFifo) {
+    return VK_PRESENT_MODE_FIFO_KHR;
+  }
+  // MAILBOX never tears and shows the newest frame at the next vblank;
+  // IMMEDIATE shows it right away, at the cost of tearing. FIFO is the only
+  // mode that every implementation has to support.
+  for (VkPresentModeKHR mode :
+       {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR}) {
+    if (std::find(supported.begin(), supported.end(), mode) !=
+        supported.end()) {
+      return mode;
+    }
+  }
+  return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+VkSurfaceFormatKHR ChooseSurfaceFormat(
+    VkFormat requested, const std::vector<VkSurfaceFormatKHR>& supported) {
+  if (requested == VK_FORMAT_UNDEFINED) {
+    requested = VK_FORMAT_B8G8R8A8_UNORM;
+  }
+  for (const VkSurfaceFormatKHR& format : supported) {
+    if (format.format == requested) {
+      return format;
+    }
+  }
+  // A single VK_FORMAT_UNDEFINED entry means that any format will do.
+  if (supported.empty() || supported[0].format == VK_FORMAT_UNDEFINED) {
+    return {requested, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+  }
+  return supported[0];
+}
+
+class Swapchain {
+ public:
+  static VkResult Create(const PlatformWindowVulkanSwapchainCreateInfo& info,
+                         std::unique_ptr<Swapchain>* swapchain);
+  ~Swapchain();
+
+  VkResult Acquire(PlatformWindowVulkanFrame* frame);
+  VkResult Present();
+
+ private:
+  // The resources of one of the frames in flight.
+  struct FrameResources {
+    VkSemaphore image_available = VK_NULL_HANDLE;
+    VkFence in_flight = VK_NULL_HANDLE;
+  };
+
+  struct Image {
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    // Per image rather than per frame, since it is only known to be unused
+    // once the image has been acquired again.
+    VkSemaphore render_finished = VK_NULL_HANDLE;
+    // The fence of the frame that last rendered to the image, if any.
+    VkFence last_fence = VK_NULL_HANDLE;
+  };
+
+  // A swapchain that has been replaced, but whose images may still be in use
+  // by the frames that were in flight when it was.
+  struct RetiredSwapchain {
+    VkSwapchainKHR swapchain;
+    std::vector<Image> images;
+    // Frames numbered below this may have used it.
+    uint64_t end_frame_number;
+  };
+
+  Swapchain(const PlatformWindowVulkanSwapchainCreateInfo& info,
+            VkSurfaceKHR surface);
+
+  VkResult Initialize();
+
+  // Replaces |swapchain_| with one for a window of |window_size|. Returns
+  // VK_NOT_READY if the surface has no area.
+  VkResult Recreate(PlatformWindowSize window_size);
+  VkResult CreateImages();
+
+  // Moves |swapchain_| and its images to |retired_|.
+  void Retire();
+  // Destroys the retired swapchains that no frame in flight can be using.
+  void DestroyRetired();
+  void DestroyImages(const std::vector<Image>& images);
+
+  const VkInstance instance_;
+  const VkPhysicalDevice physical_device_;
+  const VkDevice device_;
+  const VkQueue present_queue_;
+  const PlatformWindow window_;
+  const uint32_t flags_;
+  const VkImageUsageFlags image_usage_;
+  const VkFormat requested_format_;
+  const VkSurfaceKHR surface_;
+
+  // Chosen once, since they do not depend on the size of the surface.
+  VkSurfaceFormatKHR surface_format_ = {};
+  VkPresentModeKHR present_mode_ = VK_PRESENT_MODE_FIFO_KHR;
+
+  std::vector<FrameResources> frames_;
+
+  VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
+  VkExtent2D extent_ = {0, 0};
+  std::vector<Image> images_;
+  // The window size that |swapchain_| was created for.
+  PlatformWindowSize window_size_ = {0, 0};
+  // Set when the swapchain has to be recreated even at the same window size,
+  // and initially since there is no swapchain yet.
+  bool out_of_date_ = true;
+  // Reported with, and cleared by, the next frame.
+  bool recreated_ = false;
+
+  std::vector<RetiredSwapchain> retired_;
+
+  // Counts the frames presented so far. Frame n uses frames_[n % size].
+  uint64_t frame_number_ = 0;
+  uint32_t image_index_ = 0;
+};
+
+VkResult Swapchain::Create(const PlatformWindowVulkanSwapchainCreateInfo& info,
+                           std::unique_ptr<Swapchain>* swapchain) {
+  VkSurfaceKHR surface;
+  VkResult result =
+      PlatformWindowVulkanCreateSurface(info.instance, info.window, &surface);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  std::unique_ptr<Swapchain> new_swapchain(new Swapchain(info, surface));
+  result = new_swapchain->Initialize();
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  *swapchain = std::move(new_swapchain);
+  return VK_SUCCESS;
+}
+
+Swapchain::Swapchain(const PlatformWindowVulkanSwapchainCreateInfo& info,
+                     VkSurfaceKHR surface)
+    : instance_(info.instance),
+      physical_device_(info.physical_device),
+      device_(info.device),
+      present_queue_(info.present_queue),
+      window_(info.window),
+      flags_(info.flags),
+      image_usage_(info.image_usage ? info.image_usage
+                                    : static_cast<VkImageUsageFlags>(
+                                          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT)),
+      requested_format_(info.format),
+      surface_(surface),
+      frames_(info.frames_in_flight ? info.frames_in_flight : 2) {}
+
+Swapchain::~Swapchain() {
+  // Unlike resizing, this is rare enough not to bother tracking what exactly
+  // is still in use.
+  vkDeviceWaitIdle(device_);
+  for (const RetiredSwapchain& retired : retired_) {
+    DestroyImages(retired.images);
+    vkDestroySwapchainKHR(device_, retired.swapchain, nullptr);
+  }
+  DestroyImages(images_);
+  if (swapchain_ != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+  }
+  for (const FrameResources& frame : frames_) {
+    vkDestroySemaphore(device_, frame.image_available, nullptr);
+    vkDestroyFence(device_, frame.in_flight, nullptr);
+  }
+  vkDestroySurfaceKHR(instance_, surface_, nullptr);
+}
+
+VkResult Swapchain::Initialize() {
+  uint32_t count = 0;
+  VkResult result = vkGetPhysicalDeviceSurfaceFormatsKHR(
+      physical_device_, surface_, &count, nullptr);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  std::vector<VkSurfaceFormatKHR> formats(count);
+  result = vkGetPhysicalDeviceSurfaceFormatsKHR(physical_device_, surface_,
+                                                &count, formats.data());
+  if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+    return result;
+  }
+  formats.resize(count);
+  surface_format_ = ChooseSurfaceFormat(requested_format_, formats);
+
+  count = 0;
+  result = vkGetPhysicalDeviceSurfacePresentModesKHR(physical_device_,
+                                                     surface_, &count, nullptr);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  std::vector<VkPresentModeKHR> present_modes(count);
+  result = vkGetPhysicalDeviceSurfacePresentModesKHR(
+      physical_device_, surface_, &count, present_modes.data());
+  if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+    return result;
+  }
+  present_modes.resize(count);
+  present_mode_ = ChoosePresentMode(flags_, present_modes);
+
+  VkSemaphoreCreateInfo semaphore_info{};
+  semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  VkFenceCreateInfo fence_info{};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  // So that waiting for each frame's previous use passes the first time.
+  fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  for (FrameResources& frame : frames_) {
+    result = vkCreateSemaphore(device_, &semaphore_info, nullptr,
+                               &frame.image_available);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    result = vkCreateFence(device_, &fence_info, nullptr, &frame.in_flight);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+VkResult Swapchain::Acquire(PlatformWindowVulkanFrame* frame) {
+  const uint32_t frame_in_flight_index =
+      static_cast<uint32_t>(frame_number_ % frames_.size());
+  FrameResources& resources = frames_[frame_in_flight_index];
+  VkResult result = vkWaitForFences(device_, 1, &resources.in_flight, VK_TRUE,
+                                    UINT64_MAX);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  DestroyRetired();
+
+  // The size that the event thread last saw, which costs no round trip.
+  const PlatformWindowSize window_size = PlatformWindowGetSize(window_);
+  if (window_size.width <= 0 || window_size.height <= 0) {
+    return VK_NOT_READY;
+  }
+  if (out_of_date_ || window_size.width != window_size_.width ||
+      window_size.height != window_size_.height) {
+    result = Recreate(window_size);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+  }
+
+  result = vkAcquireNextImageKHR(device_, swapchain_, UINT64_MAX,
+                                 resources.image_available, VK_NULL_HANDLE,
+                                 &image_index_);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    // The window changed size after it was last reported. Only retry once, the
+    // next resize event will catch up with anything later.
+    result = Recreate(window_size);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+    result = vkAcquireNextImageKHR(device_, swapchain_, UINT64_MAX,
+                                   resources.image_available, VK_NULL_HANDLE,
+                                   &image_index_);
+  }
+  if (result == VK_SUBOPTIMAL_KHR) {
+    // Still presentable, so recreate it for the next frame instead.
+    out_of_date_ = true;
+    result = VK_SUCCESS;
+  }
+  if (result != VK_SUCCESS) {
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+      out_of_date_ = true;
+    }
+    return result;
+  }
+
+  Image& image = images_[image_index_];
+  // With more images than frames in flight, the image may have been rendered
+  // to by a frame that used other resources, and which is still in flight.
+  if (image.last_fence != VK_NULL_HANDLE &&
+      image.last_fence != resources.in_flight) {
+    result = vkWaitForFences(device_, 1, &image.last_fence, VK_TRUE,
+                             UINT64_MAX);
+    if (result != VK_SUCCESS) {
+      return result;
+    }
+  }
+  image.last_fence = resources.in_flight;
+  // Only now that the application is certain to submit something that
+  // signals it again.
+  result = vkResetFences(device_, 1, &resources.in_flight);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  frame->image = image.image;
+  frame->image_view = image.view;
+  frame->image_index = image_index_;
+  frame->format = surface_format_.format;
+  frame->extent = extent_;
+  frame->frame_in_flight_index = frame_in_flight_index;
+  frame->recreated = recreated_;
+  frame->image_available = resources.image_available;
+  frame->render_finished = image.render_finished;
+  frame->in_flight_fence = resources.in_flight;
+  recreated_ = false;
+  return VK_SUCCESS;
+}
+
+VkResult Swapchain::Present() {
+  VkPresentInfoKHR present_info{};
+  present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  present_info.waitSemaphoreCount = 1;
+  present_info.pWaitSemaphores = &images_[image_index_].render_finished;
+  present_info.swapchainCount = 1;
+  present_info.pSwapchains = &swapchain_;
+  present_info.pImageIndices = &image_index_;
+  VkResult result = vkQueuePresentKHR(present_queue_, &present_info);
+  ++frame_number_;
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+    out_of_date_ = true;
+    return VK_SUCCESS;
+  }
+  return result;
+}
+
+VkResult Swapchain::Recreate(PlatformWindowSize window_size) {
+  VkSurfaceCapabilitiesKHR capabilities;
+  VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+      physical_device_, surface_, &capabilities);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  VkExtent2D extent = capabilities.currentExtent;
+  if (extent.width == UINT32_MAX) {
+    // The surface takes the size of the swapchain, e.g. on Wayland.
+    extent.width = std::clamp(static_cast<uint32_t>(window_size.width),
+                              capabilities.minImageExtent.width,
+                              capabilities.maxImageExtent.width);
+    extent.height = std::clamp(static_cast<uint32_t>(window_size.height),
+                               capabilities.minImageExtent.height,
+                               capabilities.maxImageExtent.height);
+  }
+  if (extent.width == 0 || extent.height == 0) {
+    return VK_NOT_READY;
+  }
+
+  // One more image than the minimum, so that acquiring does not have to wait
+  // for the presentation engine to release one.
+  uint32_t image_count = capabilities.minImageCount + 1;
+  if (capabilities.maxImageCount != 0) {
+    image_count = std::min(image_count, capabilities.maxImageCount);
+  }
+  VkCompositeAlphaFlagBitsKHR composite_alpha =
+      VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+  for (VkCompositeAlphaFlagBitsKHR bit :
+       {VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR, VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+        VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR,
+        VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR}) {
+    if (capabilities.supportedCompositeAlpha & bit) {
+      composite_alpha = bit;
+      break;
+    }
+  }
+
+  VkSwapchainCreateInfoKHR create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+  create_info.surface = surface_;
+  create_info.minImageCount = image_count;
+  create_info.imageFormat = surface_format_.format;
+  create_info.imageColorSpace = surface_format_.colorSpace;
+  create_info.imageExtent = extent;
+  create_info.imageArrayLayers = 1;
+  create_info.imageUsage = image_usage_;
+  create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  create_info.preTransform = capabilities.currentTransform;
+  create_info.compositeAlpha = composite_alpha;
+  create_info.presentMode = present_mode_;
+  create_info.clipped = VK_TRUE;
+  // Lets the driver hand the old swapchain's resources over, and retires it
+  // whether or not creating the new one succeeds.
+  create_info.oldSwapchain = swapchain_;
+  VkSwapchainKHR new_swapchain;
+  result = vkCreateSwapchainKHR(device_, &create_info, nullptr, &new_swapchain);
+  Retire();
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  swapchain_ = new_swapchain;
+  extent_ = extent;
+  window_size_ = window_size;
+  out_of_date_ = false;
+  recreated_ = true;
+  return CreateImages();
+}
+
+VkResult Swapchain::CreateImages() {
+  uint32_t count = 0;
+  VkResult result =
+      vkGetSwapchainImagesKHR(device_, swapchain_, &count, nullptr);
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+  std::vector<VkImage> images(count);
+  result = vkGetSwapchainImagesKHR(device_, swapchain_, &count, images.data());
+  if (result != VK_SUCCESS) {
+    return result;
+  }
+
+  images_.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    images_[i].image = images[i];
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = images[i];
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = surface_format_.format;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.layerCount = 1;
+    result = vkCreateImageView(device_, &view_info, nullptr, &images_[i].view);
+    if (result != VK_SUCCESS) {
+      // Have the next frame start over.
+      out_of_date_ = true;
+      return result;
+    }
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    result = vkCreateSemaphore(device_, &semaphore_info, nullptr,
+                               &images_[i].render_finished);
+    if (result != VK_SUCCESS) {
+      out_of_date_ = true;
+      return result;
+    }
+  }
+  return VK_SUCCESS;
+}
+
+void Swapchain::Retire() {
+  if (swapchain_ == VK_NULL_HANDLE) {
+    return;
+  }
+  retired_.push_back({swapchain_, std::move(images_), frame_number_});
+  swapchain_ = VK_NULL_HANDLE;
+  images_.clear();
+}
+
+void Swapchain::DestroyRetired() {
+  // Frame n is known to have completed once frame n + frames_.size() has
+  // waited for its fence, which the current frame has just done for the frame
+  // frames_.size() before it.
+  auto is_unused = [this](const RetiredSwapchain& retired) {
+    return frame_number_ + 1 >= retired.end_frame_number + frames_.size();
+  };
+  for (const RetiredSwapchain& retired : retired_) {
+    if (is_unused(retired)) {
+      DestroyImages(retired.images);
+      vkDestroySwapchainKHR(device_, retired.swapchain, nullptr);
+    }
+  }
+  retired_.erase(std::remove_if(retired_.begin(), retired_.end(), is_unused),
+                 retired_.end());
+}
+
+void Swapchain::DestroyImages(const std::vector<Image>& images) {
+  // The images themselves belong to the swapchain.
+  for (const Image& image : images) {
+    vkDestroyImageView(device_, image.view, nullptr);
+    vkDestroySemaphore(device_, image.render_finished, nullptr);
+  }
+}
+
+Swapchain* FromHandle(PlatformWindowVulkanSwapchain handle) {
+  return reinterpret_cast<Swapchain*>(handle);
+}
+}  // namespace
+
+VkResult PlatformWindowVulkanCreateSwapchain(
+    const PlatformWindowVulkanSwapchainCreateInfo* info,
+    PlatformWindowVulkanSwapchain* swapchain) {
+  std::unique_ptr<Swapchain> new_swapchain;
+  VkResult result = Swapchain::Create(*info, &new_swapchain);
+  if (result == VK_SUCCESS) {
+    *swapchain = reinterpret_cast<PlatformWindowVulkanSwapchain>(
+        new_swapchain.release());
+  }
+  return result;
+}
+
+void PlatformWindowVulkanDestroySwapchain(
+    PlatformWindowVulkanSwapchain swapchain) {
+  delete FromHandle(swapchain);
+}
+
+VkResult PlatformWindowVulkanAcquireFrame(
+    PlatformWindowVulkanSwapchain swapchain, PlatformWindowVulkanFrame* frame) {
+  return FromHandle(swapchain)->Acquire(frame);
+}
+
+VkResult PlatformWindowVulkanPresent(PlatformWindowVulkanSwapchain swapchain) {
+  return FromHandle(swapchain)->Present();
+}
@@ -0,0 +1,46 @@
+#define VK_USE_PLATFORM_WAYLAND_KHR
+#define VK_PROTOTYPES
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+#include "platform_window/vulkan.h"
+#include "platform_window/wayland.h"
+
+namespace {
+const std::vector<const char*>* GetRequiredInstanceExtensions() {
+  static std::vector<const char*> extensions = {
+      VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME,
+      "VK_KHR_surface",
+  };
+  return &extensions;
+}
+}  // namespace
+
+size_t PlatformWindowVulkanGetRequiredInstanceExtensionsCount() {
+  return GetRequiredInstanceExtensions()->size();
+}
+
+const char** PlatformWindowVulkanGetRequiredInstanceExtensions() {
+  return const_cast<const char**>(GetRequiredInstanceExtensions()->data());
+}
+
+VkResult PlatformWindowVulkanCreateSurface(VkInstance vk_instance,
+                                           PlatformWindow window,
+                                           VkSurfaceKHR* surface) {
+  VkWaylandSurfaceCreateInfoKHR create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR;
+  create_info.display = PlatformWindowWaylandGetDisplay();
+  create_info.surface =
+      static_cast<wl_surface*>(PlatformWindowGetNativeWindow(window));
+
+  return vkCreateWaylandSurfaceKHR(vk_instance, &create_info, nullptr,
+                                   surface);
+}
+
+VkBool32 PlatformWindowVulkanGetPresentationSupport(
+    VkPhysicalDevice physical_device, uint32_t queue_family_index,
+    PlatformWindow window) {
+  return vkGetPhysicalDeviceWaylandPresentationSupportKHR(
+      physical_device, queue_family_index, PlatformWindowWaylandGetDisplay());
+}
@@ -36,3 +36,10 @@ VkResult PlatformWindowVulkanCreateSurface(VkInstance vk_instance,
 
   return vkCreateWin32SurfaceKHR(vk_instance, &create_info, nullptr, surface);
 }
+
+VkBool32 PlatformWindowVulkanGetPresentationSupport(
+    VkPhysicalDevice physical_device, uint32_t queue_family_index,
+    PlatformWindow window) {
+  return vkGetPhysicalDeviceWin32PresentationSupportKHR(physical_device,
+                                                        queue_family_index);
+}
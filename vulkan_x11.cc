@@ -1,37 +1,162 @@
+#define VK_USE_PLATFORM_XCB_KHR
 #define VK_USE_PLATFORM_XLIB_KHR
 #define VK_PROTOTYPES
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
 #include <vector>
 
 #include "platform_window/vulkan.h"
+#include "platform_window/x11.h"
+
+// Serves both X11 backends. Surfaces are created with VK_KHR_xcb_surface on
+// the window's own connection, so creating one costs no connection setup and
+// leaves nothing behind when it is destroyed. Loaders without it get
+// VK_KHR_xlib_surface, on one Display opened for the purpose: the Xlib
+// backend's Displays belong to their event threads, and Xlib is not
+// thread-safe.
 
 namespace {
-const std::vector<const char*>* GetRequiredInstanceExtensions() {
-  static std::vector<const char*> extensions = {
-      VK_KHR_XLIB_SURFACE_EXTENSION_NAME,
-      "VK_KHR_surface",
-  };
+struct InstanceExtensions {
+  bool use_xcb;
+  std::vector<const char*> names;
+};
+
+// Chosen once, so that surfaces are created with the extension that the
+// application enabled on its instance.
+const InstanceExtensions* GetInstanceExtensions() {
+  static const InstanceExtensions extensions = [] {
+    std::vector<VkExtensionProperties> available;
+    uint32_t count = 0;
+    if (vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr) ==
+        VK_SUCCESS) {
+      available.resize(count);
+      // VK_INCOMPLETE if extensions appeared in between, which is fine.
+      vkEnumerateInstanceExtensionProperties(nullptr, &count,
+                                             available.data());
+      available.resize(count);
+    }
+    auto is_available = [&available](const char* name) {
+      return std::any_of(available.begin(), available.end(),
+                         [name](const VkExtensionProperties& properties) {
+                           return std::strcmp(properties.extensionName,
+                                              name) == 0;
+                         });
+    };
+
+    // If the loader has neither, ask for XCB and let instance creation fail
+    // with VK_ERROR_EXTENSION_NOT_PRESENT.
+    InstanceExtensions extensions;
+    extensions.use_xcb = is_available(VK_KHR_XCB_SURFACE_EXTENSION_NAME) ||
+                         !is_available(VK_KHR_XLIB_SURFACE_EXTENSION_NAME);
+    extensions.names = {
+        extensions.use_xcb ? VK_KHR_XCB_SURFACE_EXTENSION_NAME
+                           : VK_KHR_XLIB_SURFACE_EXTENSION_NAME,
+        VK_KHR_SURFACE_EXTENSION_NAME,
+    };
+    return extensions;
+  }();
   return &extensions;
 }
+
+// Only used without VK_KHR_xcb_surface. Intentionally leaked, since surfaces
+// and swapchains may outlive every window.
+Display* GetXlibDisplay() {
+  static Display* display = XOpenDisplay(NULL);
+  return display;
+}
+
+// The answer to a presentation support query. Every window of the process is
+// on the same X server, so the answer only depends on the device, the queue
+// family and the visual.
+struct PresentationSupport {
+  VkPhysicalDevice physical_device;
+  uint32_t queue_family_index;
+  uint32_t visual_id;
+  VkBool32 supported;
+};
+
+class PresentationSupportCache {
+ public:
+  VkBool32 Get(VkPhysicalDevice physical_device, uint32_t queue_family_index,
+               PlatformWindow window);
+
+ private:
+  std::mutex mutex_;
+  // A handful of entries at most, one per device and queue family.
+  std::vector<PresentationSupport> entries_;
+};
+
+VkBool32 PresentationSupportCache::Get(VkPhysicalDevice physical_device,
+                                       uint32_t queue_family_index,
+                                       PlatformWindow window) {
+  const uint32_t visual_id = PlatformWindowX11GetVisualId(window);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const PresentationSupport& entry : entries_) {
+    if (entry.physical_device == physical_device &&
+        entry.queue_family_index == queue_family_index &&
+        entry.visual_id == visual_id) {
+      return entry.supported;
+    }
+  }
+
+  VkBool32 supported;
+  if (GetInstanceExtensions()->use_xcb) {
+    supported = vkGetPhysicalDeviceXcbPresentationSupportKHR(
+        physical_device, queue_family_index,
+        PlatformWindowX11GetXcbConnection(window), visual_id);
+  } else {
+    Display* display = GetXlibDisplay();
+    if (!display) {
+      return VK_FALSE;
+    }
+    supported = vkGetPhysicalDeviceXlibPresentationSupportKHR(
+        physical_device, queue_family_index, display, visual_id);
+  }
+  entries_.push_back(
+      {physical_device, queue_family_index, visual_id, supported});
+  return supported;
+}
 }  // namespace
 
 size_t PlatformWindowVulkanGetRequiredInstanceExtensionsCount() {
-  return GetRequiredInstanceExtensions()->size();
+  return GetInstanceExtensions()->names.size();
 }
 
 const char** PlatformWindowVulkanGetRequiredInstanceExtensions() {
-  return const_cast<const char**>(GetRequiredInstanceExtensions()->data());
+  return const_cast<const char**>(GetInstanceExtensions()->names.data());
 }
 
 VkResult PlatformWindowVulkanCreateSurface(VkInstance vk_instance,
                                            PlatformWindow window,
                                            VkSurfaceKHR* surface) {
-  VkXlibSurfaceCreateInfoKHR create_info{};
-  create_info.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
-  create_info.dpy = XOpenDisplay(NULL);
-  create_info.window =
+  const Window window_id =
       reinterpret_cast<Window>(PlatformWindowGetNativeWindow(window));
 
+  if (GetInstanceExtensions()->use_xcb) {
+    VkXcbSurfaceCreateInfoKHR create_info{};
+    create_info.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+    create_info.connection = PlatformWindowX11GetXcbConnection(window);
+    create_info.window = static_cast<xcb_window_t>(window_id);
+    return vkCreateXcbSurfaceKHR(vk_instance, &create_info, nullptr, surface);
+  }
+
+  VkXlibSurfaceCreateInfoKHR create_info{};
+  create_info.sType = VK_STRUCTURE_TYPE_XLIB_SURFACE_CREATE_INFO_KHR;
+  create_info.dpy = GetXlibDisplay();
+  create_info.window = window_id;
+  if (!create_info.dpy) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
   return vkCreateXlibSurfaceKHR(vk_instance, &create_info, nullptr, surface);
 }
+
+VkBool32 PlatformWindowVulkanGetPresentationSupport(
+    VkPhysicalDevice physical_device, uint32_t queue_family_index,
+    PlatformWindow window) {
+  // Intentionally leaked, it lives for the lifetime of the process.
+  static PresentationSupportCache* cache = new PresentationSupportCache();
+  return cache->Get(physical_device, queue_family_index, window);
+}
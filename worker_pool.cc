@@ -0,0 +1,89 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace platform_window {
+
+WorkerPool::WorkerPool(size_t thread_count) {
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this] { WorkerMain(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+WorkerPool* WorkerPool::GetShared() {
+  // Intentionally leaked, it lives for the lifetime of the process.
+  static WorkerPool* pool = new WorkerPool(std::min<size_t>(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1, 7));
+  return pool;
+}
+
+void WorkerPool::ParallelFor(size_t count,
+                             const std::function<void(size_t)>& function) {
+  if (threads_.empty() || count <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      function(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> call_lock(call_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    function_ = &function;
+    count_ = count;
+    next_item_.store(0, std::memory_order_relaxed);
+    busy_workers_ = threads_.size();
+    ++generation_;
+  }
+  work_available_.notify_all();
+
+  RunItems();
+
+  // Workers may still be finishing the items they took.
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return busy_workers_ == 0; });
+  function_ = nullptr;
+}
+
+void WorkerPool::RunItems() {
+  for (size_t i = next_item_.fetch_add(1, std::memory_order_relaxed);
+       i < count_; i = next_item_.fetch_add(1, std::memory_order_relaxed)) {
+    (*function_)(i);
+  }
+}
+
+void WorkerPool::WorkerMain() {
+  uint64_t last_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    work_available_.wait(lock, [this, last_generation] {
+      return shutdown_ || generation_ != last_generation;
+    });
+    if (shutdown_) {
+      return;
+    }
+    last_generation = generation_;
+
+    lock.unlock();
+    RunItems();
+    lock.lock();
+
+    if (--busy_workers_ == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+}  // namespace platform_window
@@ -0,0 +1,63 @@
+#ifndef _PLATFORM_WINDOW_WORKER_POOL_H_
+#define _PLATFORM_WINDOW_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace platform_window {
+
+// A fixed set of threads for splitting CPU-bound work, such as converting a
+// large frame, into independent items. The calling thread works on items
+// too, so a pool without threads simply runs everything inline.
+class WorkerPool {
+ public:
+  explicit WorkerPool(size_t thread_count);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  // A pool with one thread fewer than the machine has cores, up to 7, which
+  // is created on first use and lives for the lifetime of the process.
+  static WorkerPool* GetShared();
+
+  size_t thread_count() const { return threads_.size(); }
+
+  // Calls |function| once for every index in [0, |count|), spread across the
+  // pool and the calling thread, and returns once all calls have. Callers
+  // on different threads take turns.
+  void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+
+ private:
+  void WorkerMain();
+  // Runs items of the current ParallelFor() until there are none left.
+  void RunItems();
+
+  // Serializes ParallelFor() calls.
+  std::mutex call_mutex_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // Bumped by each ParallelFor(), which is how workers tell new work apart.
+  uint64_t generation_ = 0;
+  size_t busy_workers_ = 0;
+  bool shutdown_ = false;
+
+  // Set up by ParallelFor() before bumping |generation_|.
+  const std::function<void(size_t)>* function_ = nullptr;
+  size_t count_ = 0;
+  std::atomic<size_t> next_item_ = 0;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_WORKER_POOL_H_
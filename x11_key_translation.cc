@@ -0,0 +1,65 @@
+#include "x11_key_translation.h"
+
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#include <vector>
+
+namespace platform_window {
+
+// Get a PlatformWindowKey from an XKeyEvent.
+PlatformWindowKey XKeyEventToPlatformWindowKey(XKeyEvent* event) {
+  // XLookupKeysym does not take into consideration the state of the
+  // lock/shift etc. keys. So it is necessary to use XLookupString instead.
+  KeySym keysym = XK_VoidSymbol;
+  XLookupString(event, NULL, 0, &keysym, NULL);
+  PlatformWindowKey key = KeysymToPlatformWindowKey(keysym);
+  if (key == kPlatformWindowKeyUnknown) {
+    keysym = HardwareKeycodeToDefaultXKeysym(event->keycode);
+    key = KeysymToPlatformWindowKey(keysym);
+  }
+
+  return key;
+}
+
+std::unique_ptr<KeycodeTable> MakeKeycodeTable(Display* display) {
+  int min_keycode = 0;
+  int max_keycode = 0;
+  XDisplayKeycodes(display, &min_keycode, &max_keycode);
+  int keysyms_per_keycode = 0;
+  KeySym* keysyms =
+      XGetKeyboardMapping(display, static_cast<KeyCode>(min_keycode),
+                          max_keycode - min_keycode + 1, &keysyms_per_keycode);
+  if (!keysyms) {
+    // An empty table sends every key down the XLookupString path.
+    return std::make_unique<KeycodeTable>(0, -1, 0, nullptr);
+  }
+
+  // Xlib widens keysyms to longs; the table takes them as on the wire.
+  std::vector<uint32_t> wire_keysyms(
+      keysyms, keysyms + (max_keycode - min_keycode + 1) * keysyms_per_keycode);
+  XFree(keysyms);
+  return std::make_unique<KeycodeTable>(min_keycode, max_keycode,
+                                        keysyms_per_keycode,
+                                        wire_keysyms.data());
+}
+
+const KeycodeTable* GetSharedKeycodeTable(Display* display) {
+  const KeycodeTable* table = GetSharedKeycodeTable();
+  if (table) {
+    return table;
+  }
+  return InstallSharedKeycodeTable(MakeKeycodeTable(display),
+                                   /*replace=*/false);
+}
+
+void OnKeyboardMappingChanged(Display* display, XMappingEvent* event) {
+  XRefreshKeyboardMapping(event);
+  if (event->request != MappingKeyboard) {
+    return;
+  }
+
+  InstallSharedKeycodeTable(MakeKeycodeTable(display), /*replace=*/true);
+}
+
+}  // namespace platform_window
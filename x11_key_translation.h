@@ -0,0 +1,44 @@
+#ifndef _PLATFORM_WINDOW_X11_KEY_TRANSLATION_H_
+#define _PLATFORM_WINDOW_X11_KEY_TRANSLATION_H_
+
+#include <X11/Xlib.h>
+
+#include <memory>
+
+#include "platform_window/platform_window_key.h"
+#include "x11_keycode_table.h"
+
+// Xlib specific key translation, on top of the shared x11_keycode_table.h.
+
+namespace platform_window {
+
+// Translates |event| through XLookupString, so that the current modifier
+// state is taken into account. This is the slow path that KeycodeTable avoids
+// for the majority of keys.
+PlatformWindowKey XKeyEventToPlatformWindowKey(XKeyEvent* event);
+
+// Builds a table from |display|'s current keyboard mapping.
+std::unique_ptr<KeycodeTable> MakeKeycodeTable(Display* display);
+
+// Translates a key event, falling back to XLookupString only if needed.
+inline PlatformWindowKey TranslateKeyEvent(const KeycodeTable& table,
+                                           XKeyEvent* event) {
+  PlatformWindowKey key;
+  if (table.Lookup(static_cast<uint8_t>(event->keycode), &key)) {
+    return key;
+  }
+  return XKeyEventToPlatformWindowKey(event);
+}
+
+// Returns the shared table for the current keyboard mapping, building it from
+// |display| on first use.
+const KeycodeTable* GetSharedKeycodeTable(Display* display);
+
+// To be called by an event thread that received a MappingNotify on
+// |display|. Refreshes Xlib's own mapping cache and rebuilds the shared
+// table.
+void OnKeyboardMappingChanged(Display* display, XMappingEvent* event);
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_X11_KEY_TRANSLATION_H_
@@ -0,0 +1,518 @@
+#include "x11_keycode_table.h"
+
+#include <X11/keysym.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace platform_window {
+
+// Key translation code adopted from
+// https://github.com/youtube/cobalt/blob/master/src/starboard/shared/x11/application_x11.cc.
+
+uint32_t HardwareKeycodeToDefaultXKeysym(uint32_t hardware_code) {
+  static const uint32_t kHardwareKeycodeMap[] = {
+      0,                // 0x00:
+      0,                // 0x01:
+      0,                // 0x02:
+      0,                // 0x03:
+      0,                // 0x04:
+      0,                // 0x05:
+      0,                // 0x06:
+      0,                // 0x07:
+      0,                // 0x08:
+      XK_Escape,        // 0x09: XK_Escape
+      XK_1,             // 0x0A: XK_1
+      XK_2,             // 0x0B: XK_2
+      XK_3,             // 0x0C: XK_3
+      XK_4,             // 0x0D: XK_4
+      XK_5,             // 0x0E: XK_5
+      XK_6,             // 0x0F: XK_6
+      XK_7,             // 0x10: XK_7
+      XK_8,             // 0x11: XK_8
+      XK_9,             // 0x12: XK_9
+      XK_0,             // 0x13: XK_0
+      XK_minus,         // 0x14: XK_minus
+      XK_equal,         // 0x15: XK_equal
+      XK_BackSpace,     // 0x16: XK_BackSpace
+      XK_Tab,           // 0x17: XK_Tab
+      XK_q,             // 0x18: XK_q
+      XK_w,             // 0x19: XK_w
+      XK_e,             // 0x1A: XK_e
+      XK_r,             // 0x1B: XK_r
+      XK_t,             // 0x1C: XK_t
+      XK_y,             // 0x1D: XK_y
+      XK_u,             // 0x1E: XK_u
+      XK_i,             // 0x1F: XK_i
+      XK_o,             // 0x20: XK_o
+      XK_p,             // 0x21: XK_p
+      XK_bracketleft,   // 0x22: XK_bracketleft
+      XK_bracketright,  // 0x23: XK_bracketright
+      XK_Return,        // 0x24: XK_Return
+      XK_Control_L,     // 0x25: XK_Control_L
+      XK_a,             // 0x26: XK_a
+      XK_s,             // 0x27: XK_s
+      XK_d,             // 0x28: XK_d
+      XK_f,             // 0x29: XK_f
+      XK_g,             // 0x2A: XK_g
+      XK_h,             // 0x2B: XK_h
+      XK_j,             // 0x2C: XK_j
+      XK_k,             // 0x2D: XK_k
+      XK_l,             // 0x2E: XK_l
+      XK_semicolon,     // 0x2F: XK_semicolon
+      XK_apostrophe,    // 0x30: XK_apostrophe
+      XK_grave,         // 0x31: XK_grave
+      XK_Shift_L,       // 0x32: XK_Shift_L
+      XK_backslash,     // 0x33: XK_backslash
+      XK_z,             // 0x34: XK_z
+      XK_x,             // 0x35: XK_x
+      XK_c,             // 0x36: XK_c
+      XK_v,             // 0x37: XK_v
+      XK_b,             // 0x38: XK_b
+      XK_n,             // 0x39: XK_n
+      XK_m,             // 0x3A: XK_m
+      XK_comma,         // 0x3B: XK_comma
+      XK_period,        // 0x3C: XK_period
+      XK_slash,         // 0x3D: XK_slash
+      XK_Shift_R,       // 0x3E: XK_Shift_R
+      0,                // 0x3F: XK_KP_Multiply
+      XK_Alt_L,         // 0x40: XK_Alt_L
+      XK_space,         // 0x41: XK_space
+      XK_Caps_Lock,     // 0x42: XK_Caps_Lock
+      XK_F1,            // 0x43: XK_F1
+      XK_F2,            // 0x44: XK_F2
+      XK_F3,            // 0x45: XK_F3
+      XK_F4,            // 0x46: XK_F4
+      XK_F5,            // 0x47: XK_F5
+      XK_F6,            // 0x48: XK_F6
+      XK_F7,            // 0x49: XK_F7
+      XK_F8,            // 0x4A: XK_F8
+      XK_F9,            // 0x4B: XK_F9
+      XK_F10,           // 0x4C: XK_F10
+      XK_Num_Lock,      // 0x4D: XK_Num_Lock
+      XK_Scroll_Lock,   // 0x4E: XK_Scroll_Lock
+  };
+
+  return hardware_code <
+                 sizeof(kHardwareKeycodeMap) / sizeof(kHardwareKeycodeMap[0])
+             ? kHardwareKeycodeMap[hardware_code]
+             : 0;
+}
+
+PlatformWindowKey KeysymToPlatformWindowKey(KeySym keysym) {
+  switch (keysym) {
+    case XK_BackSpace:
+      return kPlatformWindowKeyBackspace;
+    case XK_Delete:
+    case XK_KP_Delete:
+      return kPlatformWindowKeyDelete;
+    case XK_Tab:
+    case XK_KP_Tab:
+    case XK_ISO_Left_Tab:
+      return kPlatformWindowKeyTab;
+    case XK_Linefeed:
+    case XK_Return:
+    case XK_KP_Enter:
+    case XK_ISO_Enter:
+      return kPlatformWindowKeyReturn;
+    case XK_Clear:
+    case XK_KP_Begin:
+      return kPlatformWindowKeyClear;
+    case XK_KP_Space:
+    case XK_space:
+      return kPlatformWindowKeySpace;
+    case XK_Home:
+    case XK_KP_Home:
+      return kPlatformWindowKeyHome;
+    case XK_End:
+    case XK_KP_End:
+      return kPlatformWindowKeyEnd;
+    case XK_Page_Up:
+    case XK_KP_Page_Up:  // aka XK_KP_Prior
+      return kPlatformWindowKeyPrior;
+    case XK_Page_Down:
+    case XK_KP_Page_Down:  // aka XK_KP_Next
+      return kPlatformWindowKeyNext;
+    case XK_Left:
+    case XK_KP_Left:
+      return kPlatformWindowKeyLeft;
+    case XK_Right:
+    case XK_KP_Right:
+      return kPlatformWindowKeyRight;
+    case XK_Down:
+    case XK_KP_Down:
+      return kPlatformWindowKeyDown;
+    case XK_Up:
+    case XK_KP_Up:
+      return kPlatformWindowKeyUp;
+    case XK_Escape:
+      return kPlatformWindowKeyEscape;
+    case XK_Kana_Lock:
+    case XK_Kana_Shift:
+      return kPlatformWindowKeyKana;
+    case XK_Hangul:
+      return kPlatformWindowKeyHangul;
+    case XK_Hangul_Hanja:
+      return kPlatformWindowKeyHanja;
+    case XK_Kanji:
+      return kPlatformWindowKeyKanji;
+    case XK_Henkan:
+      return kPlatformWindowKeyConvert;
+    case XK_Muhenkan:
+      return kPlatformWindowKeyNonconvert;
+    case XK_Zenkaku_Hankaku:
+      return kPlatformWindowKeyDbeDbcschar;
+    case XK_A:
+    case XK_a:
+      return kPlatformWindowKeyA;
+    case XK_B:
+    case XK_b:
+      return kPlatformWindowKeyB;
+    case XK_C:
+    case XK_c:
+      return kPlatformWindowKeyC;
+    case XK_D:
+    case XK_d:
+      return kPlatformWindowKeyD;
+    case XK_E:
+    case XK_e:
+      return kPlatformWindowKeyE;
+    case XK_F:
+    case XK_f:
+      return kPlatformWindowKeyF;
+    case XK_G:
+    case XK_g:
+      return kPlatformWindowKeyG;
+    case XK_H:
+    case XK_h:
+      return kPlatformWindowKeyH;
+    case XK_I:
+    case XK_i:
+      return kPlatformWindowKeyI;
+    case XK_J:
+    case XK_j:
+      return kPlatformWindowKeyJ;
+    case XK_K:
+    case XK_k:
+      return kPlatformWindowKeyK;
+    case XK_L:
+    case XK_l:
+      return kPlatformWindowKeyL;
+    case XK_M:
+    case XK_m:
+      return kPlatformWindowKeyM;
+    case XK_N:
+    case XK_n:
+      return kPlatformWindowKeyN;
+    case XK_O:
+    case XK_o:
+      return kPlatformWindowKeyO;
+    case XK_P:
+    case XK_p:
+      return kPlatformWindowKeyP;
+    case XK_Q:
+    case XK_q:
+      return kPlatformWindowKeyQ;
+    case XK_R:
+    case XK_r:
+      return kPlatformWindowKeyR;
+    case XK_S:
+    case XK_s:
+      return kPlatformWindowKeyS;
+    case XK_T:
+    case XK_t:
+      return kPlatformWindowKeyT;
+    case XK_U:
+    case XK_u:
+      return kPlatformWindowKeyU;
+    case XK_V:
+    case XK_v:
+      return kPlatformWindowKeyV;
+    case XK_W:
+    case XK_w:
+      return kPlatformWindowKeyW;
+    case XK_X:
+    case XK_x:
+      return kPlatformWindowKeyX;
+    case XK_Y:
+    case XK_y:
+      return kPlatformWindowKeyY;
+    case XK_Z:
+    case XK_z:
+      return kPlatformWindowKeyZ;
+
+    case XK_0:
+    case XK_1:
+    case XK_2:
+    case XK_3:
+    case XK_4:
+    case XK_5:
+    case XK_6:
+    case XK_7:
+    case XK_8:
+    case XK_9:
+      return static_cast<PlatformWindowKey>(kPlatformWindowKey0 +
+                                            (keysym - XK_0));
+
+    case XK_parenright:
+      return kPlatformWindowKey0;
+    case XK_exclam:
+      return kPlatformWindowKey1;
+    case XK_at:
+      return kPlatformWindowKey2;
+    case XK_numbersign:
+      return kPlatformWindowKey3;
+    case XK_dollar:
+      return kPlatformWindowKey4;
+    case XK_percent:
+      return kPlatformWindowKey5;
+    case XK_asciicircum:
+      return kPlatformWindowKey6;
+    case XK_ampersand:
+      return kPlatformWindowKey7;
+    case XK_asterisk:
+      return kPlatformWindowKey8;
+    case XK_parenleft:
+      return kPlatformWindowKey9;
+
+    case XK_KP_0:
+    case XK_KP_1:
+    case XK_KP_2:
+    case XK_KP_3:
+    case XK_KP_4:
+    case XK_KP_5:
+    case XK_KP_6:
+    case XK_KP_7:
+    case XK_KP_8:
+    case XK_KP_9:
+      return static_cast<PlatformWindowKey>(kPlatformWindowKeyNumpad0 +
+                                            (keysym - XK_KP_0));
+
+    case XK_multiply:
+    case XK_KP_Multiply:
+      return kPlatformWindowKeyMultiply;
+    case XK_KP_Add:
+      return kPlatformWindowKeyAdd;
+    case XK_KP_Separator:
+      return kPlatformWindowKeySeparator;
+    case XK_KP_Subtract:
+      return kPlatformWindowKeySubtract;
+    case XK_KP_Decimal:
+      return kPlatformWindowKeyDecimal;
+    case XK_KP_Divide:
+      return kPlatformWindowKeyDivide;
+    case XK_KP_Equal:
+    case XK_equal:
+    case XK_plus:
+      return kPlatformWindowKeyOemPlus;
+    case XK_comma:
+    case XK_less:
+      return kPlatformWindowKeyOemComma;
+    case XK_minus:
+    case XK_underscore:
+      return kPlatformWindowKeyOemMinus;
+    case XK_greater:
+    case XK_period:
+      return kPlatformWindowKeyOemPeriod;
+    case XK_colon:
+    case XK_semicolon:
+      return kPlatformWindowKeyOem1;
+    case XK_question:
+    case XK_slash:
+      return kPlatformWindowKeyOem2;
+    case XK_asciitilde:
+    case XK_quoteleft:
+      return kPlatformWindowKeyOem3;
+    case XK_bracketleft:
+    case XK_braceleft:
+      return kPlatformWindowKeyOem4;
+    case XK_backslash:
+    case XK_bar:
+      return kPlatformWindowKeyOem5;
+    case XK_bracketright:
+    case XK_braceright:
+      return kPlatformWindowKeyOem6;
+    case XK_quoteright:
+    case XK_quotedbl:
+      return kPlatformWindowKeyOem7;
+    case XK_Shift_L:
+    case XK_Shift_R:
+      return kPlatformWindowKeyShift;
+    case XK_Control_L:
+    case XK_Control_R:
+      return kPlatformWindowKeyControl;
+    case XK_Meta_L:
+    case XK_Meta_R:
+    case XK_Alt_L:
+    case XK_Alt_R:
+      return kPlatformWindowKeyMenu;
+    case XK_Pause:
+      return kPlatformWindowKeyPause;
+    case XK_Caps_Lock:
+      return kPlatformWindowKeyCapital;
+    case XK_Num_Lock:
+      return kPlatformWindowKeyNumlock;
+    case XK_Scroll_Lock:
+      return kPlatformWindowKeyScroll;
+    case XK_Select:
+      return kPlatformWindowKeySelect;
+    case XK_Print:
+      return kPlatformWindowKeyPrint;
+    case XK_Execute:
+      return kPlatformWindowKeyExecute;
+    case XK_Insert:
+    case XK_KP_Insert:
+      return kPlatformWindowKeyInsert;
+    case XK_Help:
+      return kPlatformWindowKeyHelp;
+    case XK_Super_L:
+      return kPlatformWindowKeyLwin;
+    case XK_Super_R:
+      return kPlatformWindowKeyRwin;
+    case XK_Menu:
+      return kPlatformWindowKeyApps;
+    case XK_F1:
+    case XK_F2:
+    case XK_F3:
+    case XK_F4:
+    case XK_F5:
+    case XK_F6:
+    case XK_F7:
+    case XK_F8:
+    case XK_F9:
+    case XK_F10:
+    case XK_F11:
+    case XK_F12:
+    case XK_F13:
+    case XK_F14:
+    case XK_F15:
+    case XK_F16:
+    case XK_F17:
+    case XK_F18:
+    case XK_F19:
+    case XK_F20:
+    case XK_F21:
+    case XK_F22:
+    case XK_F23:
+    case XK_F24:
+      return static_cast<PlatformWindowKey>(kPlatformWindowKeyF1 +
+                                            (keysym - XK_F1));
+    case XK_KP_F1:
+    case XK_KP_F2:
+    case XK_KP_F3:
+    case XK_KP_F4:
+      return static_cast<PlatformWindowKey>(kPlatformWindowKeyF1 +
+                                            (keysym - XK_KP_F1));
+  }
+  return kPlatformWindowKeyUnknown;
+}
+
+KeycodeTable::KeycodeTable(int min_keycode, int max_keycode,
+                           int keysyms_per_keycode, const uint32_t* keysyms) {
+  keys_.fill(kNeedsLookup);
+  levels_.fill({NoSymbol, NoSymbol});
+
+  for (int keycode = min_keycode; keycode <= max_keycode; ++keycode) {
+    // Mirror XKeyEventToPlatformWindowKey(): unknown keysyms fall back to the
+    // keycode's default keysym.
+    const PlatformWindowKey fallback_key =
+        KeysymToPlatformWindowKey(HardwareKeycodeToDefaultXKeysym(keycode));
+    const uint32_t* keycode_keysyms =
+        keysyms + (keycode - min_keycode) * keysyms_per_keycode;
+
+    bool consistent = true;
+    bool any = false;
+    PlatformWindowKey key = kPlatformWindowKeyUnknown;
+    for (int i = 0; i < keysyms_per_keycode; ++i) {
+      if (keycode_keysyms[i] == NoSymbol) {
+        continue;
+      }
+      PlatformWindowKey level_key =
+          KeysymToPlatformWindowKey(keycode_keysyms[i]);
+      if (level_key == kPlatformWindowKeyUnknown) {
+        level_key = fallback_key;
+      }
+      if (any && level_key != key) {
+        consistent = false;
+        break;
+      }
+      key = level_key;
+      any = true;
+    }
+
+    if (consistent) {
+      keys_[keycode & 0xff] = static_cast<uint16_t>(any ? key : fallback_key);
+    } else {
+      levels_[keycode & 0xff] = {
+          keycode_keysyms[0],
+          keysyms_per_keycode > 1 ? keycode_keysyms[1] : uint32_t{NoSymbol}};
+    }
+  }
+}
+
+PlatformWindowKey KeycodeTable::TranslateLevels(uint8_t keycode,
+                                                uint16_t state) const {
+  constexpr uint16_t kNumLockMask = Mod2Mask;
+  const uint32_t lower = levels_[keycode][0];
+  const uint32_t upper =
+      levels_[keycode][1] == NoSymbol ? lower : levels_[keycode][1];
+  const bool is_keypad = upper >= XK_KP_Space && upper <= XK_KP_Equal;
+  const bool shifted = (state & ShiftMask) != 0;
+
+  // With Num Lock on, Shift selects the unshifted keypad keysym and vice
+  // versa. Caps Lock only affects letters, which never end up here.
+  uint32_t keysym;
+  if ((state & kNumLockMask) && is_keypad) {
+    keysym = shifted ? lower : upper;
+  } else {
+    keysym = shifted ? upper : lower;
+  }
+
+  PlatformWindowKey key = KeysymToPlatformWindowKey(keysym);
+  if (key == kPlatformWindowKeyUnknown) {
+    key = KeysymToPlatformWindowKey(HardwareKeycodeToDefaultXKeysym(keycode));
+  }
+  return key;
+}
+
+namespace {
+std::mutex g_keycode_table_mutex;
+std::atomic<const KeycodeTable*> g_keycode_table{nullptr};
+// Replaced tables are kept alive since other event threads may still be
+// reading them. Equal tables are only kept once, so this is bounded by the
+// number of distinct keyboard mappings used, e.g. one per layout switched to.
+std::vector<std::unique_ptr<KeycodeTable>>* g_keycode_tables = nullptr;
+}  // namespace
+
+const KeycodeTable* GetSharedKeycodeTable() {
+  return g_keycode_table.load(std::memory_order_acquire);
+}
+
+const KeycodeTable* InstallSharedKeycodeTable(
+    std::unique_ptr<KeycodeTable> table, bool replace) {
+  std::lock_guard<std::mutex> lock(g_keycode_table_mutex);
+  const KeycodeTable* current = g_keycode_table.load(std::memory_order_acquire);
+  if (current && !replace) {
+    return current;
+  }
+
+  if (!g_keycode_tables) {
+    g_keycode_tables = new std::vector<std::unique_ptr<KeycodeTable>>();
+  }
+  current = nullptr;
+  for (const std::unique_ptr<KeycodeTable>& installed : *g_keycode_tables) {
+    if (*installed == *table) {
+      current = installed.get();
+      break;
+    }
+  }
+  if (!current) {
+    g_keycode_tables->push_back(std::move(table));
+    current = g_keycode_tables->back().get();
+  }
+  g_keycode_table.store(current, std::memory_order_release);
+  return current;
+}
+
+}  // namespace platform_window
@@ -0,0 +1,87 @@
+#ifndef _PLATFORM_WINDOW_X11_KEYCODE_TABLE_H_
+#define _PLATFORM_WINDOW_X11_KEYCODE_TABLE_H_
+
+#include <X11/X.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "platform_window/platform_window_key.h"
+
+// The parts of X11 key translation that only depend on the core protocol, so
+// that they can be shared by the Xlib and XCB backends. Nothing in here calls
+// into Xlib.
+
+namespace platform_window {
+
+// Returns the keysym that |hardware_code| produces on a default US layout, or
+// 0 if unknown.
+uint32_t HardwareKeycodeToDefaultXKeysym(uint32_t hardware_code);
+
+PlatformWindowKey KeysymToPlatformWindowKey(KeySym keysym);
+
+// A precomputed keycode to PlatformWindowKey mapping for one keyboard
+// mapping. Keycodes whose keysyms translate to the same PlatformWindowKey at
+// every shift level and group (which, since letters, digits and punctuation
+// map to the same key regardless of case, is nearly all of them) are
+// resolved with a single array load. The rest, e.g. keypad keys affected by
+// Num Lock, depend on the modifier state of the event.
+class KeycodeTable {
+ public:
+  // |keysyms| holds |keysyms_per_keycode| keysyms for every keycode from
+  // |min_keycode| to |max_keycode|, as returned by GetKeyboardMapping.
+  KeycodeTable(int min_keycode, int max_keycode, int keysyms_per_keycode,
+               const uint32_t* keysyms);
+
+  // Sets |key| and returns true if |keycode| translates to the same key
+  // regardless of the modifier state.
+  bool Lookup(uint8_t keycode, PlatformWindowKey* key) const {
+    uint16_t value = keys_[keycode];
+    if (value == kNeedsLookup) {
+      return false;
+    }
+    *key = static_cast<PlatformWindowKey>(value);
+    return true;
+  }
+
+  // Translates |keycode| with the modifier |state| of a key event, by the core
+  // protocol's keysym selection rules (assuming Num Lock is Mod2, as it is
+  // nearly everywhere). For backends that cannot call XLookupString.
+  PlatformWindowKey TranslateWithState(uint8_t keycode, uint16_t state) const {
+    PlatformWindowKey key;
+    return Lookup(keycode, &key) ? key : TranslateLevels(keycode, state);
+  }
+
+  bool operator==(const KeycodeTable& other) const {
+    return keys_ == other.keys_ && levels_ == other.levels_;
+  }
+
+ private:
+  // All PlatformWindowKey values fit in 16 bits, and none of them is this.
+  static constexpr uint16_t kNeedsLookup = 0xffff;
+
+  PlatformWindowKey TranslateLevels(uint8_t keycode, uint16_t state) const;
+
+  std::array<uint16_t, 256> keys_;
+  // The unshifted and shifted keysyms of the first group, only filled in for
+  // keycodes marked kNeedsLookup.
+  std::array<std::array<uint32_t, 2>, 256> levels_;
+};
+
+// Returns the process-wide table for the current keyboard mapping, or null if
+// none has been installed yet. Installed tables stay valid for the lifetime
+// of the process, since other event threads may still be reading them.
+const KeycodeTable* GetSharedKeycodeTable();
+
+// Makes |table| the shared table and returns it. If |replace| is false and a
+// table has already been installed, |table| is dropped and the existing one
+// is returned instead. A table equal to one installed before is dropped in
+// favor of that one, so that only one table is ever kept per distinct
+// mapping, however often it is installed.
+const KeycodeTable* InstallSharedKeycodeTable(
+    std::unique_ptr<KeycodeTable> table, bool replace);
+
+}  // namespace platform_window
+
+#endif  // _PLATFORM_WINDOW_X11_KEYCODE_TABLE_H_